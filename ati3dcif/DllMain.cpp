@@ -1,22 +1,35 @@
 #include "ati3dcif.hpp"
 #include "Error.hpp"
+#include "Recorder.hpp"
 #include "Renderer.hpp"
+#include "State.hpp"
 #include "Utils.hpp"
 
 #include <glrage/GLRage.hpp>
 #include <glrage_util/ErrorUtils.hpp>
 #include <glrage_util/Logger.hpp>
 
+#include <cstring>
 #include <stdexcept>
 #include <memory>
+#include <vector>
 
 namespace glrage {
 namespace cif {
 
 static Context& context = GLRage::getContext();
+static Profiler& profiler = GLRage::getProfiler();
+static RenderThread& renderThread = GLRage::getRenderThread();
+static Overlay& overlay = GLRage::getOverlay();
 static std::unique_ptr<Renderer> renderer;
+static std::unique_ptr<Recorder> recorder;
 static bool contextCreated = false;
 
+// state sizes and the current vertex type, which are required to copy the
+// data of deferred calls
+static State state;
+static C3D_EVERTEX vertexType = C3D_EV_VTCF;
+
 C3D_EC
 HandleException()
 {
@@ -38,6 +51,60 @@ HandleException()
     }
 }
 
+// executes a renderer call that doesn't return anything to the app, which is
+// deferred if the render thread is running, so its errors can only be logged
+template <typename F>
+C3D_EC
+RenderCommand(F func)
+{
+    if (!renderThread.isQueued()) {
+        try {
+            func(*renderer);
+        } catch (...) {
+            return HandleException();
+        }
+        return C3D_EC_OK;
+    }
+
+    Renderer* r = renderer.get();
+    renderThread.run([r, func] {
+        try {
+            func(*r);
+        } catch (...) {
+            HandleException();
+        }
+    });
+
+    return C3D_EC_OK;
+}
+
+// same as above for calls with data owned by the app, which is passed to
+// func(renderer, data) directly or copied by write(copy) if deferred
+template <typename W, typename F>
+C3D_EC
+RenderCommand(void* data, size_t size, W write, F func)
+{
+    if (!renderThread.isQueued()) {
+        try {
+            func(*renderer, data);
+        } catch (...) {
+            return HandleException();
+        }
+        return C3D_EC_OK;
+    }
+
+    Renderer* r = renderer.get();
+    renderThread.run(size, write, [r, func](void* copy) {
+        try {
+            func(*r, copy);
+        } catch (...) {
+            HandleException();
+        }
+    });
+
+    return C3D_EC_OK;
+}
+
 // export macro for CIF implementation
 #define EXPORT(function_name, return_type, parameters)                         \
 function_name##_t function_name##_lib = function_name;                         \
@@ -53,6 +120,8 @@ EXPORT(ATI3DCIF_Init, C3D_EC, (void))
     context.attach();
 
     ErrorUtils::setHWnd(context.getHWnd());
+    Logger::setCurrent(&GLRage::getLogger());
+    Tracer::setCurrent(&GLRage::getTracer());
 
     // do some cleanup in case the app forgets to call ATI3DCIF_Term
     if (renderer) {
@@ -60,12 +129,29 @@ EXPORT(ATI3DCIF_Init, C3D_EC, (void))
         ATI3DCIF_Term();
     }
 
+    // record all calls for the replay tool if enabled, the trace spans all
+    // Init/Term pairs until the game exits
+    if (!recorder && GLRage::getConfig().getBool("ati3dcif.record", false)) {
+        try {
+            recorder = std::make_unique<Recorder>(
+                context.getBasePath() + L"\\cif.trace");
+        } catch (const std::exception& ex) {
+            LOG_INFO("Can't record ATI3DCIF calls: %s", ex.what());
+        }
+    }
+
+    if (recorder) {
+        recorder->init();
+    }
+
     try {
-        renderer = std::make_unique<Renderer>();
+        renderThread.call([] { renderer = Renderer::create(); });
     } catch (...) {
         return HandleException();
     }
 
+    vertexType = C3D_EV_VTCF;
+
     return C3D_EC_OK;
 }
 
@@ -73,6 +159,10 @@ EXPORT(ATI3DCIF_Term, C3D_EC, (void))
 {
     LOG_TRACE("");
 
+    if (recorder) {
+        recorder->term();
+    }
+
     try {
         if (renderer) {
             renderer.release();
@@ -135,12 +225,20 @@ EXPORT(ATI3DCIF_TextureReg, C3D_EC, (C3D_PTMAP ptmapToReg, C3D_PHTX phtmap))
 {
     LOG_TRACE("0x%p, 0x%p", *ptmapToReg, *phtmap);
 
+    if (recorder) {
+        recorder->textureReg(ptmapToReg);
+    }
+
     try {
-        renderer->textureReg(ptmapToReg, phtmap);
+        renderThread.call([&] { renderer->textureReg(ptmapToReg, phtmap); });
     } catch (...) {
         return HandleException();
     }
 
+    if (recorder) {
+        recorder->handle(*phtmap);
+    }
+
     return C3D_EC_OK;
 }
 
@@ -148,13 +246,12 @@ EXPORT(ATI3DCIF_TextureUnreg, C3D_EC, (C3D_HTX htxToUnreg))
 {
     LOG_TRACE("0x%p", htxToUnreg);
 
-    try {
-        renderer->textureUnreg(htxToUnreg);
-    } catch (...) {
-        return HandleException();
+    if (recorder) {
+        recorder->textureUnreg(htxToUnreg);
     }
 
-    return C3D_EC_OK;
+    return RenderCommand(
+        [htxToUnreg](Renderer& r) { r.textureUnreg(htxToUnreg); });
 }
 
 EXPORT(ATI3DCIF_TexturePaletteCreate, C3D_EC,
@@ -163,12 +260,22 @@ EXPORT(ATI3DCIF_TexturePaletteCreate, C3D_EC,
     LOG_TRACE("%s, 0x%p, 0x%p", cif::C3D_ECI_TMAP_TYPE_NAMES[epalette],
         pPalette, phtpalCreated);
 
+    if (recorder) {
+        recorder->texturePaletteCreate(epalette, pPalette);
+    }
+
     try {
-        renderer->texturePaletteCreate(epalette, pPalette, phtpalCreated);
+        renderThread.call([&] {
+            renderer->texturePaletteCreate(epalette, pPalette, phtpalCreated);
+        });
     } catch (...) {
         return HandleException();
     }
 
+    if (recorder) {
+        recorder->handle(*phtpalCreated);
+    }
+
     return C3D_EC_OK;
 }
 
@@ -176,13 +283,13 @@ EXPORT(ATI3DCIF_TexturePaletteDestroy, C3D_EC, (C3D_HTXPAL htxpalToDestroy))
 {
     LOG_TRACE("0x%p", htxpalToDestroy);
 
-    try {
-        renderer->texturePaletteDestroy(htxpalToDestroy);
-    } catch (...) {
-        return HandleException();
+    if (recorder) {
+        recorder->texturePaletteDestroy(htxpalToDestroy);
     }
 
-    return C3D_EC_OK;
+    return RenderCommand([htxpalToDestroy](Renderer& r) {
+        r.texturePaletteDestroy(htxpalToDestroy);
+    });
 }
 
 EXPORT(ATI3DCIF_TexturePaletteAnimate, C3D_EC,
@@ -192,9 +299,16 @@ EXPORT(ATI3DCIF_TexturePaletteAnimate, C3D_EC,
     LOG_TRACE("0x%p, %d, %d, 0x%p", htxpalToAnimate, u32StartIndex,
         u32NumEntries, *pclrPalette);
 
-    try {
-        renderer->texturePaletteAnimate(
+    if (recorder) {
+        recorder->texturePaletteAnimate(
             htxpalToAnimate, u32StartIndex, u32NumEntries, pclrPalette);
+    }
+
+    try {
+        renderThread.call([&] {
+            renderer->texturePaletteAnimate(
+                htxpalToAnimate, u32StartIndex, u32NumEntries, pclrPalette);
+        });
     } catch (...) {
         return HandleException();
     }
@@ -215,6 +329,10 @@ EXPORT(ATI3DCIF_ContextCreate, C3D_HRC, (void))
 
     contextCreated = true;
 
+    if (recorder) {
+        recorder->contextCreate();
+    }
+
     // According to ATI3DCIF.H, "only one context may be exist at a time",
     // so always returning 1 should be fine
     return (C3D_HRC)1;
@@ -231,52 +349,84 @@ EXPORT(ATI3DCIF_ContextDestroy, C3D_EC, (C3D_HRC hRC))
 
     contextCreated = false;
 
+    if (recorder) {
+        recorder->contextDestroy();
+    }
+
     return C3D_EC_OK;
 }
 
 EXPORT(ATI3DCIF_ContextSetState, C3D_EC,
     (C3D_HRC hRC, C3D_ERSID eRStateID, C3D_PRSDATA pRStateData))
 {
-#ifdef LOG_TRACE_ENABLED
+#if LOG_LEVEL <= LOG_LEVEL_TRACE
     std::string stateDataStr =
         cif::Utils::dumpRenderStateData(eRStateID, pRStateData);
     LOG_TRACE("0x%p, %s, %s", hRC, cif::C3D_ERSID_NAMES[eRStateID],
         stateDataStr.c_str());
+#else
+    TRACE_SCOPE(__FUNCTION__);
 #endif
 
-    try {
-        renderer->setState(eRStateID, pRStateData);
-    } catch (...) {
-        return HandleException();
+    if (recorder) {
+        recorder->setState(eRStateID, pRStateData);
     }
 
-    return C3D_EC_OK;
+    if (eRStateID >= C3D_ERS_NUM) {
+        return C3D_EC_BADPARAM;
+    }
+
+    if (eRStateID == C3D_ERS_VERTEX_TYPE) {
+        vertexType = *static_cast<C3D_EVERTEX*>(pRStateData);
+    }
+
+    size_t size = state.size(eRStateID);
+    return RenderCommand(pRStateData, size,
+        [pRStateData, size](void* copy) { memcpy(copy, pRStateData, size); },
+        [eRStateID](Renderer& r, void* data) { r.setState(eRStateID, data); });
 }
 
 EXPORT(ATI3DCIF_RenderBegin, C3D_EC, (C3D_HRC hRC))
 {
     LOG_TRACE("0x%p", hRC);
 
-    try {
-        renderer->renderBegin(hRC);
-    } catch (...) {
-        return HandleException();
+    profiler.begin(ProfilerSection::CIF);
+
+    // the first render block after a buffer swap starts a new frame
+    if (recorder) {
+        if (!context.isRendered()) {
+            recorder->frame(
+                context.getDisplayWidth(), context.getDisplayHeight());
+        }
+        recorder->renderBegin();
     }
 
-    return C3D_EC_OK;
+    context.setRenderQueued(true);
+
+    return RenderCommand([hRC](Renderer& r) { r.renderBegin(hRC); });
 }
 
 EXPORT(ATI3DCIF_RenderEnd, C3D_EC, (void))
 {
     LOG_TRACE("");
 
-    try {
-        renderer->renderEnd();
-    } catch (...) {
-        return HandleException();
+    if (recorder) {
+        recorder->renderEnd();
     }
 
-    return C3D_EC_OK;
+    // overlay rectangles added by patches during this render block are drawn
+    // on top of it
+    std::vector<Overlay::Rect> rects;
+    overlay.takeRects(rects);
+
+    C3D_EC result = RenderCommand([rects = std::move(rects)](Renderer& r) {
+        r.renderRects(rects);
+        r.renderEnd();
+    });
+
+    profiler.end(ProfilerSection::CIF);
+
+    return result;
 }
 
 EXPORT(ATI3DCIF_RenderSwitch, C3D_EC, (C3D_HRC hRC))
@@ -291,13 +441,16 @@ EXPORT(ATI3DCIF_RenderPrimStrip, C3D_EC,
 {
     LOG_TRACE("0x%p, %d", vStrip, u32NumVert);
 
-    try {
-        renderer->renderPrimStrip(vStrip, u32NumVert);
-    } catch (...) {
-        return HandleException();
+    if (recorder) {
+        recorder->renderPrimStrip(vStrip, u32NumVert);
     }
 
-    return C3D_EC_OK;
+    size_t size = u32NumVert * Utils::vertexSize(vertexType);
+    return RenderCommand(vStrip, size,
+        [vStrip, size](void* copy) { memcpy(copy, vStrip, size); },
+        [u32NumVert](Renderer& r, void* data) {
+            r.renderPrimStrip(data, u32NumVert);
+        });
 }
 
 EXPORT(
@@ -305,13 +458,27 @@ EXPORT(
 {
     LOG_TRACE("0x%p, %d", vList, u32NumVert);
 
-    try {
-        renderer->renderPrimList(vList, u32NumVert);
-    } catch (...) {
-        return HandleException();
+    if (recorder) {
+        recorder->renderPrimList(vList, u32NumVert);
     }
 
-    return C3D_EC_OK;
+    // deferred lists are rebuilt from copies of the vertices, which are stored
+    // behind the pointers
+    size_t vertSize = Utils::vertexSize(vertexType);
+    size_t listSize = u32NumVert * sizeof(void*);
+    return RenderCommand(vList, listSize + u32NumVert * vertSize,
+        [vList, u32NumVert, vertSize, listSize](void* copy) {
+            auto src = reinterpret_cast<void**>(vList);
+            auto dst = static_cast<void**>(copy);
+            auto vertices = static_cast<uint8_t*>(copy) + listSize;
+            for (C3D_UINT32 i = 0; i < u32NumVert; i++) {
+                dst[i] = vertices + i * vertSize;
+                memcpy(dst[i], src[i], vertSize);
+            }
+        },
+        [u32NumVert](Renderer& r, void* data) {
+            r.renderPrimList(static_cast<C3D_VLIST>(data), u32NumVert);
+        });
 }
 
 EXPORT(ATI3DCIF_RenderPrimMesh, C3D_EC,
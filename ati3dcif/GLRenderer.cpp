@@ -0,0 +1,578 @@
+#include "GLRenderer.hpp"
+#include "Error.hpp"
+#include "Utils.hpp"
+
+#include <glrage_gl/Utils.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <algorithm>
+#include <tuple>
+
+namespace glrage {
+namespace cif {
+
+using std::placeholders::_1;
+
+GLRenderer::GLRenderer()
+{
+    // register state observers
+    // clang-format off
+    m_state.registerObserver(std::bind(&GLRenderer::switchState, this, _1), C3D_ERS_VERTEX_TYPE);
+    m_state.registerObserver(std::bind(&GLRenderer::switchState, this, _1), C3D_ERS_TMAP_EN);
+    m_state.registerObserver(std::bind(&GLRenderer::switchState, this, _1), C3D_ERS_TMAP_SELECT);
+    m_state.registerObserver(std::bind(&GLRenderer::switchState, this, _1), C3D_ERS_TMAP_LIGHT);
+    m_state.registerObserver(std::bind(&GLRenderer::switchState, this, _1), C3D_ERS_TMAP_FILTER);
+    m_state.registerObserver(std::bind(&GLRenderer::switchState, this, _1), C3D_ERS_TMAP_TEXOP);
+    m_state.registerObserver(std::bind(&GLRenderer::switchState, this, _1), C3D_ERS_ALPHA_SRC);
+    m_state.registerObserver(std::bind(&GLRenderer::switchState, this, _1), C3D_ERS_ALPHA_DST);
+    m_state.registerObserver(std::bind(&GLRenderer::switchState, this, _1), C3D_ERS_Z_CMP_FNC);
+    m_state.registerObserver(std::bind(&GLRenderer::switchState, this, _1), C3D_ERS_Z_MODE);
+
+    m_state.registerObserver(std::bind(&GLRenderer::vertexType, this, _1), C3D_ERS_VERTEX_TYPE);
+    m_state.registerObserver(std::bind(&GLRenderer::primType, this, _1), C3D_ERS_PRIM_TYPE);
+    m_state.registerObserver(std::bind(&GLRenderer::solidColor, this, _1), C3D_ERS_SOLID_CLR);
+    m_state.registerObserver(std::bind(&GLRenderer::shadeMode, this, _1), C3D_ERS_SHADE_MODE);
+    m_state.registerObserver(std::bind(&GLRenderer::tmapEnable, this, _1), C3D_ERS_TMAP_EN);
+    m_state.registerObserver(std::bind(&GLRenderer::tmapSelect, this, _1), C3D_ERS_TMAP_SELECT);
+    m_state.registerObserver(std::bind(&GLRenderer::tmapLight, this, _1), C3D_ERS_TMAP_LIGHT);
+    m_state.registerObserver(std::bind(&GLRenderer::tmapFilter, this, _1), C3D_ERS_TMAP_FILTER);
+    m_state.registerObserver(std::bind(&GLRenderer::tmapTexOp, this, _1), C3D_ERS_TMAP_TEXOP);
+    m_state.registerObserver(std::bind(&GLRenderer::alphaSrc, this, _1), C3D_ERS_ALPHA_SRC);
+    m_state.registerObserver(std::bind(&GLRenderer::alphaDst, this, _1), C3D_ERS_ALPHA_DST);
+    m_state.registerObserver(std::bind(&GLRenderer::zCmpFunc, this, _1), C3D_ERS_Z_CMP_FNC);
+    m_state.registerObserver(std::bind(&GLRenderer::zMode, this, _1), C3D_ERS_Z_MODE);
+    // clang-format on
+
+    // bind sampler
+    m_sampler.bind(0);
+
+    // improve texture filtering quality
+    float filterAniso = m_config.getFloat("ati3dcif.filter_anisotropy", 16.0f);
+    if (filterAniso > 0) {
+        m_sampler.parameterf(GL_TEXTURE_MAX_ANISOTROPY_EXT, filterAniso);
+    }
+
+    // compile and link shaders and configure program
+    std::wstring basePath = m_context.getBasePath();
+    m_program.attach(gl::Shader(GL_VERTEX_SHADER)
+                         .fromFile(basePath + L"/shaders/ati3dcif.vsh"));
+    m_program.attach(gl::Shader(GL_FRAGMENT_SHADER)
+                         .fromFile(basePath + L"/shaders/ati3dcif.fsh"));
+    m_program.link();
+    m_program.fragmentData("fragColor");
+    m_program.bind();
+
+    // negate Z axis so the model is rendered behind the viewport, which is
+    // better
+    // than having a negative zNear in the ortho matrix, which seems to mess up
+    // depth testing
+    auto modelView = glm::scale(glm::mat4(), glm::vec3(1, 1, -1));
+    m_program.uniformMatrix4fv(
+        "matModelView", 1, GL_FALSE, glm::value_ptr(modelView));
+
+    // cache frequently used config values
+    m_wireframe = m_config.getBool("ati3dcif.wireframe", false);
+    m_sortOpaque = m_config.getBool("ati3dcif.sort_opaque", false);
+
+    // apply default state
+    resetState();
+
+    gl::Utils::checkError(__FUNCTION__);
+}
+
+void GLRenderer::renderBegin(C3D_HRC hRC)
+{
+    glEnable(GL_BLEND);
+
+    // set wireframe mode if set
+    if (m_wireframe) {
+        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    }
+
+    // bind objects
+    m_program.bind();
+    m_vertexStream.bind();
+    m_sampler.bind(0);
+
+    // restore texture binding
+    tmapRestore();
+
+    // CIF always uses an orthographic view, the application deals with the
+    // perspective when required
+    auto width = static_cast<float>(m_context.getDisplayWidth());
+    auto height = static_cast<float>(m_context.getDisplayHeight());
+    auto projection = glm::ortho<float>(0, width, height, 0, -1e6, 1e6);
+    m_program.uniformMatrix4fv(
+        "matProjection", 1, GL_FALSE, glm::value_ptr(projection));
+
+    // lines and points are one display pixel wide, but at least one pixel
+    // of the window, so they don't disappear if it's smaller than the display
+    auto windowWidth = static_cast<float>(m_context.getWindowWidth());
+    auto windowHeight = static_cast<float>(m_context.getWindowHeight());
+    float lineWidth = 1;
+    if (windowWidth > 0 && windowHeight > 0) {
+        lineWidth = (std::max)(
+            lineWidth, (std::max)(width / windowWidth, height / windowHeight));
+    }
+    m_vertexStream.lineWidth(lineWidth);
+
+    gl::Utils::checkError(__FUNCTION__);
+}
+
+void GLRenderer::renderEnd()
+{
+    // make sure everything has been rendered
+    m_vertexStream.renderPending();
+    renderOpaque();
+
+    // restore polygon mode
+    if (m_wireframe) {
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    }
+
+    gl::Utils::checkError(__FUNCTION__);
+}
+
+void GLRenderer::textureReg(C3D_PTMAP ptmapToReg, C3D_PHTX phtmap)
+{
+    // LOG_TRACE("fmt=%d, xlg2=%d, ylg2=%d, mip=%d",
+    //    ptmapToReg->eTexFormat, ptmapToReg->u32MaxMapXSizeLg2,
+    //    ptmapToReg->u32MaxMapYSizeLg2, ptmapToReg->bMipMap);
+
+    auto texture = std::make_shared<Texture>();
+    texture->bind();
+    texture->load(ptmapToReg, m_palettes[ptmapToReg->htxpalTexPalette]);
+
+    // use id as texture handle
+    *phtmap = reinterpret_cast<C3D_HTX>(texture->id());
+
+    // store in texture map
+    m_textures[*phtmap] = texture;
+
+    // restore previously bound texture
+    tmapRestore();
+
+    gl::Utils::checkError(__FUNCTION__);
+}
+
+void GLRenderer::textureUnreg(C3D_HTX htxToUnreg)
+{
+    // LOG_TRACE("id=%d", id);
+
+    auto it = m_textures.find(htxToUnreg);
+    if (it == m_textures.end()) {
+        throw Error("Invalid texture handle", C3D_EC_BADPARAM);
+    }
+
+    // the collected geometry may still use the texture
+    renderOpaque();
+
+    // unbind texture if currently bound
+    if (htxToUnreg == m_state.get(C3D_ERS_TMAP_SELECT).htx) {
+        m_state.set(C3D_ERS_TMAP_SELECT, StateVar::Value{0});
+    }
+
+    std::shared_ptr<Texture> texture = it->second;
+    m_textures.erase(htxToUnreg);
+}
+
+void GLRenderer::texturePaletteCreate(
+    C3D_ECI_TMAP_TYPE epalette, void* pPalette, C3D_PHTXPAL phtpalCreated)
+{
+    if (epalette != C3D_ECI_TMAP_8BIT) {
+        throw Error("Unsupported palette type: " +
+                        std::string(C3D_ECI_TMAP_TYPE_NAMES[epalette]),
+            C3D_EC_NOTIMPYET);
+    }
+
+    // copy palette entries to vector
+    auto palettePtr = static_cast<C3D_PPALETTENTRY>(pPalette);
+    std::vector<C3D_PALETTENTRY> palette(palettePtr, palettePtr + 256);
+
+    // create new palette handle
+    auto handle = reinterpret_cast<C3D_HTXPAL>(m_paletteID++);
+
+    // store palette
+    m_palettes[handle] = palette;
+
+    *phtpalCreated = handle;
+}
+
+void GLRenderer::texturePaletteDestroy(C3D_HTXPAL htxpalToDestroy)
+{
+    m_palettes.erase(htxpalToDestroy);
+}
+
+void GLRenderer::texturePaletteAnimate(C3D_HTXPAL htxpalToAnimate,
+    C3D_UINT32 u32StartIndex, C3D_UINT32 u32NumEntries,
+    C3D_PPALETTENTRY pclrPalette)
+{
+    throw Error(std::string(__FUNCTION__) + ": Not implemented",
+        C3D_EC_NOTIMPYET);
+}
+
+void GLRenderer::renderPrimStrip(C3D_VSTRIP vStrip, C3D_UINT32 u32NumVert)
+{
+    m_context.setRendered();
+
+    if (isInvisible()) {
+        return;
+    }
+
+    bool deferred = deferOpaque();
+    m_vertexStream.addPrimStrip(vStrip, u32NumVert);
+    if (deferred) {
+        m_vertexStream.takePending(*m_opaqueBatch);
+    }
+}
+
+void GLRenderer::renderPrimList(C3D_VLIST vList, C3D_UINT32 u32NumVert)
+{
+    m_context.setRendered();
+
+    if (isInvisible()) {
+        return;
+    }
+
+    bool deferred = deferOpaque();
+    m_vertexStream.addPrimList(vList, u32NumVert);
+    if (deferred) {
+        m_vertexStream.takePending(*m_opaqueBatch);
+    }
+}
+
+void GLRenderer::renderRects(const std::vector<Overlay::Rect>& rects)
+{
+    // overlay colors are palette indices of the game, which always uses the
+    // palette it created last
+    if (rects.empty() || m_palettes.empty()) {
+        return;
+    }
+
+    TRACE_SCOPE(__FUNCTION__);
+
+    m_context.setRendered();
+
+    // draw on top of everything rendered so far
+    m_vertexStream.renderPending();
+    renderOpaque();
+
+    auto& palette = m_palettes.rbegin()->second;
+    std::vector<C3D_VTCF> vertices(rects.size() * 2);
+    std::vector<C3D_VTCF*> vertexList(vertices.size());
+    for (size_t i = 0; i < rects.size(); i++) {
+        C3D_VTCF corners[2];
+        Utils::rectVertices(rects[i], palette, corners);
+        vertices[i * 2] = corners[0];
+        vertices[i * 2 + 1] = corners[1];
+    }
+
+    for (size_t i = 0; i < vertices.size(); i++) {
+        vertexList[i] = &vertices[i];
+    }
+
+    glDisable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    glBlendFunc(GL_ONE, GL_ZERO);
+    m_program.uniform1i("tmapEn", false);
+
+    m_vertexStream.vertexType(C3D_EV_VTCF);
+    m_vertexStream.shadeMode(C3D_ESH_SMOOTH);
+    m_vertexStream.primType(C3D_EPRIM_RECT);
+    m_vertexStream.addPrimList(reinterpret_cast<C3D_VLIST>(vertexList.data()),
+        static_cast<C3D_UINT32>(vertexList.size()));
+    m_vertexStream.renderPending();
+
+    // restore the current state
+    StateVar::Value value = m_state.get(C3D_ERS_VERTEX_TYPE);
+    vertexType(value);
+
+    value = m_state.get(C3D_ERS_SHADE_MODE);
+    shadeMode(value);
+
+    value = m_state.get(C3D_ERS_PRIM_TYPE);
+    primType(value);
+
+    value = m_state.get(C3D_ERS_TMAP_EN);
+    tmapEnable(value);
+
+    value = m_state.get(C3D_ERS_ALPHA_SRC);
+    alphaSrc(value);
+
+    value = m_state.get(C3D_ERS_Z_MODE);
+    zMode(value);
+
+    gl::Utils::checkError(__FUNCTION__);
+}
+
+void GLRenderer::setState(C3D_ERSID eRStateID, C3D_PRSDATA pRStateData)
+{
+    m_state.set(eRStateID, pRStateData);
+}
+
+void GLRenderer::resetState()
+{
+    m_state.reset();
+}
+
+void GLRenderer::switchState(StateVar::Value& value)
+{
+    // render pending polygons from the previous state
+    m_vertexStream.renderPending();
+    m_opaqueBatch = nullptr;
+}
+
+void GLRenderer::vertexType(StateVar::Value& value)
+{
+    m_vertexStream.vertexType(value.evertex);
+}
+
+void GLRenderer::primType(StateVar::Value& value)
+{
+    m_vertexStream.primType(value.eprim);
+}
+
+void GLRenderer::solidColor(StateVar::Value& value)
+{
+    m_vertexStream.solidColor(value.color);
+}
+
+void GLRenderer::shadeMode(StateVar::Value& value)
+{
+    m_vertexStream.shadeMode(value.eshade);
+}
+
+void GLRenderer::tmapEnable(StateVar::Value& value)
+{
+    C3D_BOOL enable = value.boolean;
+    m_program.uniform1i("tmapEn", enable);
+}
+
+void GLRenderer::tmapSelect(StateVar::Value& value)
+{
+    tmapSelectImpl(value.htx, m_state.get(C3D_ERS_TMAP_TEXOP).etexop);
+}
+
+void GLRenderer::tmapSelectImpl(C3D_HTX handle, C3D_ETEXOP texOp)
+{
+    // unselect texture if handle is zero
+    if (handle == 0) {
+        glBindTexture(GL_TEXTURE_2D, 0);
+        m_texture = nullptr;
+        return;
+    }
+
+    // check if handle is correct
+    auto it = m_textures.find(handle);
+    if (it == m_textures.end()) {
+        throw Error("Invalid texture handle", C3D_EC_BADPARAM);
+    }
+
+    // get texture object and bind it, chroma keyed drawing uses the copy
+    // with the key in the alpha channel if there is one
+    auto texture = it->second;
+    bool keyAlpha = texOp == C3D_ETEXOP_CHROMAKEY && texture->chromaKeyAlpha();
+    texture->bind(keyAlpha);
+    m_texture = texture;
+    m_textureKeyed = keyAlpha;
+
+    if (m_tmapMipmap) {
+        texture->generateMipmaps(keyAlpha);
+    }
+
+    // send chroma key to shader
+    auto ck = texture->chromaKey();
+    m_program.uniform3f(
+        "chromaKey", ck.r / 255.0f, ck.g / 255.0f, ck.b / 255.0f);
+    m_program.uniform1i("chromaKeyAlpha", keyAlpha);
+}
+
+void GLRenderer::tmapRestore() {
+    tmapSelectImpl(m_state.get(C3D_ERS_TMAP_SELECT).htx,
+        m_state.get(C3D_ERS_TMAP_TEXOP).etexop);
+}
+
+void GLRenderer::tmapLight(StateVar::Value& value)
+{
+    m_program.uniform1i("tmapLight", value.etlight);
+}
+
+void GLRenderer::tmapFilter(StateVar::Value& value)
+{
+    tmapFilterImpl(value.etexfilter);
+}
+
+void GLRenderer::tmapFilterImpl(C3D_ETEXFILTER filter)
+{
+    GLenum minFilter = GLCIF_TEXTURE_MIN_FILTER[filter];
+    m_sampler.parameteri(
+        GL_TEXTURE_MAG_FILTER, GLCIF_TEXTURE_MAG_FILTER[filter]);
+    m_sampler.parameteri(GL_TEXTURE_MIN_FILTER, minFilter);
+
+    // textures only get their mipmaps once they're sampled with them
+    m_tmapMipmap = minFilter != GL_NEAREST && minFilter != GL_LINEAR;
+    if (m_tmapMipmap && m_texture) {
+        m_texture->generateMipmaps(m_textureKeyed);
+    }
+}
+
+void GLRenderer::tmapTexOp(StateVar::Value& value)
+{
+    m_program.uniform1i("texOp", value.etexop);
+
+    // switch between the texture and its keyed copy
+    if (m_texture) {
+        tmapSelectImpl(m_state.get(C3D_ERS_TMAP_SELECT).htx, value.etexop);
+    }
+}
+
+void GLRenderer::alphaSrc(StateVar::Value& value)
+{
+    C3D_EASRC alphaSrc = value.easrc;
+    C3D_EADST alphaDst = m_state.get(C3D_ERS_ALPHA_DST).eadst;
+    glBlendFunc(GLCIF_BLEND_FUNC[alphaSrc], GLCIF_BLEND_FUNC[alphaDst]);
+}
+
+void GLRenderer::alphaDst(StateVar::Value& value)
+{
+    C3D_EASRC alphaSrc =  m_state.get(C3D_ERS_ALPHA_SRC).easrc;
+    C3D_EADST alphaDst = value.eadst;
+    glBlendFunc(GLCIF_BLEND_FUNC[alphaSrc], GLCIF_BLEND_FUNC[alphaDst]);
+}
+
+void GLRenderer::zCmpFunc(StateVar::Value& value)
+{
+    C3D_EZCMP func = value.ezcmp;
+    if (func < C3D_EZCMP_MAX) {
+        glDepthFunc(GLCIF_DEPTH_FUNC[func]);
+    }
+}
+
+bool GLRenderer::isInvisible()
+{
+    // primitives without shading and texture aren't drawn at all
+    return m_state.get(C3D_ERS_SHADE_MODE).eshade == C3D_ESH_NONE &&
+           !m_state.get(C3D_ERS_TMAP_EN).boolean;
+}
+
+bool GLRenderer::OpaqueState::operator<(const OpaqueState& other) const
+{
+    auto key = [](const OpaqueState& state) {
+        return std::tie(state.texture, state.tmapEn, state.tmapLight,
+            state.tmapFilter, state.texOp, state.zCmpFunc);
+    };
+
+    return key(*this) < key(other);
+}
+
+bool GLRenderer::deferOpaque()
+{
+    if (!m_sortOpaque) {
+        return false;
+    }
+
+    if (m_opaqueBatch) {
+        return true;
+    }
+
+    // blending and depth functions other than these make the result depend
+    // on the drawing order
+    C3D_EZMODE zMode = m_state.get(C3D_ERS_Z_MODE).ezmode;
+    C3D_EZCMP zCmpFunc = m_state.get(C3D_ERS_Z_CMP_FNC).ezcmp;
+    C3D_EASRC alphaSrc = m_state.get(C3D_ERS_ALPHA_SRC).easrc;
+    C3D_EADST alphaDst = m_state.get(C3D_ERS_ALPHA_DST).eadst;
+    if (zMode != C3D_EZMODE_TESTON_WRITEZ ||
+        (zCmpFunc != C3D_EZCMP_LESS && zCmpFunc != C3D_EZCMP_LEQUAL) ||
+        alphaSrc != C3D_EASRC_ONE || alphaDst != C3D_EADST_ZERO) {
+        renderOpaque();
+        return false;
+    }
+
+    // ignore unused state, so more geometry ends up in the same batch
+    OpaqueState state = opaqueState();
+    if (!state.tmapEn) {
+        state.texture = 0;
+    }
+
+    m_opaqueBatch = &m_opaqueBatches[state];
+    return true;
+}
+
+GLRenderer::OpaqueState GLRenderer::opaqueState()
+{
+    OpaqueState state;
+    state.texture = m_state.get(C3D_ERS_TMAP_SELECT).htx;
+    state.tmapEn = m_state.get(C3D_ERS_TMAP_EN).boolean;
+    state.tmapLight = m_state.get(C3D_ERS_TMAP_LIGHT).etlight;
+    state.tmapFilter = m_state.get(C3D_ERS_TMAP_FILTER).etexfilter;
+    state.texOp = m_state.get(C3D_ERS_TMAP_TEXOP).etexop;
+    state.zCmpFunc = m_state.get(C3D_ERS_Z_CMP_FNC).ezcmp;
+    return state;
+}
+
+void GLRenderer::applyOpaqueState(const OpaqueState& state)
+{
+    // Set the filter without a texture, so it doesn't generate mipmaps for
+    // the previous one. Selecting the texture generates its mipmaps if the
+    // filter uses them.
+    m_texture = nullptr;
+    tmapFilterImpl(state.tmapFilter);
+    tmapSelectImpl(state.texture, state.texOp);
+    m_program.uniform1i("tmapEn", state.tmapEn);
+    m_program.uniform1i("tmapLight", state.tmapLight);
+    m_program.uniform1i("texOp", state.texOp);
+
+    if (state.zCmpFunc < C3D_EZCMP_MAX) {
+        glDepthFunc(GLCIF_DEPTH_FUNC[state.zCmpFunc]);
+    }
+}
+
+void GLRenderer::renderOpaque()
+{
+    m_opaqueBatch = nullptr;
+
+    if (m_opaqueBatches.empty()) {
+        return;
+    }
+
+    TRACE_SCOPE(__FUNCTION__);
+
+    glBlendFunc(GL_ONE, GL_ZERO);
+    glDepthMask(GL_TRUE);
+    glEnable(GL_DEPTH_TEST);
+
+    for (auto& batch : m_opaqueBatches) {
+        applyOpaqueState(batch.first);
+        m_vertexStream.addPending(batch.second);
+        m_vertexStream.renderPending();
+    }
+
+    m_opaqueBatches.clear();
+
+    // restore the current state
+    applyOpaqueState(opaqueState());
+
+    StateVar::Value value = m_state.get(C3D_ERS_ALPHA_SRC);
+    alphaSrc(value);
+
+    value = m_state.get(C3D_ERS_Z_MODE);
+    zMode(value);
+}
+
+void GLRenderer::zMode(StateVar::Value& value)
+{
+    auto mode = value.ezmode;
+    glDepthMask(GLCIF_DEPTH_MASK[mode]);
+
+    if (mode > C3D_EZMODE_TESTON) {
+        glEnable(GL_DEPTH_TEST);
+    } else {
+        glDisable(GL_DEPTH_TEST);
+    }
+}
+
+} // namespace cif
+} // namespace glrage
\ No newline at end of file
@@ -0,0 +1,656 @@
+#include "Rasterizer.hpp"
+
+#include <glrage_util/Logger.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include <emmintrin.h>
+
+namespace glrage {
+namespace cif {
+
+namespace {
+
+// depth values are quantized like a 24 bit depth buffer with the projection
+// of GLRenderer, which maps z from [-1e6, 1e6] to [0, 1]
+const uint32_t DEPTH_MAX = 0xffffff;
+const float DEPTH_SCALE = 0.5e-6f * DEPTH_MAX;
+const float DEPTH_BIAS = 0.5f * DEPTH_MAX;
+
+__m128i depthTest(C3D_EZCMP func, __m128i depth, __m128i stored)
+{
+    const __m128i ones = _mm_set1_epi32(-1);
+
+    switch (func) {
+        case C3D_EZCMP_NEVER:
+            return _mm_setzero_si128();
+        case C3D_EZCMP_LESS:
+            return _mm_cmplt_epi32(depth, stored);
+        case C3D_EZCMP_LEQUAL:
+            return _mm_xor_si128(_mm_cmpgt_epi32(depth, stored), ones);
+        case C3D_EZCMP_EQUAL:
+            return _mm_cmpeq_epi32(depth, stored);
+        case C3D_EZCMP_GEQUAL:
+            return _mm_xor_si128(_mm_cmplt_epi32(depth, stored), ones);
+        case C3D_EZCMP_GREATER:
+            return _mm_cmpgt_epi32(depth, stored);
+        case C3D_EZCMP_NOTEQUAL:
+            return _mm_xor_si128(_mm_cmpeq_epi32(depth, stored), ones);
+        default:
+            return ones;
+    }
+}
+
+// blend factors in the order of GLCIF_BLEND_FUNC
+void blendFactor(uint32_t func, const float* src, const float* dst,
+    float* factor)
+{
+    for (int i = 0; i < 4; i++) {
+        switch (func) {
+            case 0:
+                factor[i] = 0;
+                break;
+            case 1:
+                factor[i] = 1;
+                break;
+            case 2:
+                factor[i] = dst[i];
+                break;
+            case 3:
+                factor[i] = 1 - dst[i];
+                break;
+            case 4:
+                factor[i] = src[3];
+                break;
+            case 5:
+                factor[i] = 1 - src[3];
+                break;
+            case 6:
+                factor[i] = dst[3];
+                break;
+            case 7:
+                factor[i] = 1 - dst[3];
+                break;
+        }
+    }
+}
+
+uint32_t packColor(const float* rgba)
+{
+    uint32_t color = 0;
+    for (int i = 0; i < 4; i++) {
+        float c = (std::min)((std::max)(rgba[i], 0.0f), 1.0f);
+        color |= static_cast<uint32_t>(c * 255 + 0.5f) << (i * 8);
+    }
+    return color;
+}
+
+} // namespace
+
+Rasterizer::Rasterizer(uint32_t threads)
+{
+    // the calling thread works on the tiles as well
+    for (uint32_t i = 1; i < threads; i++) {
+        m_workers.emplace_back(&Rasterizer::workerProc, this);
+    }
+
+    LOG_INFO("Software rasterizer with %d threads",
+        static_cast<uint32_t>(m_workers.size() + 1));
+}
+
+Rasterizer::~Rasterizer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_workCondition.notify_all();
+
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void Rasterizer::resize(uint32_t width, uint32_t height)
+{
+    if (width == m_width && height == m_height) {
+        return;
+    }
+
+    // pending triangles have been binned for the previous size
+    flush();
+
+    m_width = width;
+    m_height = height;
+    m_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    m_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    m_bins.assign(m_tilesX * m_tilesY, std::vector<uint32_t>());
+
+    // rows are read in aligned groups of four pixels, which must not reach
+    // into the next row, since it may belong to another tile
+    m_stride = (width + 3) & ~3;
+    m_color.assign(m_stride * height, 0);
+    m_depth.assign(m_stride * height, DEPTH_MAX);
+}
+
+void Rasterizer::clear()
+{
+    flush();
+
+    std::fill(m_color.begin(), m_color.end(), 0);
+    std::fill(m_depth.begin(), m_depth.end(), DEPTH_MAX);
+}
+
+void Rasterizer::setState(const DrawState& state)
+{
+    // replace the current state if no triangle uses it yet
+    if (m_states.empty() || (!m_triangles.empty() &&
+                                m_triangles.back().state ==
+                                    m_states.size() - 1)) {
+        m_states.push_back(state);
+    } else {
+        m_states.back() = state;
+    }
+}
+
+void Rasterizer::addTriangle(
+    const C3D_VTCF& v0, const C3D_VTCF& v1, const C3D_VTCF& v2)
+{
+    const DrawState& state = m_states.back();
+
+    // nothing is drawn without shading and texture, like the discard in the
+    // shader of GLRenderer
+    if (state.shadeMode == C3D_ESH_NONE && !state.tmapEn) {
+        return;
+    }
+
+    const C3D_VTCF* v[3] = {&v0, &v1, &v2};
+
+    // the last vertex provides the color for flat shading
+    Triangle tri;
+    tri.flatColor[0] = v2.r / 255.0f;
+    tri.flatColor[1] = v2.g / 255.0f;
+    tri.flatColor[2] = v2.b / 255.0f;
+    tri.flatColor[3] = v2.a / 255.0f;
+    tri.state = static_cast<uint32_t>(m_states.size() - 1);
+
+    // snap vertices to 28.4 fixed point, triangles outside of the guard band
+    // are skipped
+    int64_t fx[3];
+    int64_t fy[3];
+    for (int i = 0; i < 3; i++) {
+        if (!(std::abs(v[i]->x) <= GUARD_BAND &&
+                std::abs(v[i]->y) <= GUARD_BAND)) {
+            return;
+        }
+        fx[i] = std::lround(v[i]->x * 16);
+        fy[i] = std::lround(v[i]->y * 16);
+    }
+
+    int64_t area = (fx[1] - fx[0]) * (fy[2] - fy[0]) -
+                   (fy[1] - fy[0]) * (fx[2] - fx[0]);
+    if (area == 0) {
+        return;
+    }
+
+    // there's no culling, so bring back-facing triangles into the same order
+    if (area < 0) {
+        std::swap(v[1], v[2]);
+        std::swap(fx[1], fx[2]);
+        std::swap(fy[1], fy[2]);
+        area = -area;
+    }
+
+    // edge functions, evaluated at the pixel centers, with the top-left fill
+    // rule
+    for (int i = 0; i < 3; i++) {
+        int j = (i + 1) % 3;
+        int64_t a = fy[i] - fy[j];
+        int64_t b = fx[j] - fx[i];
+        int64_t c = -a * fx[i] - b * fy[i];
+
+        bool topLeft = a > 0 || (a == 0 && b > 0);
+        if (!topLeft) {
+            c--;
+        }
+
+        tri.a[i] = a * 16;
+        tri.b[i] = b * 16;
+        tri.c[i] = c + a * 8 + b * 8;
+    }
+
+    // bounding box of the covered pixel centers
+    int64_t minFx = (std::min)({fx[0], fx[1], fx[2]});
+    int64_t maxFx = (std::max)({fx[0], fx[1], fx[2]});
+    int64_t minFy = (std::min)({fy[0], fy[1], fy[2]});
+    int64_t maxFy = (std::max)({fy[0], fy[1], fy[2]});
+
+    tri.minX = (std::max)(static_cast<int32_t>((minFx + 7) >> 4), 0);
+    tri.minY = (std::max)(static_cast<int32_t>((minFy + 7) >> 4), 0);
+    tri.maxX = (std::min)(static_cast<int32_t>((maxFx - 8) >> 4),
+        static_cast<int32_t>(m_width) - 1);
+    tri.maxY = (std::min)(static_cast<int32_t>((maxFy - 8) >> 4),
+        static_cast<int32_t>(m_height) - 1);
+
+    if (tri.minX > tri.maxX || tri.minY > tri.maxY) {
+        return;
+    }
+
+    // attribute planes in pixel space, relative to the snapped vertices
+    double x0 = fx[0] / 16.0;
+    double y0 = fy[0] / 16.0;
+    double x1 = fx[1] / 16.0 - x0;
+    double y1 = fy[1] / 16.0 - y0;
+    double x2 = fx[2] / 16.0 - x0;
+    double y2 = fy[2] / 16.0 - y0;
+    double det = area / 256.0;
+
+    // texture coordinates are divided by w per pixel, which makes them
+    // perspective correct
+    float values[3][ATTR_NUM];
+    for (int i = 0; i < 3; i++) {
+        values[i][ATTR_Z] = v[i]->z;
+        values[i][ATTR_S] = v[i]->s;
+        values[i][ATTR_T] = v[i]->t;
+        values[i][ATTR_W] = v[i]->w;
+        values[i][ATTR_R] = v[i]->r / 255.0f;
+        values[i][ATTR_G] = v[i]->g / 255.0f;
+        values[i][ATTR_B] = v[i]->b / 255.0f;
+        values[i][ATTR_A] = v[i]->a / 255.0f;
+    }
+
+    double cx = tri.minX + 0.5 - x0;
+    double cy = tri.minY + 0.5 - y0;
+    for (int k = 0; k < ATTR_NUM; k++) {
+        double d1 = values[1][k] - values[0][k];
+        double d2 = values[2][k] - values[0][k];
+        double dx = (d1 * y2 - d2 * y1) / det;
+        double dy = (x1 * d2 - x2 * d1) / det;
+        tri.attr[k] = static_cast<float>(values[0][k] + dx * cx + dy * cy);
+        tri.attrDx[k] = static_cast<float>(dx);
+        tri.attrDy[k] = static_cast<float>(dy);
+    }
+
+    // bin into the touched tiles
+    auto index = static_cast<uint32_t>(m_triangles.size());
+    m_triangles.push_back(tri);
+
+    uint32_t tileMinX = static_cast<uint32_t>(tri.minX) / TILE_SIZE;
+    uint32_t tileMinY = static_cast<uint32_t>(tri.minY) / TILE_SIZE;
+    uint32_t tileMaxX = static_cast<uint32_t>(tri.maxX) / TILE_SIZE;
+    uint32_t tileMaxY = static_cast<uint32_t>(tri.maxY) / TILE_SIZE;
+
+    for (uint32_t ty = tileMinY; ty <= tileMaxY; ty++) {
+        for (uint32_t tx = tileMinX; tx <= tileMaxX; tx++) {
+            m_bins[ty * m_tilesX + tx].push_back(index);
+        }
+    }
+
+    if (m_triangles.size() >= MAX_TRIANGLES) {
+        flush();
+    }
+}
+
+void Rasterizer::flush()
+{
+    if (m_triangles.empty()) {
+        return;
+    }
+
+    TRACE_SCOPE(__FUNCTION__);
+
+    m_activeTiles.clear();
+    for (uint32_t i = 0; i < m_bins.size(); i++) {
+        if (!m_bins[i].empty()) {
+            m_activeTiles.push_back(i);
+        }
+    }
+
+    m_nextTile = 0;
+
+    if (!m_workers.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_generation++;
+            m_busy = static_cast<uint32_t>(m_workers.size());
+        }
+        m_workCondition.notify_all();
+    }
+
+    processTiles();
+
+    if (!m_workers.empty()) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_doneCondition.wait(lock, [this] { return m_busy == 0; });
+    }
+
+    for (auto tile : m_activeTiles) {
+        m_bins[tile].clear();
+    }
+
+    m_triangles.clear();
+
+    // keep the current state for the following triangles
+    m_states.erase(m_states.begin(), m_states.end() - 1);
+}
+
+uint32_t Rasterizer::width()
+{
+    return m_width;
+}
+
+uint32_t Rasterizer::height()
+{
+    return m_height;
+}
+
+uint32_t Rasterizer::stride()
+{
+    return m_stride;
+}
+
+const uint32_t* Rasterizer::colorBuffer()
+{
+    return m_color.data();
+}
+
+void Rasterizer::workerProc()
+{
+    uint32_t generation = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_workCondition.wait(lock, [this, generation] {
+                return m_stop || m_generation != generation;
+            });
+
+            if (m_stop) {
+                return;
+            }
+
+            generation = m_generation;
+        }
+
+        processTiles();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_busy == 0) {
+                m_doneCondition.notify_one();
+            }
+        }
+    }
+}
+
+void Rasterizer::processTiles()
+{
+    uint32_t index;
+    while ((index = m_nextTile++) < m_activeTiles.size()) {
+        processTile(m_activeTiles[index]);
+    }
+}
+
+void Rasterizer::processTile(uint32_t tile)
+{
+    uint32_t tileX = (tile % m_tilesX) * TILE_SIZE;
+    uint32_t tileY = (tile / m_tilesX) * TILE_SIZE;
+
+    auto x0 = static_cast<int32_t>(tileX);
+    auto y0 = static_cast<int32_t>(tileY);
+    auto x1 = static_cast<int32_t>((std::min)(tileX + TILE_SIZE, m_width)) - 1;
+    auto y1 = static_cast<int32_t>((std::min)(tileY + TILE_SIZE, m_height)) - 1;
+
+    for (auto index : m_bins[tile]) {
+        const Triangle& tri = m_triangles[index];
+        rasterize(tri, (std::max)(x0, tri.minX), (std::max)(y0, tri.minY),
+            (std::min)(x1, tri.maxX), (std::min)(y1, tri.maxY));
+    }
+}
+
+void Rasterizer::rasterize(
+    const Triangle& tri, int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+{
+    if (x0 > x1 || y0 > y1) {
+        return;
+    }
+
+    const DrawState& state = m_states[tri.state];
+    bool depthEnabled = state.zMode == C3D_EZMODE_TESTON_WRITEZ;
+
+    const __m128 lanes = _mm_set_ps(3, 2, 1, 0);
+    const __m128i laneIndex = _mm_set_epi32(3, 2, 1, 0);
+
+    alignas(16) float attr[ATTR_NUM][4];
+    alignas(16) uint32_t depth[4];
+
+    // spans start at a group of four pixels that is aligned to the tile, so
+    // the depth buffer reads stay inside of it
+    int32_t xs = x0 & ~3;
+
+    for (int32_t y = y0; y <= y1; y++) {
+        // classify the edges for this row: rows outside of an edge are
+        // skipped, edges that contain the entire row are ignored and only
+        // the remaining ones are evaluated per pixel, which keeps them in
+        // 32 bit range
+        __m128i edge[3];
+        __m128i edgeStep[3];
+        int edges = 0;
+        bool outside = false;
+
+        for (int i = 0; i < 3; i++) {
+            int64_t start = tri.a[i] * xs + tri.b[i] * y + tri.c[i];
+            int64_t end = start + tri.a[i] * (x1 - xs);
+
+            if (start < 0 && end < 0) {
+                outside = true;
+                break;
+            }
+
+            if (start >= 0 && end >= 0) {
+                continue;
+            }
+
+            auto e = static_cast<int32_t>(start);
+            auto a = static_cast<int32_t>(tri.a[i]);
+            edge[edges] = _mm_set_epi32(e + a * 3, e + a * 2, e + a, e);
+            edgeStep[edges] = _mm_set1_epi32(a * 4);
+            edges++;
+        }
+
+        if (outside) {
+            continue;
+        }
+
+        // attribute values at the start of the row
+        float row[ATTR_NUM];
+        for (int k = 0; k < ATTR_NUM; k++) {
+            row[k] = tri.attr[k] + tri.attrDy[k] * (y - tri.minY) +
+                     tri.attrDx[k] * (xs - tri.minX);
+        }
+
+        uint32_t* depthRow = &m_depth[y * m_stride];
+
+        for (int32_t x = xs; x <= x1; x += 4) {
+            // lanes outside of the span are masked out
+            __m128i mask = _mm_andnot_si128(
+                _mm_cmplt_epi32(laneIndex, _mm_set1_epi32(x0 - x)),
+                _mm_cmplt_epi32(laneIndex, _mm_set1_epi32(x1 - x + 1)));
+
+            for (int i = 0; i < edges; i++) {
+                mask = _mm_andnot_si128(_mm_srai_epi32(edge[i], 31), mask);
+                edge[i] = _mm_add_epi32(edge[i], edgeStep[i]);
+            }
+
+            if (!_mm_movemask_ps(_mm_castsi128_ps(mask))) {
+                continue;
+            }
+
+            __m128 offset = _mm_add_ps(lanes, _mm_set1_ps(float(x - xs)));
+
+            // quantize and test depth
+            __m128 z = _mm_add_ps(_mm_set1_ps(row[ATTR_Z]),
+                _mm_mul_ps(_mm_set1_ps(tri.attrDx[ATTR_Z]), offset));
+            __m128 zq = _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(DEPTH_SCALE)),
+                _mm_set1_ps(DEPTH_BIAS));
+            zq = _mm_min_ps(_mm_max_ps(zq, _mm_setzero_ps()),
+                _mm_set1_ps(float(DEPTH_MAX)));
+            __m128i zi = _mm_cvtps_epi32(zq);
+
+            if (depthEnabled) {
+                __m128i stored = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(depthRow + x));
+                mask = _mm_and_si128(
+                    mask, depthTest(state.zCmpFunc, zi, stored));
+            }
+
+            int bits = _mm_movemask_ps(_mm_castsi128_ps(mask));
+            if (!bits) {
+                continue;
+            }
+
+            _mm_store_si128(reinterpret_cast<__m128i*>(depth), zi);
+            for (int k = ATTR_S; k < ATTR_NUM; k++) {
+                __m128 value = _mm_add_ps(_mm_set1_ps(row[k]),
+                    _mm_mul_ps(_mm_set1_ps(tri.attrDx[k]), offset));
+                _mm_store_ps(attr[k], value);
+            }
+
+            for (int lane = 0; lane < 4; lane++) {
+                if (!(bits & (1 << lane))) {
+                    continue;
+                }
+
+                float fragment[ATTR_NUM];
+                for (int k = ATTR_S; k < ATTR_NUM; k++) {
+                    fragment[k] = attr[k][lane];
+                }
+
+                shade(tri, state, fragment, x + lane, y, depth[lane]);
+            }
+        }
+    }
+}
+
+void Rasterizer::shade(const Triangle& tri, const DrawState& state,
+    const float* fragment, int32_t x, int32_t y, uint32_t depth)
+{
+    float color[4] = {0, 0, 0, 0};
+
+    switch (state.shadeMode) {
+        case C3D_ESH_SOLID:
+            std::copy_n(state.solidColor, 4, color);
+            break;
+
+        case C3D_ESH_FLAT:
+            std::copy_n(tri.flatColor, 4, color);
+            break;
+
+        default:
+            // smooth shading, GLRenderer also uses the vertex colors if the
+            // shading is disabled for textured primitives
+            std::copy_n(fragment + ATTR_R, 4, color);
+            break;
+    }
+
+    if (state.tmapEn) {
+        // unbound textures read as opaque black, like in OpenGL
+        float texColor[4] = {0, 0, 0, 1};
+        uint32_t texel = 0xff000000;
+
+        float w = fragment[ATTR_W];
+        float u = fragment[ATTR_S] / w;
+        float v = fragment[ATTR_T] / w;
+
+        SoftwareTexture* texture = state.texture.get();
+        if (texture && state.texOp == C3D_ETEXOP_CHROMAKEY) {
+            texel = texture->fetch(u, v);
+        }
+
+        // discard fragment if texel matches chroma key
+        if (state.texOp == C3D_ETEXOP_CHROMAKEY &&
+            (texel & 0xffffff) == state.chromaKey) {
+            return;
+        }
+
+        if (texture) {
+            // the level of detail is only required if the filter for
+            // minification differs
+            const TextureFilter& filter = state.filter;
+            float lod = 0;
+            if (filter.mipmap || filter.magLinear != filter.minLinear) {
+                float dudx = (tri.attrDx[ATTR_S] - u * tri.attrDx[ATTR_W]) / w;
+                float dvdx = (tri.attrDx[ATTR_T] - v * tri.attrDx[ATTR_W]) / w;
+                float dudy = (tri.attrDy[ATTR_S] - u * tri.attrDy[ATTR_W]) / w;
+                float dvdy = (tri.attrDy[ATTR_T] - v * tri.attrDy[ATTR_W]) / w;
+                float width = static_cast<float>(texture->width());
+                float height = static_cast<float>(texture->height());
+                float rx = std::hypot(dudx * width, dvdx * height);
+                float ry = std::hypot(dudy * width, dvdy * height);
+                lod = std::log2((std::max)(rx, ry));
+            }
+
+            texture->sample(u, v, lod, filter, texColor);
+        }
+
+        switch (state.tmapLight) {
+            case C3D_ETL_NONE:
+                std::copy_n(texColor, 4, color);
+                break;
+
+            case C3D_ETL_MODULATE:
+                for (int i = 0; i < 4; i++) {
+                    color[i] *= texColor[i];
+                }
+                break;
+
+            case C3D_ETL_ALPHA_DECAL:
+                for (int i = 0; i < 3; i++) {
+                    color[i] = texColor[i] * texColor[3] +
+                               color[i] * (1 - texColor[3]);
+                }
+                color[3] = 1;
+                break;
+
+            default:
+                // invalid modes keep the shaded color, like in the shader
+                break;
+        }
+    }
+
+    uint32_t index = y * m_stride + x;
+
+    if (state.zMode == C3D_EZMODE_TESTON_WRITEZ) {
+        m_depth[index] = depth;
+    }
+
+    // replace the pixel if blending wouldn't change anything
+    if (state.alphaSrc == C3D_EASRC_ONE && state.alphaDst == C3D_EADST_ZERO) {
+        m_color[index] = packColor(color);
+        return;
+    }
+
+    // colors are clamped before blending in fixed point buffers
+    float src[4];
+    float dst[4];
+    for (int i = 0; i < 4; i++) {
+        src[i] = (std::min)((std::max)(color[i], 0.0f), 1.0f);
+        dst[i] = ((m_color[index] >> (i * 8)) & 0xff) / 255.0f;
+    }
+
+    float srcFactor[4];
+    float dstFactor[4];
+    blendFactor(state.alphaSrc, src, dst, srcFactor);
+    blendFactor(state.alphaDst, src, dst, dstFactor);
+
+    for (int i = 0; i < 4; i++) {
+        color[i] = src[i] * srcFactor[i] + dst[i] * dstFactor[i];
+    }
+
+    m_color[index] = packColor(color);
+}
+
+} // namespace cif
+} // namespace glrage
\ No newline at end of file
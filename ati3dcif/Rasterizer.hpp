@@ -0,0 +1,142 @@
+#pragma once
+
+#include "SoftwareTexture.hpp"
+#include "ati3dcif.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace glrage {
+namespace cif {
+
+// Triangle rasterizer of the software renderer. Triangles are binned into
+// screen tiles when they're added and rasterized by a pool of worker threads
+// on flush, where each tile processes its triangles in submission order. The
+// coverage, depth test and attribute interpolation are computed for four
+// pixels at once with SSE2.
+class Rasterizer
+{
+public:
+    // fragment state for the triangles that are added after it
+    struct DrawState
+    {
+        C3D_ESHADE shadeMode;
+        float solidColor[4];
+        bool tmapEn;
+        std::shared_ptr<SoftwareTexture> texture;
+        uint32_t chromaKey;
+        C3D_ETLIGHT tmapLight;
+        TextureFilter filter;
+        C3D_ETEXOP texOp;
+        C3D_EASRC alphaSrc;
+        C3D_EADST alphaDst;
+        C3D_EZCMP zCmpFunc;
+        C3D_EZMODE zMode;
+    };
+
+    Rasterizer(uint32_t threads);
+    ~Rasterizer();
+
+    // resizes and clears the buffers if the size has changed
+    void resize(uint32_t width, uint32_t height);
+    void clear();
+    void setState(const DrawState& state);
+    void addTriangle(const C3D_VTCF& v0, const C3D_VTCF& v1,
+        const C3D_VTCF& v2);
+    void flush();
+
+    uint32_t width();
+    uint32_t height();
+
+    // row length of the buffers in pixels
+    uint32_t stride();
+
+    // color buffer with 8-bit RGBA pixels in the byte order R, G, B, A, top
+    // row first
+    const uint32_t* colorBuffer();
+
+private:
+    static const uint32_t TILE_SIZE = 64;
+
+    // vertex coordinates are limited to this range, so the edge functions of
+    // a tile row fit into 32 bits
+    static const int32_t GUARD_BAND = 4096;
+
+    // triangles are flushed after this many to limit the memory usage
+    static const size_t MAX_TRIANGLES = 1 << 16;
+
+    enum Attribute
+    {
+        ATTR_Z,
+        ATTR_S,
+        ATTR_T,
+        ATTR_W,
+        ATTR_R,
+        ATTR_G,
+        ATTR_B,
+        ATTR_A,
+        ATTR_NUM
+    };
+
+    struct Triangle
+    {
+        // edge functions e = a * x + b * y + c for pixel x and y, which are
+        // positive inside the triangle
+        int64_t a[3];
+        int64_t b[3];
+        int64_t c[3];
+
+        // bounding box in pixels, inclusive
+        int32_t minX;
+        int32_t minY;
+        int32_t maxX;
+        int32_t maxY;
+
+        // attribute planes with the value at the center of the top left pixel
+        // of the bounding box and the gradients per pixel
+        float attr[ATTR_NUM];
+        float attrDx[ATTR_NUM];
+        float attrDy[ATTR_NUM];
+
+        float flatColor[4];
+        uint32_t state;
+    };
+
+    void workerProc();
+    void processTiles();
+    void processTile(uint32_t tile);
+    void rasterize(const Triangle& tri, int32_t x0, int32_t y0, int32_t x1,
+        int32_t y1);
+    void shade(const Triangle& tri, const DrawState& state,
+        const float* fragment, int32_t x, int32_t y, uint32_t depth);
+
+    uint32_t m_width{0};
+    uint32_t m_height{0};
+    uint32_t m_stride{0};
+    uint32_t m_tilesX{0};
+    uint32_t m_tilesY{0};
+    std::vector<uint32_t> m_color;
+    std::vector<uint32_t> m_depth;
+
+    std::vector<DrawState> m_states;
+    std::vector<Triangle> m_triangles;
+    std::vector<std::vector<uint32_t>> m_bins;
+    std::vector<uint32_t> m_activeTiles;
+    std::atomic<uint32_t> m_nextTile{0};
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_workCondition;
+    std::condition_variable m_doneCondition;
+    uint32_t m_generation{0};
+    uint32_t m_busy{0};
+    bool m_stop{false};
+};
+
+} // namespace cif
+} // namespace glrage
\ No newline at end of file
@@ -0,0 +1,299 @@
+#include "Recorder.hpp"
+#include "Utils.hpp"
+
+#include <glrage_util/ErrorUtils.hpp>
+#include <glrage_util/Logger.hpp>
+#include <glrage_util/StringUtils.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace glrage {
+namespace cif {
+
+Recorder::Recorder(const std::wstring& path)
+{
+    m_file.open(StringUtils::nativePath(path),
+        std::ios::binary | std::ios::trunc);
+    if (!m_file.good()) {
+        throw std::runtime_error(
+            "Can't open trace file: " + ErrorUtils::getSystemErrorString());
+    }
+
+    m_buffer.reserve(BUFFER_SIZE);
+
+    write(TRACE_MAGIC);
+    write(TRACE_VERSION);
+
+    LOG_INFO("Recording ATI3DCIF calls");
+}
+
+Recorder::~Recorder()
+{
+    flush();
+}
+
+void Recorder::init()
+{
+    op(TraceOp::Init);
+
+    // a new renderer starts with the default state
+    m_vertexType = C3D_EV_VTCF;
+}
+
+void Recorder::term()
+{
+    // end the last frame, so it's included in the replay
+    if (m_rendered) {
+        op(TraceOp::Frame);
+        m_rendered = false;
+    }
+
+    op(TraceOp::Term);
+    flush();
+}
+
+void Recorder::frame(int32_t width, int32_t height)
+{
+    // only mark frames that actually rendered something, the game may begin
+    // and end rendering several times per frame
+    if (m_rendered) {
+        op(TraceOp::Frame);
+        m_rendered = false;
+    }
+
+    if (width != m_width || height != m_height) {
+        m_width = width;
+        m_height = height;
+
+        op(TraceOp::DisplaySize);
+        write<uint32_t>(width);
+        write<uint32_t>(height);
+    }
+}
+
+void Recorder::textureReg(C3D_PTMAP tmap)
+{
+    // bits per texel of each format
+    uint32_t bits;
+    switch (tmap->eTexFormat) {
+        case C3D_ETF_CI4:
+            bits = 4;
+            break;
+        case C3D_ETF_CI8:
+        case C3D_ETF_RGB332:
+        case C3D_ETF_Y8:
+            bits = 8;
+            break;
+        case C3D_ETF_RGB8888:
+            bits = 32;
+            break;
+        default:
+            bits = 16;
+            break;
+    }
+
+    uint32_t width = 1 << tmap->u32MaxMapXSizeLg2;
+    uint32_t height = 1 << tmap->u32MaxMapYSizeLg2;
+
+    uint32_t levels = 1;
+    if (tmap->bMipMap) {
+        levels = (std::max)(tmap->u32MaxMapXSizeLg2,
+                     tmap->u32MaxMapYSizeLg2) + 1;
+    }
+
+    // write the level data before the renderer gets a chance to convert it
+    std::vector<uint32_t> blobs;
+    for (uint32_t level = 0; level < levels; level++) {
+        uint32_t size = (std::max)(width * height * bits / 8, 1u);
+        blobs.push_back(blob(tmap->apvLevels[level], size));
+
+        width = (std::max)(1u, width / 2);
+        height = (std::max)(1u, height / 2);
+    }
+
+    op(TraceOp::TextureReg);
+    write<uint32_t>(tmap->eTexFormat);
+    write<uint32_t>(tmap->u32MaxMapXSizeLg2);
+    write<uint32_t>(tmap->u32MaxMapYSizeLg2);
+    write<uint32_t>(tmap->bMipMap);
+    write(tmap->clrTexChromaKey);
+    write(static_cast<uint32_t>(
+        reinterpret_cast<uintptr_t>(tmap->htxpalTexPalette)));
+    write<uint32_t>(levels);
+    write(blobs.data(), blobs.size() * sizeof(uint32_t));
+}
+
+void Recorder::textureUnreg(C3D_HTX htx)
+{
+    op(TraceOp::TextureUnreg);
+    write(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(htx)));
+}
+
+void Recorder::texturePaletteCreate(C3D_ECI_TMAP_TYPE type, void* palette)
+{
+    uint32_t entries = 0;
+    if (type == C3D_ECI_TMAP_8BIT) {
+        entries = 256;
+    } else if (type == C3D_ECI_TMAP_4BIT_HI || type == C3D_ECI_TMAP_4BIT_LOW) {
+        entries = 16;
+    }
+
+    op(TraceOp::PaletteCreate);
+    write<uint32_t>(type);
+    write(entries);
+    write(palette, entries * sizeof(C3D_PALETTENTRY));
+}
+
+void Recorder::texturePaletteDestroy(C3D_HTXPAL htxpal)
+{
+    op(TraceOp::PaletteDestroy);
+    write(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(htxpal)));
+}
+
+void Recorder::texturePaletteAnimate(C3D_HTXPAL htxpal, C3D_UINT32 start,
+    C3D_UINT32 entries, C3D_PPALETTENTRY palette)
+{
+    op(TraceOp::PaletteAnimate);
+    write(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(htxpal)));
+    write<uint32_t>(start);
+    write<uint32_t>(entries);
+    write(palette, entries * sizeof(C3D_PALETTENTRY));
+}
+
+void Recorder::handle(void* handle)
+{
+    op(TraceOp::Handle);
+    write(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(handle)));
+}
+
+void Recorder::contextCreate()
+{
+    op(TraceOp::ContextCreate);
+}
+
+void Recorder::contextDestroy()
+{
+    op(TraceOp::ContextDestroy);
+}
+
+void Recorder::setState(C3D_ERSID id, C3D_PRSDATA data)
+{
+    if (id >= C3D_ERS_NUM) {
+        return;
+    }
+
+    if (id == C3D_ERS_VERTEX_TYPE) {
+        m_vertexType = *static_cast<C3D_EVERTEX*>(data);
+    }
+
+    uint32_t size = static_cast<uint32_t>(m_state.size(id));
+
+    op(TraceOp::SetState);
+    write<uint32_t>(id);
+    write(size);
+    write(data, size);
+}
+
+void Recorder::renderBegin()
+{
+    op(TraceOp::RenderBegin);
+}
+
+void Recorder::renderEnd()
+{
+    op(TraceOp::RenderEnd);
+}
+
+void Recorder::renderPrimStrip(C3D_VSTRIP vStrip, C3D_UINT32 numVert)
+{
+    uint32_t size = vertexSize();
+
+    op(TraceOp::PrimStrip);
+    write<uint32_t>(m_vertexType);
+    write<uint32_t>(numVert);
+    write(size);
+    write(vStrip, numVert * size);
+
+    m_rendered = true;
+}
+
+void Recorder::renderPrimList(C3D_VLIST vList, C3D_UINT32 numVert)
+{
+    uint32_t size = vertexSize();
+
+    op(TraceOp::PrimList);
+    write<uint32_t>(m_vertexType);
+    write<uint32_t>(numVert);
+    write(size);
+
+    // resolve the pointers, the replay rebuilds the list from the copies
+    auto vertices = reinterpret_cast<void**>(vList);
+    for (C3D_UINT32 i = 0; i < numVert; i++) {
+        write(vertices[i], size);
+    }
+
+    m_rendered = true;
+}
+
+void Recorder::flush()
+{
+    if (m_buffer.empty()) {
+        return;
+    }
+
+    m_file.write(reinterpret_cast<const char*>(m_buffer.data()),
+        m_buffer.size());
+    m_file.flush();
+    m_buffer.clear();
+}
+
+uint32_t Recorder::blob(const void* data, uint32_t size)
+{
+    // FNV-1a hash of the data, which is good enough to find duplicates
+    // together with the size
+    auto bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (uint32_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+
+    auto key = std::make_pair(hash, size);
+    auto it = m_blobs.find(key);
+    if (it != m_blobs.end()) {
+        return it->second;
+    }
+
+    uint32_t index = static_cast<uint32_t>(m_blobs.size());
+    m_blobs[key] = index;
+
+    op(TraceOp::Blob);
+    write(size);
+    write(data, size);
+
+    return index;
+}
+
+uint32_t Recorder::vertexSize()
+{
+    // unsupported vertex types have no size, so only the call is recorded
+    return static_cast<uint32_t>(Utils::vertexSize(m_vertexType));
+}
+
+void Recorder::op(TraceOp code)
+{
+    write(code);
+}
+
+void Recorder::write(const void* data, size_t size)
+{
+    auto bytes = static_cast<const uint8_t*>(data);
+    m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+
+    if (m_buffer.size() >= BUFFER_SIZE) {
+        flush();
+    }
+}
+
+} // namespace cif
+} // namespace glrage
\ No newline at end of file
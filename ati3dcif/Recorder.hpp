@@ -0,0 +1,69 @@
+#pragma once
+
+#include "State.hpp"
+#include "Trace.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace glrage {
+namespace cif {
+
+// Serializes ATI3DCIF calls into a trace file that can be replayed outside of
+// the game with the cifreplay tool. Calls are buffered in memory and written
+// in large chunks so recording doesn't stall the game on every call.
+class Recorder
+{
+public:
+    Recorder(const std::wstring& path);
+    ~Recorder();
+    void init();
+    void term();
+    void frame(int32_t width, int32_t height);
+    void textureReg(C3D_PTMAP tmap);
+    void textureUnreg(C3D_HTX htx);
+    void texturePaletteCreate(C3D_ECI_TMAP_TYPE type, void* palette);
+    void texturePaletteDestroy(C3D_HTXPAL htxpal);
+    void texturePaletteAnimate(C3D_HTXPAL htxpal, C3D_UINT32 start,
+        C3D_UINT32 entries, C3D_PPALETTENTRY palette);
+    void handle(void* handle);
+    void contextCreate();
+    void contextDestroy();
+    void setState(C3D_ERSID id, C3D_PRSDATA data);
+    void renderBegin();
+    void renderEnd();
+    void renderPrimStrip(C3D_VSTRIP vStrip, C3D_UINT32 numVert);
+    void renderPrimList(C3D_VLIST vList, C3D_UINT32 numVert);
+    void flush();
+
+private:
+    // size of the write buffer before it's flushed to the file
+    static const size_t BUFFER_SIZE = 1 << 20;
+
+    uint32_t blob(const void* data, uint32_t size);
+    uint32_t vertexSize();
+    void op(TraceOp code);
+    void write(const void* data, size_t size);
+
+    template <typename T>
+    void write(const T& value)
+    {
+        write(&value, sizeof(T));
+    }
+
+    std::ofstream m_file;
+    std::vector<uint8_t> m_buffer;
+    std::map<std::pair<uint64_t, uint32_t>, uint32_t> m_blobs;
+    State m_state;
+    C3D_EVERTEX m_vertexType{C3D_EV_VTCF};
+    int32_t m_width{0};
+    int32_t m_height{0};
+    bool m_rendered{false};
+};
+
+} // namespace cif
+} // namespace glrage
\ No newline at end of file
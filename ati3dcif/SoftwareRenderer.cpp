@@ -0,0 +1,379 @@
+#include "SoftwareRenderer.hpp"
+#include "Error.hpp"
+#include "Utils.hpp"
+#include "VertexStream.hpp"
+
+#include <glrage_gl/Utils.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+namespace glrage {
+namespace cif {
+
+using std::placeholders::_1;
+
+SoftwareRenderer::SoftwareRenderer()
+    : m_frameTexture(GL_TEXTURE_2D)
+{
+    // the rasterizer gets a new fragment state after any state change
+    m_state.registerObserver(
+        [this](StateVar::Value& value) { m_stateChanged = true; });
+    m_state.registerObserver(
+        std::bind(&SoftwareRenderer::tmapSelect, this, _1),
+        C3D_ERS_TMAP_SELECT);
+
+    // use all cores by default
+    int32_t threads = m_config.getInt("ati3dcif.software_threads", 0);
+    if (threads <= 0) {
+        threads = (std::max)(std::thread::hardware_concurrency(), 1u);
+    }
+
+    m_rasterizer = std::make_unique<Rasterizer>(threads);
+
+    glGenFramebuffers(1, &m_framebuffer);
+
+    // apply default state
+    resetState();
+
+    gl::Utils::checkError(__FUNCTION__);
+}
+
+SoftwareRenderer::~SoftwareRenderer()
+{
+    glDeleteFramebuffers(1, &m_framebuffer);
+}
+
+void SoftwareRenderer::renderBegin(C3D_HRC hRC)
+{
+    auto width = m_context.getDisplayWidth();
+    auto height = m_context.getDisplayHeight();
+    m_rasterizer->resize(width, height);
+
+    // lines and points are one display pixel wide, but at least one pixel
+    // of the window, like in GLRenderer
+    auto windowWidth = static_cast<float>(m_context.getWindowWidth());
+    auto windowHeight = static_cast<float>(m_context.getWindowHeight());
+    m_lineWidth = 1;
+    if (windowWidth > 0 && windowHeight > 0) {
+        m_lineWidth = (std::max)(m_lineWidth, (std::max)(width / windowWidth,
+                                                  height / windowHeight));
+    }
+
+    // the OpenGL framebuffer is cleared after each buffer swap, so start a new
+    // frame with the first render block after it
+    if (!m_context.isRendered()) {
+        m_rasterizer->clear();
+    }
+}
+
+void SoftwareRenderer::renderEnd()
+{
+    m_rasterizer->flush();
+    present();
+}
+
+void SoftwareRenderer::textureReg(C3D_PTMAP ptmapToReg, C3D_PHTX phtmap)
+{
+    auto texture = std::make_shared<SoftwareTexture>();
+    texture->load(ptmapToReg, m_palettes[ptmapToReg->htxpalTexPalette]);
+
+    *phtmap = reinterpret_cast<C3D_HTX>(++m_textureID);
+
+    m_textures[*phtmap] = texture;
+}
+
+void SoftwareRenderer::textureUnreg(C3D_HTX htxToUnreg)
+{
+    auto it = m_textures.find(htxToUnreg);
+    if (it == m_textures.end()) {
+        throw Error("Invalid texture handle", C3D_EC_BADPARAM);
+    }
+
+    // unbind texture if currently bound
+    if (htxToUnreg == m_state.get(C3D_ERS_TMAP_SELECT).htx) {
+        m_state.set(C3D_ERS_TMAP_SELECT, StateVar::Value{0});
+    }
+
+    // pending triangles keep their own reference to the texture
+    m_textures.erase(it);
+}
+
+void SoftwareRenderer::texturePaletteCreate(
+    C3D_ECI_TMAP_TYPE epalette, void* pPalette, C3D_PHTXPAL phtpalCreated)
+{
+    if (epalette != C3D_ECI_TMAP_8BIT) {
+        throw Error("Unsupported palette type: " +
+                        std::string(C3D_ECI_TMAP_TYPE_NAMES[epalette]),
+            C3D_EC_NOTIMPYET);
+    }
+
+    auto palettePtr = static_cast<C3D_PPALETTENTRY>(pPalette);
+    std::vector<C3D_PALETTENTRY> palette(palettePtr, palettePtr + 256);
+
+    auto handle = reinterpret_cast<C3D_HTXPAL>(m_paletteID++);
+    m_palettes[handle] = palette;
+
+    *phtpalCreated = handle;
+}
+
+void SoftwareRenderer::texturePaletteDestroy(C3D_HTXPAL htxpalToDestroy)
+{
+    m_palettes.erase(htxpalToDestroy);
+}
+
+void SoftwareRenderer::texturePaletteAnimate(C3D_HTXPAL htxpalToAnimate,
+    C3D_UINT32 u32StartIndex, C3D_UINT32 u32NumEntries,
+    C3D_PPALETTENTRY pclrPalette)
+{
+    throw Error(std::string(__FUNCTION__) + ": Not implemented",
+        C3D_EC_NOTIMPYET);
+}
+
+void SoftwareRenderer::renderPrimStrip(
+    C3D_VSTRIP vStrip, C3D_UINT32 u32NumVert)
+{
+    m_context.setRendered();
+    updateState();
+
+    auto vertices = reinterpret_cast<C3D_VTCF*>(vStrip);
+    C3D_EPRIM primType = m_state.get(C3D_ERS_PRIM_TYPE).eprim;
+
+    if (primType == C3D_EPRIM_QUAD) {
+        throw Error("Unsupported primitive type for strips: " +
+                        std::string(C3D_EPRIM_NAMES[primType]),
+            C3D_EC_NOTIMPYET);
+    }
+
+    if (primType == C3D_EPRIM_LINE) {
+        // connected lines
+        for (C3D_UINT32 i = 1; i < u32NumVert; i++) {
+            m_primBuffer.push_back(vertices[i - 1]);
+            m_primBuffer.push_back(vertices[i]);
+        }
+        addExpanded(primType);
+        return;
+    }
+
+    // points and rectangles don't share any vertices
+    if (primType == C3D_EPRIM_POINT || primType == C3D_EPRIM_RECT) {
+        m_primBuffer.assign(vertices, vertices + u32NumVert);
+        addExpanded(primType);
+        return;
+    }
+
+    for (C3D_UINT32 i = 2; i < u32NumVert; i++) {
+        m_rasterizer->addTriangle(
+            vertices[i - 2], vertices[i - 1], vertices[i]);
+    }
+}
+
+void SoftwareRenderer::renderPrimList(C3D_VLIST vList, C3D_UINT32 u32NumVert)
+{
+    m_context.setRendered();
+    updateState();
+
+    auto vertices = reinterpret_cast<C3D_VTCF**>(vList);
+    C3D_EPRIM primType = m_state.get(C3D_ERS_PRIM_TYPE).eprim;
+
+    if (primType == C3D_EPRIM_LINE || primType == C3D_EPRIM_POINT ||
+        primType == C3D_EPRIM_RECT) {
+        for (C3D_UINT32 i = 0; i < u32NumVert; i++) {
+            m_primBuffer.push_back(*vertices[i]);
+        }
+        addExpanded(primType);
+    } else if (primType == C3D_EPRIM_QUAD) {
+        for (C3D_UINT32 i = 0; i + 3 < u32NumVert; i += 4) {
+            m_rasterizer->addTriangle(
+                *vertices[i + 0], *vertices[i + 1], *vertices[i + 3]);
+            m_rasterizer->addTriangle(
+                *vertices[i + 1], *vertices[i + 2], *vertices[i + 3]);
+        }
+    } else {
+        for (C3D_UINT32 i = 0; i + 2 < u32NumVert; i += 3) {
+            m_rasterizer->addTriangle(
+                *vertices[i + 0], *vertices[i + 1], *vertices[i + 2]);
+        }
+    }
+}
+
+void SoftwareRenderer::renderRects(const std::vector<Overlay::Rect>& rects)
+{
+    // overlay colors are palette indices of the game, which always uses the
+    // palette it created last
+    if (rects.empty() || m_palettes.empty()) {
+        return;
+    }
+
+    m_context.setRendered();
+
+    // draw untextured on top of everything rendered so far
+    Rasterizer::DrawState state{};
+    state.shadeMode = C3D_ESH_SMOOTH;
+    state.tmapEn = false;
+    state.chromaKey = 0;
+    state.tmapLight = C3D_ETL_NONE;
+    state.filter = SOFTWARE_TEXTURE_FILTER[C3D_ETFILT_MINPNT_MAGPNT];
+    state.texOp = C3D_ETEXOP_NONE;
+    state.alphaSrc = C3D_EASRC_ONE;
+    state.alphaDst = C3D_EADST_ZERO;
+    state.zCmpFunc = C3D_EZCMP_ALWAYS;
+    state.zMode = C3D_EZMODE_OFF;
+    m_rasterizer->setState(state);
+
+    auto& palette = m_palettes.rbegin()->second;
+    for (auto& rect : rects) {
+        C3D_VTCF corners[2];
+        Utils::rectVertices(rect, palette, corners);
+        m_primBuffer.push_back(corners[0]);
+        m_primBuffer.push_back(corners[1]);
+    }
+    addExpanded(C3D_EPRIM_RECT);
+
+    // the next primitive needs the current state again
+    m_stateChanged = true;
+}
+
+void SoftwareRenderer::setState(C3D_ERSID eRStateID, C3D_PRSDATA pRStateData)
+{
+    m_state.set(eRStateID, pRStateData);
+}
+
+void SoftwareRenderer::resetState()
+{
+    m_state.reset();
+}
+
+void SoftwareRenderer::tmapSelect(StateVar::Value& value)
+{
+    if (value.htx && m_textures.find(value.htx) == m_textures.end()) {
+        throw Error("Invalid texture handle", C3D_EC_BADPARAM);
+    }
+}
+
+void SoftwareRenderer::addExpanded(C3D_EPRIM primType)
+{
+    m_expandBuffer.clear();
+    VertexStream::expandPrimitives(
+        primType, m_lineWidth, m_primBuffer, m_expandBuffer);
+    m_primBuffer.clear();
+
+    for (size_t i = 0; i + 2 < m_expandBuffer.size(); i += 3) {
+        m_rasterizer->addTriangle(
+            m_expandBuffer[i], m_expandBuffer[i + 1], m_expandBuffer[i + 2]);
+    }
+}
+
+void SoftwareRenderer::updateState()
+{
+    // only C3D_VTCF is supported, like in GLRenderer
+    C3D_EVERTEX vertexType = m_state.get(C3D_ERS_VERTEX_TYPE).evertex;
+    if (vertexType != C3D_EV_VTCF) {
+        throw Error("Unsupported vertex type: " +
+                        std::string(C3D_EVERTEX_NAMES[vertexType]),
+            C3D_EC_NOTIMPYET);
+    }
+
+    if (!m_stateChanged) {
+        return;
+    }
+
+    Rasterizer::DrawState state;
+    state.shadeMode = m_state.get(C3D_ERS_SHADE_MODE).eshade;
+
+    C3D_COLOR solid = m_state.get(C3D_ERS_SOLID_CLR).color;
+    state.solidColor[0] = solid.r / 255.0f;
+    state.solidColor[1] = solid.g / 255.0f;
+    state.solidColor[2] = solid.b / 255.0f;
+    state.solidColor[3] = solid.a / 255.0f;
+
+    // C3D_FALSE isn't zero in ati3dcif.hpp, so test the value like GLRenderer
+    state.tmapEn = m_state.get(C3D_ERS_TMAP_EN).boolean != 0;
+
+    auto it = m_textures.find(m_state.get(C3D_ERS_TMAP_SELECT).htx);
+    state.chromaKey = 0;
+    if (it != m_textures.end()) {
+        state.texture = it->second;
+        C3D_COLOR& ck = state.texture->chromaKey();
+        state.chromaKey = ck.r | (ck.g << 8) | (ck.b << 16);
+    }
+
+    state.tmapLight = m_state.get(C3D_ERS_TMAP_LIGHT).etlight;
+
+    C3D_ETEXFILTER filter = m_state.get(C3D_ERS_TMAP_FILTER).etexfilter;
+    if (filter >= C3D_ETFILT_NUM) {
+        filter = C3D_ETFILT_MINPNT_MAGPNT;
+    }
+    state.filter = SOFTWARE_TEXTURE_FILTER[filter];
+
+    state.texOp = m_state.get(C3D_ERS_TMAP_TEXOP).etexop;
+    state.alphaSrc = m_state.get(C3D_ERS_ALPHA_SRC).easrc;
+    state.alphaDst = m_state.get(C3D_ERS_ALPHA_DST).eadst;
+
+    // invalid compare functions are ignored, like in GLRenderer
+    C3D_EZCMP zCmpFunc = m_state.get(C3D_ERS_Z_CMP_FNC).ezcmp;
+    if (zCmpFunc < C3D_EZCMP_MAX) {
+        m_zCmpFunc = zCmpFunc;
+    }
+    state.zCmpFunc = m_zCmpFunc;
+    state.zMode = m_state.get(C3D_ERS_Z_MODE).ezmode;
+
+    m_rasterizer->setState(state);
+    m_stateChanged = false;
+}
+
+void SoftwareRenderer::present()
+{
+    uint32_t width = m_rasterizer->width();
+    uint32_t height = m_rasterizer->height();
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    TRACE_SCOPE(__FUNCTION__);
+
+    GLint texture;
+    GLint readFramebuffer;
+    GLint viewport[4];
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    // upload frame
+    m_frameTexture.bind();
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, m_rasterizer->stride());
+
+    if (width != m_frameWidth || height != m_frameHeight) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA,
+            GL_UNSIGNED_BYTE, m_rasterizer->colorBuffer());
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+            GL_TEXTURE_2D, m_frameTexture.id(), 0);
+        m_frameWidth = width;
+        m_frameHeight = height;
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA,
+            GL_UNSIGNED_BYTE, m_rasterizer->colorBuffer());
+    }
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    // copy to the viewport of the current framebuffer, the rows of the frame
+    // are stored top to bottom
+    bool scaled = static_cast<uint32_t>(viewport[2]) != width ||
+                  static_cast<uint32_t>(viewport[3]) != height;
+    glBlitFramebuffer(0, 0, width, height, viewport[0],
+        viewport[1] + viewport[3], viewport[0] + viewport[2], viewport[1],
+        GL_COLOR_BUFFER_BIT, scaled ? GL_LINEAR : GL_NEAREST);
+
+    // restore bindings
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    gl::Utils::checkError(__FUNCTION__);
+}
+
+} // namespace cif
+} // namespace glrage
\ No newline at end of file
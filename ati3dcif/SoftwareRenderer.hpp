@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Rasterizer.hpp"
+#include "Renderer.hpp"
+#include "SoftwareTexture.hpp"
+#include "State.hpp"
+
+#include <glrage/GLRage.hpp>
+#include <glrage_gl/Texture.hpp>
+#include <glrage_util/Config.hpp>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace glrage {
+namespace cif {
+
+// Renders on the CPU with the same results as GLRenderer, which is useful on
+// machines without a GPU and as a reference for the OpenGL renderer. The
+// frame is copied to the OpenGL framebuffer after each render block, so
+// screenshots and frame captures work the same with both renderers.
+class SoftwareRenderer : public Renderer
+{
+public:
+    SoftwareRenderer();
+    ~SoftwareRenderer();
+    void renderBegin(C3D_HRC) override;
+    void renderEnd() override;
+    void textureReg(C3D_PTMAP, C3D_PHTX) override;
+    void textureUnreg(C3D_HTX) override;
+    void texturePaletteCreate(C3D_ECI_TMAP_TYPE, void*, C3D_PHTXPAL) override;
+    void texturePaletteDestroy(C3D_HTXPAL) override;
+    void texturePaletteAnimate(
+        C3D_HTXPAL, C3D_UINT32, C3D_UINT32, C3D_PPALETTENTRY) override;
+    void renderPrimStrip(C3D_VSTRIP, C3D_UINT32) override;
+    void renderPrimList(C3D_VLIST, C3D_UINT32) override;
+    void renderRects(const std::vector<Overlay::Rect>& rects) override;
+    void setState(C3D_ERSID eRStateID, C3D_PRSDATA pRStateData) override;
+    void resetState() override;
+
+private:
+    void tmapSelect(StateVar::Value& value);
+    void addExpanded(C3D_EPRIM primType);
+    void updateState();
+    void present();
+
+    Context& m_context{GLRage::getContext()};
+    Config& m_config{GLRage::getConfig()};
+    std::map<C3D_HTX, std::shared_ptr<SoftwareTexture>> m_textures;
+    std::map<C3D_HTXPAL, std::vector<C3D_PALETTENTRY>> m_palettes;
+    int32_t m_paletteID{0};
+    uint32_t m_textureID{0};
+    State m_state;
+    bool m_stateChanged{true};
+    C3D_EZCMP m_zCmpFunc{C3D_EZCMP_ALWAYS};
+    std::unique_ptr<Rasterizer> m_rasterizer;
+
+    // lines, points and rectangles are collected here and expanded to
+    // triangles by VertexStream, like in GLRenderer
+    float m_lineWidth{1};
+    std::vector<C3D_VTCF> m_primBuffer;
+    std::vector<C3D_VTCF> m_expandBuffer;
+
+    // texture and framebuffer for the copy to the OpenGL framebuffer
+    gl::Texture m_frameTexture;
+    GLuint m_framebuffer{0};
+    uint32_t m_frameWidth{0};
+    uint32_t m_frameHeight{0};
+};
+
+} // namespace cif
+} // namespace glrage
\ No newline at end of file
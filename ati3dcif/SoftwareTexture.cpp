@@ -0,0 +1,311 @@
+#include "SoftwareTexture.hpp"
+#include "Error.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace glrage {
+namespace cif {
+
+namespace {
+
+uint32_t pack(uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+{
+    return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+// expand color channels to 8 bits by repeating the high bits
+uint32_t expand2(uint32_t c)
+{
+    return c * 0x55;
+}
+
+uint32_t expand3(uint32_t c)
+{
+    return (c << 5) | (c << 2) | (c >> 1);
+}
+
+uint32_t expand4(uint32_t c)
+{
+    return c * 0x11;
+}
+
+uint32_t expand5(uint32_t c)
+{
+    return (c << 3) | (c >> 2);
+}
+
+uint32_t expand6(uint32_t c)
+{
+    return (c << 2) | (c >> 4);
+}
+
+// wraps a texture coordinate to [0, 1), which also keeps the texel indices
+// in range for huge coordinates
+float wrap(float c)
+{
+    if (!std::isfinite(c)) {
+        return 0;
+    }
+    return c - std::floor(c);
+}
+
+} // namespace
+
+void SoftwareTexture::load(
+    C3D_PTMAP tmap, std::vector<C3D_PALETTENTRY>& palette)
+{
+    m_chromaKey = tmap->clrTexChromaKey;
+    m_levels.clear();
+
+    uint32_t width = 1 << tmap->u32MaxMapXSizeLg2;
+    uint32_t height = 1 << tmap->u32MaxMapYSizeLg2;
+    uint32_t size = width * height;
+
+    uint32_t levels = 1;
+    if (tmap->bMipMap) {
+        levels =
+            (std::max)(tmap->u32MaxMapXSizeLg2, tmap->u32MaxMapYSizeLg2) + 1;
+    }
+
+    // the formats are decoded the same way as they're passed to OpenGL by
+    // GLRenderer, so both renderers produce the same colors
+    for (uint32_t level = 0; level < levels; level++) {
+        Level dst{width, height, std::vector<uint32_t>(size)};
+        auto& texels = dst.texels;
+
+        switch (tmap->eTexFormat) {
+            case C3D_ETF_RGB1555: {
+                auto src = static_cast<uint16_t*>(tmap->apvLevels[level]);
+                for (uint32_t i = 0; i < size; i++) {
+                    uint32_t c = src[i];
+                    // the alpha bit has the opposite meaning in OpenGL
+                    texels[i] = pack(expand5((c >> 10) & 0x1f),
+                        expand5((c >> 5) & 0x1f), expand5(c & 0x1f),
+                        c & 0x8000 ? 0 : 0xff);
+                }
+                break;
+            }
+
+            case C3D_ETF_RGB332: {
+                auto src = static_cast<uint8_t*>(tmap->apvLevels[level]);
+                for (uint32_t i = 0; i < size; i++) {
+                    uint32_t c = src[i];
+                    texels[i] = pack(expand3(c >> 5), expand3((c >> 2) & 0x7),
+                        expand2(c & 0x3), 0xff);
+                }
+                break;
+            }
+
+            case C3D_ETF_RGB565: {
+                auto src = static_cast<uint16_t*>(tmap->apvLevels[level]);
+                for (uint32_t i = 0; i < size; i++) {
+                    uint32_t c = src[i];
+                    texels[i] = pack(expand5(c & 0x1f),
+                        expand6((c >> 5) & 0x3f), expand5(c >> 11), 0xff);
+                }
+                break;
+            }
+
+            case C3D_ETF_RGB4444: {
+                auto src = static_cast<uint16_t*>(tmap->apvLevels[level]);
+                for (uint32_t i = 0; i < size; i++) {
+                    uint32_t c = src[i];
+                    texels[i] = pack(expand4((c >> 8) & 0xf),
+                        expand4((c >> 4) & 0xf), expand4(c & 0xf),
+                        expand4(c >> 12));
+                }
+                break;
+            }
+
+            case C3D_ETF_CI8: {
+                if (palette.size() < 256) {
+                    throw Error("Invalid palette handle", C3D_EC_BADPARAM);
+                }
+
+                auto src = static_cast<uint8_t*>(tmap->apvLevels[level]);
+                for (uint32_t i = 0; i < size; i++) {
+                    C3D_PALETTENTRY c = palette[src[i]];
+                    texels[i] = pack(c.r, c.g, c.b, 0xff);
+                }
+                break;
+            }
+
+            default:
+                throw Error(
+                    "Unsupported texture format: " +
+                        std::string(C3D_ETEXFMT_NAMES[tmap->eTexFormat]),
+                    C3D_EC_NOTIMPYET);
+        }
+
+        m_levels.push_back(std::move(dst));
+
+        width = (std::max)(1u, width / 2);
+        height = (std::max)(1u, height / 2);
+        size = width * height;
+    }
+
+    // generate mipmaps if the application doesn't provide any
+    if (levels == 1) {
+        generateMipmaps();
+    }
+}
+
+C3D_COLOR& SoftwareTexture::chromaKey()
+{
+    return m_chromaKey;
+}
+
+uint32_t SoftwareTexture::width()
+{
+    return m_levels[0].width;
+}
+
+uint32_t SoftwareTexture::height()
+{
+    return m_levels[0].height;
+}
+
+uint32_t SoftwareTexture::fetch(float u, float v)
+{
+    const Level& level = m_levels[0];
+
+    // same as int(u * size) % size in the shader
+    auto x = static_cast<int32_t>(std::fmod(u * level.width, level.width));
+    auto y = static_cast<int32_t>(std::fmod(v * level.height, level.height));
+    x &= level.width - 1;
+    y &= level.height - 1;
+
+    return level.texels[y * level.width + x];
+}
+
+void SoftwareTexture::sample(
+    float u, float v, float lod, const TextureFilter& filter, float* rgba)
+{
+    u = wrap(u);
+    v = wrap(v);
+
+    // magnification, which is also used for an undefined level of detail
+    if (!(lod > 0)) {
+        sampleLevel(m_levels[0], u, v, filter.magLinear, rgba);
+        return;
+    }
+
+    if (!filter.mipmap) {
+        sampleLevel(m_levels[0], u, v, filter.minLinear, rgba);
+        return;
+    }
+
+    auto maxLevel = static_cast<uint32_t>(m_levels.size() - 1);
+    lod = (std::min)(lod, static_cast<float>(maxLevel));
+
+    // pick the nearest level like GL_*_MIPMAP_NEAREST
+    if (!filter.mipLinear) {
+        uint32_t level = 0;
+        if (lod > 0.5f) {
+            level = static_cast<uint32_t>(std::ceil(lod + 0.5f)) - 1;
+        }
+        level = (std::min)(level, maxLevel);
+        sampleLevel(m_levels[level], u, v, filter.minLinear, rgba);
+        return;
+    }
+
+    // blend between the two nearest levels like GL_*_MIPMAP_LINEAR
+    auto level = static_cast<uint32_t>(lod);
+    float frac = lod - level;
+    sampleLevel(m_levels[level], u, v, filter.minLinear, rgba);
+
+    if (level < maxLevel && frac > 0) {
+        float rgba1[4];
+        sampleLevel(m_levels[level + 1], u, v, filter.minLinear, rgba1);
+        for (int i = 0; i < 4; i++) {
+            rgba[i] += (rgba1[i] - rgba[i]) * frac;
+        }
+    }
+}
+
+void SoftwareTexture::generateMipmaps()
+{
+    while (m_levels.back().width > 1 || m_levels.back().height > 1) {
+        const Level& src = m_levels.back();
+
+        Level dst;
+        dst.width = (std::max)(1u, src.width / 2);
+        dst.height = (std::max)(1u, src.height / 2);
+        dst.texels.resize(dst.width * dst.height);
+
+        // average 2x2 texels, or 2x1 if one dimension is already down to one
+        uint32_t dx = src.width > 1 ? 1 : 0;
+        uint32_t dy = src.height > 1 ? src.width : 0;
+
+        for (uint32_t y = 0; y < dst.height; y++) {
+            for (uint32_t x = 0; x < dst.width; x++) {
+                uint32_t i = (y * (dy ? 2 : 1)) * src.width + x * (dx ? 2 : 1);
+                uint32_t t[4] = {src.texels[i], src.texels[i + dx],
+                    src.texels[i + dy], src.texels[i + dx + dy]};
+
+                uint32_t texel = 0;
+                for (uint32_t c = 0; c < 32; c += 8) {
+                    uint32_t sum = ((t[0] >> c) & 0xff) + ((t[1] >> c) & 0xff) +
+                                   ((t[2] >> c) & 0xff) + ((t[3] >> c) & 0xff);
+                    texel |= ((sum + 2) / 4) << c;
+                }
+                dst.texels[y * dst.width + x] = texel;
+            }
+        }
+
+        m_levels.push_back(std::move(dst));
+    }
+}
+
+void SoftwareTexture::sampleLevel(
+    const Level& level, float u, float v, bool linear, float* rgba)
+{
+    uint32_t maskX = level.width - 1;
+    uint32_t maskY = level.height - 1;
+
+    if (!linear) {
+        auto x = static_cast<uint32_t>(u * level.width) & maskX;
+        auto y = static_cast<uint32_t>(v * level.height) & maskY;
+        uint32_t texel = level.texels[y * level.width + x];
+        for (int i = 0; i < 4; i++) {
+            rgba[i] = ((texel >> (i * 8)) & 0xff) / 255.0f;
+        }
+        return;
+    }
+
+    float fx = u * level.width - 0.5f;
+    float fy = v * level.height - 0.5f;
+    float x0f = std::floor(fx);
+    float y0f = std::floor(fy);
+    float ax = fx - x0f;
+    float ay = fy - y0f;
+
+    auto x0 = static_cast<int32_t>(x0f);
+    auto y0 = static_cast<int32_t>(y0f);
+    uint32_t x1 = (x0 + 1) & maskX;
+    uint32_t y1 = (y0 + 1) & maskY;
+    x0 &= maskX;
+    y0 &= maskY;
+
+    uint32_t t00 = level.texels[y0 * level.width + x0];
+    uint32_t t10 = level.texels[y0 * level.width + x1];
+    uint32_t t01 = level.texels[y1 * level.width + x0];
+    uint32_t t11 = level.texels[y1 * level.width + x1];
+
+    for (int i = 0; i < 4; i++) {
+        uint32_t shift = i * 8;
+        float c00 = (t00 >> shift) & 0xff;
+        float c10 = (t10 >> shift) & 0xff;
+        float c01 = (t01 >> shift) & 0xff;
+        float c11 = (t11 >> shift) & 0xff;
+        float top = c00 + (c10 - c00) * ax;
+        float bottom = c01 + (c11 - c01) * ax;
+        rgba[i] = (top + (bottom - top) * ay) / 255.0f;
+    }
+}
+
+} // namespace cif
+} // namespace glrage
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "ati3dcif.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace glrage {
+namespace cif {
+
+// texture filter of the software renderer, equivalent to the OpenGL sampler
+// parameters used by GLRenderer
+struct TextureFilter
+{
+    bool magLinear;
+    bool minLinear;
+    bool mipmap;
+    bool mipLinear;
+};
+
+static const TextureFilter SOFTWARE_TEXTURE_FILTER[] = {
+    {false, false, false, false}, // C3D_ETFILT_MINPNT_MAGPNT
+    {false, true, false, false},  // C3D_ETFILT_MINPNT_MAG2BY2
+    {true, true, false, false},   // C3D_ETFILT_MIN2BY2_MAG2BY2
+    {false, true, true, true},    // C3D_ETFILT_MIPLIN_MAGPNT
+    {true, true, true, false},    // C3D_ETFILT_MIPLIN_MAG2BY2
+    {true, true, true, true},     // C3D_ETFILT_MIPTRI_MAG2BY2
+    {false, false, false, false}  // C3D_ETFILT_MIN2BY2_MAGPNT
+};
+
+// Texture of the software renderer, stored as 8-bit RGBA levels in the byte
+// order R, G, B, A. Coordinates wrap around like GL_REPEAT.
+class SoftwareTexture
+{
+public:
+    void load(C3D_PTMAP tmap, std::vector<C3D_PALETTENTRY>& palette);
+    C3D_COLOR& chromaKey();
+    uint32_t width();
+    uint32_t height();
+
+    // returns the raw texel of the first level, like texelFetch()
+    uint32_t fetch(float u, float v);
+
+    // samples the texture for the given level of detail and writes the
+    // normalized color to rgba
+    void sample(float u, float v, float lod, const TextureFilter& filter,
+        float* rgba);
+
+private:
+    struct Level
+    {
+        uint32_t width;
+        uint32_t height;
+        std::vector<uint32_t> texels;
+    };
+
+    void generateMipmaps();
+    void sampleLevel(
+        const Level& level, float u, float v, bool linear, float* rgba);
+
+    std::vector<Level> m_levels;
+    C3D_COLOR m_chromaKey;
+};
+
+} // namespace cif
+} // namespace glrage
\ No newline at end of file
@@ -63,6 +63,11 @@ void State::set(C3D_ERSID id, const StateVar::Value& value)
     m_vars[id].set(value);
 }
 
+size_t State::size(C3D_ERSID id)
+{
+    return m_vars[id].size();
+}
+
 void State::reset()
 {
     for (auto& var : m_vars) {
@@ -14,6 +14,7 @@ public:
     void set(C3D_ERSID id, C3D_PRSDATA data);
     const StateVar::Value& get(C3D_ERSID id);
     void set(C3D_ERSID id, const StateVar::Value& value);
+    size_t size(C3D_ERSID id);
     void reset();
     void registerObserver(const StateVar::Observer& observer);
     void registerObserver(const StateVar::Observer& observer, C3D_ERSID id);
@@ -23,6 +23,11 @@ const StateVar::Value& StateVar::get()
     return m_value;
 }
 
+size_t StateVar::size()
+{
+    return m_size;
+}
+
 void StateVar::reset()
 {
     m_value = m_valueDefault;
@@ -58,6 +58,7 @@ public:
     void set(C3D_PRSDATA pRStateData);
     void set(const Value& value);
     const Value& get();
+    size_t size();
     void reset();
     void registerObserver(const Observer& observer);
 
@@ -12,6 +12,108 @@
 namespace glrage {
 namespace cif {
 
+namespace {
+
+// calls func with the index of each of the eight neighbors of a texel, which
+// wrap around the edges like in the sampler
+template <typename Func>
+void forEachNeighbor(uint32_t i, uint32_t width, uint32_t height, Func func)
+{
+    uint32_t x = i % width;
+    uint32_t y = i / width;
+
+    for (uint32_t dy = height - 1; dy <= height + 1; dy++) {
+        for (uint32_t dx = width - 1; dx <= width + 1; dx++) {
+            if (dx != width || dy != height) {
+                func(((y + dy) % height) * width + (x + dx) % width);
+            }
+        }
+    }
+}
+
+// Sets the alpha of all texels that match the chroma key to zero and replaces
+// their color with the average of the opaque neighbors, so filtering doesn't
+// blend the key color into the edges. Returns false if no texel matches.
+bool bakeChromaKey(std::vector<uint8_t>& texels, uint32_t width,
+    uint32_t height, const C3D_COLOR& key)
+{
+    uint32_t size = width * height;
+
+    std::vector<bool> filled(size, true);
+    bool keyed = false;
+    for (uint32_t i = 0; i < size; i++) {
+        uint8_t* texel = &texels[i * 4];
+        if (texel[0] == key.r && texel[1] == key.g && texel[2] == key.b) {
+            texel[3] = 0;
+            filled[i] = false;
+            keyed = true;
+        }
+    }
+
+    if (!keyed) {
+        return false;
+    }
+
+    // fill the colors from the opaque texels inwards, one layer of texels
+    // at a time, starting with the keyed texels next to opaque ones
+    std::vector<bool> queued(size, false);
+    std::vector<uint32_t> layer;
+    for (uint32_t i = 0; i < size; i++) {
+        if (filled[i]) {
+            continue;
+        }
+
+        forEachNeighbor(i, width, height, [&](uint32_t j) {
+            if (filled[j] && !queued[i]) {
+                queued[i] = true;
+                layer.push_back(i);
+            }
+        });
+    }
+
+    std::vector<uint32_t> next;
+    while (!layer.empty()) {
+        // each texel of the layer has at least one filled neighbor
+        for (uint32_t i : layer) {
+            uint32_t sum[3] = {0, 0, 0};
+            uint32_t count = 0;
+
+            forEachNeighbor(i, width, height, [&](uint32_t j) {
+                if (filled[j]) {
+                    sum[0] += texels[j * 4 + 0];
+                    sum[1] += texels[j * 4 + 1];
+                    sum[2] += texels[j * 4 + 2];
+                    count++;
+                }
+            });
+
+            texels[i * 4 + 0] = static_cast<uint8_t>(sum[0] / count);
+            texels[i * 4 + 1] = static_cast<uint8_t>(sum[1] / count);
+            texels[i * 4 + 2] = static_cast<uint8_t>(sum[2] / count);
+        }
+
+        for (uint32_t i : layer) {
+            filled[i] = true;
+        }
+
+        for (uint32_t i : layer) {
+            forEachNeighbor(i, width, height, [&](uint32_t j) {
+                if (!filled[j] && !queued[j]) {
+                    queued[j] = true;
+                    next.push_back(j);
+                }
+            });
+        }
+
+        layer.swap(next);
+        next.clear();
+    }
+
+    return true;
+}
+
+} // namespace
+
 Texture::Texture()
     : gl::Texture(GL_TEXTURE_2D)
 {
@@ -30,15 +132,73 @@ void Texture::load(C3D_PTMAP tmap, std::vector<C3D_PALETTENTRY>& palette)
     uint32_t height = 1 << tmap->u32MaxMapYSizeLg2;
     uint32_t size = width * height;
 
+    m_maxLevel = std::max(tmap->u32MaxMapXSizeLg2, tmap->u32MaxMapYSizeLg2);
+
     uint32_t levels = 1;
     if (tmap->bMipMap) {
-        levels = std::max(tmap->u32MaxMapXSizeLg2, tmap->u32MaxMapYSizeLg2) + 1;
+        levels = m_maxLevel + 1;
+    }
+
+    GLenum internalFormat;
+    switch (tmap->eTexFormat) {
+        case C3D_ETF_RGB1555:
+            internalFormat = GL_RGB5_A1;
+            break;
+
+        case C3D_ETF_RGB332:
+            internalFormat = GL_R3_G3_B2;
+            break;
+
+        case C3D_ETF_RGB565:
+            // GL_RGB565 isn't a core format before OpenGL 4.1
+            internalFormat =
+                ogl_ext_ARB_ES2_compatibility ? GL_RGB565 : GL_RGB5;
+            break;
+
+        case C3D_ETF_RGB4444:
+            internalFormat = GL_RGBA4;
+            break;
+
+        case C3D_ETF_CI8:
+            internalFormat = GL_RGBA8;
+            break;
+
+        default:
+            throw Error("Unsupported texture format: " +
+                            std::string(C3D_ETEXFMT_NAMES[tmap->eTexFormat]),
+                C3D_EC_NOTIMPYET);
     }
 
+    // Allocate immutable storage if the application provides all levels.
+    // Otherwise, only the first level is allocated and the texture is limited
+    // to it until a mipmap filter is used, since many textures (UI, fonts)
+    // never need the other levels.
+    bool storage = ogl_ext_ARB_texture_storage && levels > 1;
+    if (storage) {
+        glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, width, height);
+    } else {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    }
+
+    m_mipmapsPending = levels == 1 && m_maxLevel > 0;
+
+    // The alpha channel of converted palette textures is free for the key.
+    // It's baked into a copy of the levels, so the original keeps its colors
+    // for drawing without the key.
+    m_chromaKeyAlpha = tmap->eTexFormat == C3D_ETF_CI8;
+    m_keyed.reset();
+    std::vector<std::vector<uint8_t>> keyedLevels;
+    bool keyUsed = false;
+
     for (uint32_t level = 0; level < levels; level++) {
-        LOG_INFO("level %d (%dx%d)", level, width, height);
+        LOG_DEBUG("level %d (%dx%d)", level, width, height);
 
         // convert texture data
+        GLenum format;
+        GLenum type;
+        const GLvoid* pixels = tmap->apvLevels[level];
+        std::vector<uint8_t> dst;
+
         switch (tmap->eTexFormat) {
             case C3D_ETF_RGB1555: {
                 uint16_t* src = static_cast<uint16_t*>(tmap->apvLevels[level]);
@@ -48,37 +208,33 @@ void Texture::load(C3D_PTMAP tmap, std::vector<C3D_PALETTENTRY>& palette)
                     src[i] ^= 1 << 15;
                 }
 
-                // upload texture data
-                glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, width, height, 0,
-                    GL_BGRA, GL_UNSIGNED_SHORT_1_5_5_5_REV,
-                    tmap->apvLevels[level]);
-
+                format = GL_BGRA;
+                type = GL_UNSIGNED_SHORT_1_5_5_5_REV;
                 break;
             }
 
             case C3D_ETF_RGB332: {
-                glTexImage2D(GL_TEXTURE_2D, level, GL_RGB, width, height, 0,
-                    GL_RGB, GL_UNSIGNED_BYTE_3_3_2, tmap->apvLevels[level]);
+                format = GL_RGB;
+                type = GL_UNSIGNED_BYTE_3_3_2;
                 break;
             }
 
             case C3D_ETF_RGB565: {
-                glTexImage2D(GL_TEXTURE_2D, level, GL_RGB, width, height, 0,
-                    GL_RGB, GL_UNSIGNED_SHORT_5_6_5_REV,
-                    tmap->apvLevels[level]);
+                format = GL_RGB;
+                type = GL_UNSIGNED_SHORT_5_6_5_REV;
                 break;
             }
 
             case C3D_ETF_RGB4444: {
-                glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, width, height, 0,
-                    GL_BGRA, GL_UNSIGNED_SHORT_4_4_4_4_REV,
-                    tmap->apvLevels[level]);
+                format = GL_BGRA;
+                type = GL_UNSIGNED_SHORT_4_4_4_4_REV;
                 break;
             }
 
-            case C3D_ETF_CI8: {
+            default: {
+                // C3D_ETF_CI8, other formats have been rejected above
                 uint8_t* src = static_cast<uint8_t*>(tmap->apvLevels[level]);
-                std::vector<uint8_t> dst(size * 4);
+                dst.resize(size * 4);
 
                 // Resolve indices to RGBA, which requires less code and is
                 // faster than texture palettes in shaders.
@@ -92,18 +248,24 @@ void Texture::load(C3D_PTMAP tmap, std::vector<C3D_PALETTENTRY>& palette)
                     dst[i * 4 + 3] = 0xff;
                 }
 
-                // upload texture data
-                glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, width, height, 0,
-                    GL_RGBA, GL_UNSIGNED_BYTE, &dst[0]);
+                keyedLevels.push_back(dst);
+                keyUsed |= bakeChromaKey(
+                    keyedLevels.back(), width, height, m_chromaKey);
 
+                format = GL_RGBA;
+                type = GL_UNSIGNED_BYTE;
+                pixels = &dst[0];
                 break;
             }
+        }
 
-            default:
-                throw Error(
-                    "Unsupported texture format: " +
-                        std::string(C3D_ETEXFMT_NAMES[tmap->eTexFormat]),
-                    C3D_EC_NOTIMPYET);
+        // upload texture data
+        if (storage) {
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, format,
+                type, pixels);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height,
+                0, format, type, pixels);
         }
 
         // set dimensions for next level
@@ -112,10 +274,10 @@ void Texture::load(C3D_PTMAP tmap, std::vector<C3D_PALETTENTRY>& palette)
         size = width * height;
     }
 
-    // generate mipmaps automatically if the application doesn't provide any
-    if (levels == 1) {
-        bind();
-        glGenerateMipmap(GL_TEXTURE_2D);
+    // textures without any texel in the key color are drawn as they are
+    if (keyUsed) {
+        createKeyed(keyedLevels, 1 << tmap->u32MaxMapXSizeLg2,
+            1 << tmap->u32MaxMapYSizeLg2);
     }
 
     // FIXME: sampler object overrides these parameters
@@ -142,5 +304,62 @@ C3D_COLOR& Texture::chromaKey()
     return m_chromaKey;
 }
 
+bool Texture::chromaKeyAlpha()
+{
+    return m_chromaKeyAlpha;
+}
+
+void Texture::bind(bool keyed)
+{
+    if (!keyed || !m_keyed) {
+        gl::Texture::bind();
+        return;
+    }
+
+    m_keyed->bind();
+}
+
+void Texture::generateMipmaps(bool keyed)
+{
+    keyed = keyed && m_keyed;
+    bool& pending = keyed ? m_keyedMipmapsPending : m_mipmapsPending;
+    if (!pending) {
+        return;
+    }
+
+    // the levels are allocated by glGenerateMipmap
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_maxLevel);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    pending = false;
+
+    gl::Utils::checkError(__FUNCTION__);
+}
+
+void Texture::createKeyed(const std::vector<std::vector<uint8_t>>& levels,
+    uint32_t width, uint32_t height)
+{
+    // the keyed copy gets the same levels as the original, the application
+    // provided ones are baked exactly and the others are generated from them
+    m_keyed = std::make_unique<gl::Texture>(GL_TEXTURE_2D);
+    m_keyed->bind();
+
+    for (size_t level = 0; level < levels.size(); level++) {
+        glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_RGBA8,
+            width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &levels[level][0]);
+
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+        static_cast<GLint>(levels.size() - 1));
+    m_keyedMipmapsPending = levels.size() == 1 && m_maxLevel > 0;
+
+    // load() is called with the original bound
+    gl::Texture::bind();
+
+    gl::Utils::checkError(__FUNCTION__);
+}
+
 } // namespace cif
 } // namespace glrage
\ No newline at end of file
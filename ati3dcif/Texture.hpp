@@ -2,6 +2,8 @@
 
 #include "ati3dcif.hpp"
 
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 #include <glrage_gl/Texture.hpp>
@@ -17,8 +19,32 @@ public:
     void load(C3D_PTMAP tmap, std::vector<C3D_PALETTENTRY>& palette);
     C3D_COLOR& chromaKey();
 
+    // true if the chroma key can be baked into the alpha channel, which is
+    // done for formats without alpha
+    bool chromaKeyAlpha();
+
+    using gl::Texture::bind;
+
+    // binds the texture, or if keyed is set the copy with the chroma key
+    // baked into the alpha channel, if the key color is used at all
+    void bind(bool keyed);
+
+    // generates the mipmaps on first use if the application didn't provide
+    // any, the texture or its keyed copy must be bound
+    void generateMipmaps(bool keyed);
+
 private:
+    void createKeyed(const std::vector<std::vector<uint8_t>>& levels,
+        uint32_t width, uint32_t height);
+
     C3D_COLOR m_chromaKey;
+    bool m_chromaKeyAlpha{false};
+    uint32_t m_maxLevel{0};
+    bool m_mipmapsPending{false};
+
+    // copy for chroma keyed drawing, with its own levels
+    std::unique_ptr<gl::Texture> m_keyed;
+    bool m_keyedMipmapsPending{false};
 };
 
 } // namespace cif
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+namespace glrage {
+namespace cif {
+
+// Binary format of ATI3DCIF call traces, written by Recorder and read by the
+// cifreplay tool.
+//
+// A trace starts with TRACE_MAGIC and TRACE_VERSION, followed by records that
+// consist of a one byte opcode and its payload. All values are stored in
+// native (little endian) byte order. Texture levels are stored once as blobs
+// and referenced by their index, so textures that are registered repeatedly
+// with the same data don't grow the trace.
+static const uint32_t TRACE_MAGIC = 0x54464943; // "CIFT"
+static const uint32_t TRACE_VERSION = 1;
+
+enum class TraceOp : uint8_t
+{
+    // no payload
+    Init,
+    Term,
+
+    // u32 width, u32 height
+    DisplaySize,
+
+    // no payload, marks the end of a frame
+    Frame,
+
+    // u32 size, data, which becomes the blob with the next free index
+    Blob,
+
+    // u32 format, u32 x size lg2, u32 y size lg2, u32 mipmap,
+    // C3D_COLOR chroma key, u32 palette handle, u32 levels,
+    // u32 blob index per level
+    TextureReg,
+
+    // u32 texture handle
+    TextureUnreg,
+
+    // u32 palette type, u32 entries, C3D_PALETTENTRY per entry
+    PaletteCreate,
+
+    // u32 palette handle
+    PaletteDestroy,
+
+    // u32 palette handle, u32 start, u32 entries, C3D_PALETTENTRY per entry
+    PaletteAnimate,
+
+    // u32 handle returned by the preceding TextureReg or PaletteCreate
+    Handle,
+
+    // no payload
+    ContextCreate,
+    ContextDestroy,
+
+    // u32 state id, u32 size, data
+    SetState,
+
+    // no payload
+    RenderBegin,
+    RenderEnd,
+
+    // u32 vertex type, u32 vertices, u32 vertex size, vertex data
+    PrimStrip,
+    PrimList,
+};
+
+} // namespace cif
+} // namespace glrage
\ No newline at end of file
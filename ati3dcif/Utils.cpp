@@ -347,5 +347,43 @@ std::string Utils::dumpRenderStateData(
     return ss.str();
 }
 
+size_t Utils::vertexSize(C3D_EVERTEX vertexType)
+{
+    switch (vertexType) {
+        case C3D_EV_VF:
+            return sizeof(C3D_VF);
+        case C3D_EV_VCF:
+            return sizeof(C3D_VCF);
+        case C3D_EV_VTF:
+            return sizeof(C3D_VTF);
+        case C3D_EV_VTCF:
+            return sizeof(C3D_VTCF);
+        default:
+            // not supported by the renderer
+            return 0;
+    }
+}
+
+void Utils::rectVertices(const Overlay::Rect& rect,
+    const std::vector<C3D_PALETTENTRY>& palette, C3D_VTCF (&corners)[2])
+{
+    C3D_VTCF vertex = {};
+    if (rect.color < palette.size()) {
+        const C3D_PALETTENTRY& entry = palette[rect.color];
+        vertex.r = entry.r;
+        vertex.g = entry.g;
+        vertex.b = entry.b;
+    }
+    vertex.a = 255;
+
+    corners[0] = vertex;
+    corners[0].x = static_cast<C3D_FLOAT32>(rect.left);
+    corners[0].y = static_cast<C3D_FLOAT32>(rect.top);
+
+    corners[1] = vertex;
+    corners[1].x = static_cast<C3D_FLOAT32>(rect.right);
+    corners[1].y = static_cast<C3D_FLOAT32>(rect.bottom);
+}
+
 } // namespace cif
 } // namespace glrage
\ No newline at end of file
@@ -2,37 +2,45 @@
 
 #include "ati3dcif.hpp"
 
+#include <glrage_util/Overlay.hpp>
+
 #include <string>
+#include <vector>
 
 namespace glrage {
 namespace cif {
 
-const char* C3D_EC_NAMES[];
-const char* C3D_EVERTEX_NAMES[];
-const char* C3D_EPRIM_NAMES[];
-const char* C3D_ESHADE_NAMES[];
-const char* C3D_EASRC_NAMES[];
-const char* C3D_EADST_NAMES[];
-const char* C3D_EACMP_NAMES[];
-const char* C3D_ETEXTILE_NAMES[];
-const char* C3D_ECI_TMAP_TYPE_NAMES[];
-const char* C3D_ETLIGHT_NAMES[];
-const char* C3D_ETPERSPCOR_NAMES[];
-const char* C3D_ETEXFILTER_NAMES[];
-const char* C3D_ETEXOP_NAMES[];
-const char* C3D_ETEXCOMPFCN_NAMES[];
-const char* C3D_EZMODE_NAMES[];
-const char* C3D_EZCMP_NAMES[];
-const char* C3D_ERSID_NAMES[];
-const char* C3D_EASEL_NAMES[];
-const char* C3D_EPIXFMT_NAMES[];
-const char* C3D_ETEXFMT_NAMES[];
+extern const char* C3D_EC_NAMES[];
+extern const char* C3D_EVERTEX_NAMES[];
+extern const char* C3D_EPRIM_NAMES[];
+extern const char* C3D_ESHADE_NAMES[];
+extern const char* C3D_EASRC_NAMES[];
+extern const char* C3D_EADST_NAMES[];
+extern const char* C3D_EACMP_NAMES[];
+extern const char* C3D_ETEXTILE_NAMES[];
+extern const char* C3D_ECI_TMAP_TYPE_NAMES[];
+extern const char* C3D_ETLIGHT_NAMES[];
+extern const char* C3D_ETPERSPCOR_NAMES[];
+extern const char* C3D_ETEXFILTER_NAMES[];
+extern const char* C3D_ETEXOP_NAMES[];
+extern const char* C3D_ETEXCOMPFCN_NAMES[];
+extern const char* C3D_EZMODE_NAMES[];
+extern const char* C3D_EZCMP_NAMES[];
+extern const char* C3D_ERSID_NAMES[];
+extern const char* C3D_EASEL_NAMES[];
+extern const char* C3D_EPIXFMT_NAMES[];
+extern const char* C3D_ETEXFMT_NAMES[];
 
 class Utils
 {
 public:
     static std::string dumpRenderStateData(
         C3D_ERSID eRStateID, C3D_PRSDATA pRStateData);
+    static size_t vertexSize(C3D_EVERTEX vertexType);
+    // returns the opposite corners of an overlay rectangle as used by
+    // C3D_EPRIM_RECT, colored with the given palette
+    static void rectVertices(const Overlay::Rect& rect,
+        const std::vector<C3D_PALETTENTRY>& palette, C3D_VTCF (&corners)[2]);
 };
 
 } // namespace cif
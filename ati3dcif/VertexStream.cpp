@@ -5,6 +5,8 @@
 #include <glrage_gl/Utils.hpp>
 #include <glrage_util/Logger.hpp>
 
+#include <cmath>
+
 namespace glrage {
 namespace cif {
 
@@ -25,6 +27,8 @@ VertexStream::VertexStream()
 
 void VertexStream::addPrimStrip(C3D_VSTRIP vertStrip, C3D_UINT32 numVert)
 {
+    size_t first = m_vtcBuffer.size();
+
     // note: strips are converted to lists, since they can't be properly batched
     // otherwise
     switch (m_vertexType) {
@@ -33,6 +37,17 @@ void VertexStream::addPrimStrip(C3D_VSTRIP vertStrip, C3D_UINT32 numVert)
 
             if (m_primType == C3D_EPRIM_QUAD) {
                 // TODO: triangulate quads
+            } else if (m_primType == C3D_EPRIM_LINE) {
+                // connected lines
+                for (C3D_UINT32 i = 1; i < numVert; i++) {
+                    m_vtcBuffer.push_back(vStripVtcf[i - 1]);
+                    m_vtcBuffer.push_back(vStripVtcf[i]);
+                }
+            } else if (m_primType == C3D_EPRIM_POINT ||
+                       m_primType == C3D_EPRIM_RECT) {
+                // points and rectangles don't share any vertices
+                m_vtcBuffer.insert(
+                    m_vtcBuffer.end(), vStripVtcf, vStripVtcf + numVert);
             } else {
                 for (C3D_UINT32 i = 0; i < numVert; i++) {
                     if (i > 2) {
@@ -51,10 +66,15 @@ void VertexStream::addPrimStrip(C3D_VSTRIP vertStrip, C3D_UINT32 numVert)
                                std::string(C3D_EVERTEX_NAMES[m_vertexType]),
                 C3D_EC_NOTIMPYET);
     }
+
+    applyShading(first);
+    expandPrimitives(first);
 }
 
 void VertexStream::addPrimList(C3D_VLIST vertList, C3D_UINT32 numVert)
 {
+    size_t first = m_vtcBuffer.size();
+
     switch (m_vertexType) {
         case C3D_EV_VTCF: {
             // copy vertices to vertex vector buffer, then to the vertex buffer
@@ -86,6 +106,9 @@ void VertexStream::addPrimList(C3D_VLIST vertList, C3D_UINT32 numVert)
                                std::string(C3D_EVERTEX_NAMES[m_vertexType]),
                 C3D_EC_NOTIMPYET);
     }
+
+    applyShading(first);
+    expandPrimitives(first);
 }
 
 void VertexStream::renderPending()
@@ -95,13 +118,15 @@ void VertexStream::renderPending()
         return;
     }
 
+    TRACE_SCOPE(__FUNCTION__);
+
     // bind vertex format
     m_vtcFormat.bind();
 
     // resize GPU buffer if required
     size_t vertexBufferSize = sizeof(C3D_VTCF) * m_vtcBuffer.size();
     if (vertexBufferSize > m_vertexBufferSize) {
-        LOG_INFO("Vertex buffer resize: %d -> %d", m_vertexBufferSize,
+        LOG_DEBUG("Vertex buffer resize: %d -> %d", m_vertexBufferSize,
             vertexBufferSize);
         m_vertexBuffer.data(vertexBufferSize, nullptr, GL_STREAM_DRAW);
         m_vertexBufferSize = vertexBufferSize;
@@ -111,7 +136,7 @@ void VertexStream::renderPending()
     m_vertexBuffer.subData(0, vertexBufferSize, &m_vtcBuffer[0]);
 
     // draw vertices
-    glDrawArrays(GLCIF_PRIM_MODES[m_primType], 0, m_vtcBuffer.size());
+    glDrawArrays(GL_TRIANGLES, 0, m_vtcBuffer.size());
 
     // mark buffer as empty
     m_vtcBuffer.clear();
@@ -120,6 +145,17 @@ void VertexStream::renderPending()
     gl::Utils::checkError(__FUNCTION__);
 }
 
+void VertexStream::takePending(std::vector<C3D_VTCF>& vertices)
+{
+    vertices.insert(vertices.end(), m_vtcBuffer.begin(), m_vtcBuffer.end());
+    m_vtcBuffer.clear();
+}
+
+void VertexStream::addPending(const std::vector<C3D_VTCF>& vertices)
+{
+    m_vtcBuffer.insert(m_vtcBuffer.end(), vertices.begin(), vertices.end());
+}
+
 C3D_EVERTEX VertexStream::vertexType()
 {
     return m_vertexType;
@@ -140,10 +176,158 @@ void VertexStream::vertexType(C3D_EVERTEX vertexType)
     m_vertexType = vertexType;
 }
 
+void VertexStream::shadeMode(C3D_ESHADE shadeMode)
+{
+    m_shadeMode = shadeMode;
+}
+
+void VertexStream::solidColor(C3D_COLOR solidColor)
+{
+    m_solidColor = solidColor;
+}
+
+void VertexStream::lineWidth(float width)
+{
+    m_lineWidth = width;
+}
+
 void VertexStream::bind()
 {
     m_vertexBuffer.bind();
 }
 
+void VertexStream::applyShading(size_t first)
+{
+    auto begin = m_vtcBuffer.begin() + first;
+    auto end = m_vtcBuffer.end();
+
+    switch (m_shadeMode) {
+        case C3D_ESH_SOLID: {
+            float r = m_solidColor.r;
+            float g = m_solidColor.g;
+            float b = m_solidColor.b;
+            float a = m_solidColor.a;
+
+            for (auto it = begin; it != end; ++it) {
+                it->r = r;
+                it->g = g;
+                it->b = b;
+                it->a = a;
+            }
+            break;
+        }
+
+        case C3D_ESH_FLAT: {
+            // use the color of the last vertex for the entire primitive
+            size_t size = primSize(m_primType);
+            for (auto it = begin; end - it >= static_cast<ptrdiff_t>(size);
+                 it += size) {
+                const C3D_VTCF& last = it[size - 1];
+                for (size_t i = 0; i < size - 1; i++) {
+                    it[i].r = last.r;
+                    it[i].g = last.g;
+                    it[i].b = last.b;
+                    it[i].a = last.a;
+                }
+            }
+            break;
+        }
+
+        default:
+            // smooth shading uses the vertex colors as they are
+            break;
+    }
+}
+
+void VertexStream::expandPrimitives(size_t first)
+{
+    if (m_primType != C3D_EPRIM_LINE && m_primType != C3D_EPRIM_POINT &&
+        m_primType != C3D_EPRIM_RECT) {
+        return;
+    }
+
+    m_expandBuffer.assign(m_vtcBuffer.begin() + first, m_vtcBuffer.end());
+    m_vtcBuffer.resize(first);
+    expandPrimitives(m_primType, m_lineWidth, m_expandBuffer, m_vtcBuffer);
+}
+
+void VertexStream::expandPrimitives(C3D_EPRIM primType, float lineWidth,
+    const std::vector<C3D_VTCF>& vertices, std::vector<C3D_VTCF>& triangles)
+{
+    auto addQuad = [&triangles](const C3D_VTCF (&quad)[4]) {
+        triangles.push_back(quad[0]);
+        triangles.push_back(quad[1]);
+        triangles.push_back(quad[2]);
+
+        triangles.push_back(quad[0]);
+        triangles.push_back(quad[2]);
+        triangles.push_back(quad[3]);
+    };
+
+    float half = lineWidth / 2;
+    size_t size = primSize(primType);
+    for (size_t i = 0; i + size <= vertices.size(); i += size) {
+        const C3D_VTCF& a = vertices[i];
+        const C3D_VTCF& b = vertices[i + size - 1];
+
+        // rectangles are given by two opposite corners, the other corners
+        // are taken from the one in the same row
+        if (primType == C3D_EPRIM_RECT) {
+            C3D_VTCF quad[4] = {a, a, b, b};
+            quad[1].x = b.x;
+            quad[3].x = a.x;
+            addQuad(quad);
+            continue;
+        }
+
+        // offset both ends perpendicular to the line, or draw a square
+        // around the point
+        float dx = b.x - a.x;
+        float dy = b.y - a.y;
+        float length = std::sqrt(dx * dx + dy * dy);
+        if (length > 0) {
+            float nx = -dy / length * half;
+            float ny = dx / length * half;
+
+            C3D_VTCF quad[4] = {a, a, b, b};
+            quad[0].x += nx;
+            quad[0].y += ny;
+            quad[1].x -= nx;
+            quad[1].y -= ny;
+            quad[2].x -= nx;
+            quad[2].y -= ny;
+            quad[3].x += nx;
+            quad[3].y += ny;
+            addQuad(quad);
+        } else {
+            C3D_VTCF quad[4] = {a, a, a, a};
+            quad[0].x -= half;
+            quad[0].y -= half;
+            quad[1].x += half;
+            quad[1].y -= half;
+            quad[2].x += half;
+            quad[2].y += half;
+            quad[3].x -= half;
+            quad[3].y += half;
+            addQuad(quad);
+        }
+    }
+}
+
+size_t VertexStream::primSize(C3D_EPRIM primType)
+{
+    switch (primType) {
+        case C3D_EPRIM_LINE:
+        case C3D_EPRIM_RECT:
+            return 2;
+
+        case C3D_EPRIM_POINT:
+            return 1;
+
+        default:
+            return 3;
+    }
+}
+
 } // namespace cif
 } // namespace glrage
\ No newline at end of file
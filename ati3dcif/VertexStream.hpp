@@ -10,14 +10,6 @@
 namespace glrage {
 namespace cif {
 
-static const GLenum GLCIF_PRIM_MODES[] = {
-    GL_LINES,     // C3D_EPRIM_LINE
-    GL_TRIANGLES, // C3D_EPRIM_TRI
-    GL_TRIANGLES, // C3D_EPRIM_QUAD
-    GL_TRIANGLES, // C3D_EPRIM_RECT
-    GL_POINTS     // C3D_EPRIM_POINT
-};
-
 class VertexStream
 {
 public:
@@ -25,15 +17,50 @@ public:
     void addPrimStrip(C3D_VSTRIP vertStrip, C3D_UINT32 numVert);
     void addPrimList(C3D_VLIST vertList, C3D_UINT32 numVert);
     void renderPending();
+
+    // moves the vertices that haven't been rendered yet to the end of the
+    // given vector, as triangles, lines or points of the current primitive type
+    void takePending(std::vector<C3D_VTCF>& vertices);
+
+    // adds vertices that have been taken with takePending before
+    void addPending(const std::vector<C3D_VTCF>& vertices);
     C3D_EVERTEX vertexType();
     void vertexType(C3D_EVERTEX vertexType);
     C3D_EPRIM primType();
     void primType(C3D_EPRIM primType);
+    void shadeMode(C3D_ESHADE shadeMode);
+    void solidColor(C3D_COLOR solidColor);
+
+    // width of lines and size of points in display pixels
+    void lineWidth(float width);
     void bind();
 
+    // Lines, points and rectangles are expanded to quads, so every primitive
+    // type is drawn as triangles and can share a draw call. This also scales
+    // lines and points with the resolution, like the rest of the geometry.
+    // SoftwareRenderer uses the same expansion, so both renderers match.
+    static void expandPrimitives(C3D_EPRIM primType, float lineWidth,
+        const std::vector<C3D_VTCF>& vertices,
+        std::vector<C3D_VTCF>& triangles);
+
+    // number of vertices per primitive after strips have been converted
+    static size_t primSize(C3D_EPRIM primType);
+
 private:
+    // The shading is applied to the vertex colors of the primitives that
+    // have been added after the given vertex, so changing the shade mode or
+    // the solid color doesn't require a separate draw call.
+    void applyShading(size_t first);
+
+    // expands the primitives that have been added after the given vertex
+    void expandPrimitives(size_t first);
+
     C3D_EVERTEX m_vertexType;
     C3D_EPRIM m_primType;
+    C3D_ESHADE m_shadeMode = C3D_ESH_SMOOTH;
+    C3D_COLOR m_solidColor{0};
+    float m_lineWidth = 1;
+    std::vector<C3D_VTCF> m_expandBuffer;
     size_t m_vertexBufferSize = 0;
     gl::Buffer m_vertexBuffer;
     gl::VertexArray m_vtcFormat;
@@ -7,7 +7,11 @@
 
 // declare WINAPI if required
 #ifndef WINAPI
+#ifdef _WIN32
 #define WINAPI __stdcall
+#else
+#define WINAPI
+#endif
 #endif
 
 // make sure the API is exported, not imported
@@ -0,0 +1,130 @@
+#include <ddraw/Blitter.hpp>
+#include <glrage_util/TimeUtils.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+using namespace glrage;
+using namespace glrage::ddraw;
+
+// Compares the SSE2 kernels of Blitter with plain per-byte and per-pixel
+// loops, like the ones DirectDrawSurface used before, and checks that both
+// produce the same results. Doesn't require a window or an OpenGL context.
+
+// fills the buffer one byte at a time with the bytes of the color
+static void fillScalar(uint8_t* buffer, size_t size, int32_t depth,
+    int32_t color)
+{
+    for (size_t i = 0; i < size; i++) {
+        buffer[i] = (color >> (i % depth * 8)) & 0xff;
+    }
+}
+
+// changes the brightness one channel at a time, saturating like the kernel
+static void rgba5551BrightnessScalar(
+    uint16_t* buffer, size_t count, bool brighten)
+{
+    for (size_t i = 0; i < count; i++) {
+        uint16_t dst = buffer[i] & 0x8000;
+        for (int32_t j = 0; j < 15; j += 5) {
+            uint16_t c = (buffer[i] >> j) & 0x1f;
+            c = brighten ? (std::min)(c * 2, 0x1f) : c / 2;
+            dst |= c << j;
+        }
+        buffer[i] = dst;
+    }
+}
+
+// returns the mean time of a call in microseconds
+static double measure(uint32_t iterations, const std::function<void()>& func)
+{
+    // warm up caches
+    func();
+
+    auto start = TimeUtils::Clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        func();
+    }
+    std::chrono::duration<double, std::micro> duration =
+        TimeUtils::Clock::now() - start;
+
+    return duration.count() / iterations;
+}
+
+static void report(const char* name, double scalar, double sse2, bool match)
+{
+    printf("%-28s scalar %9.2f us, sse2 %9.2f us, %5.1fx%s\n", name, scalar,
+        sse2, scalar / sse2, match ? "" : ", MISMATCH");
+}
+
+int main(int argc, char* argv[])
+{
+    int32_t width = argc > 1 ? atoi(argv[1]) : 640;
+    int32_t height = argc > 2 ? atoi(argv[2]) : 480;
+    uint32_t iterations = argc > 3 ? (std::max)(atoi(argv[3]), 1) : 1000;
+
+    if (width <= 0 || height <= 0) {
+        printf("usage: blitbench [width] [height] [iterations]\n");
+        return 1;
+    }
+
+    printf("surface: %dx%d, %u iterations\n", width, height, iterations);
+
+    size_t pixels = static_cast<size_t>(width) * height;
+    bool failed = false;
+
+    // fills with a color that isn't handled by memset
+    const int32_t depths[] = {2, 3, 4};
+    for (int32_t depth : depths) {
+        size_t size = pixels * depth;
+        std::vector<uint8_t> expected(size);
+        std::vector<uint8_t> actual(size);
+        int32_t color = 0x12345678;
+
+        double scalar = measure(iterations,
+            [&] { fillScalar(expected.data(), size, depth, color); });
+        double sse2 = measure(iterations,
+            [&] { Blitter::fill(actual.data(), size, depth, color); });
+
+        bool match = expected == actual;
+        failed = failed || !match;
+
+        char name[32];
+        snprintf(name, sizeof(name), "fill %d bit", depth * 8);
+        report(name, scalar, sse2, match);
+    }
+
+    // the brightness is changed in place, so each iteration works on the
+    // result of the previous one, which is the same for both versions
+    std::vector<uint16_t> source(pixels);
+    srand(1);
+    for (auto& pixel : source) {
+        pixel = static_cast<uint16_t>(rand());
+    }
+
+    const bool modes[] = {false, true};
+    for (bool brighten : modes) {
+        std::vector<uint16_t> expected(source);
+        std::vector<uint16_t> actual(source);
+
+        double scalar = measure(iterations, [&] {
+            rgba5551BrightnessScalar(expected.data(), pixels, brighten);
+        });
+        double sse2 = measure(iterations, [&] {
+            Blitter::rgba5551Brightness(actual.data(), pixels, brighten);
+        });
+
+        bool match = expected == actual;
+        failed = failed || !match;
+
+        report(brighten ? "rgba5551Brightness brighten"
+                        : "rgba5551Brightness darken",
+            scalar, sse2, match);
+    }
+
+    return failed ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,337 @@
+#include "Player.hpp"
+
+#include <ati3dcif/Error.hpp>
+#include <ati3dcif/StateVar.hpp>
+#include <ati3dcif/Utils.hpp>
+
+#include <glrage_util/Logger.hpp>
+#include <glrage_util/TimeUtils.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace glrage {
+namespace cif {
+
+Player::Player(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.good()) {
+        throw std::runtime_error("Can't open trace file " + path);
+    }
+
+    // load the entire trace upfront so file access doesn't affect the timing
+    m_data.assign(std::istreambuf_iterator<char>(file),
+        std::istreambuf_iterator<char>());
+
+    if (read<uint32_t>() != TRACE_MAGIC) {
+        throw std::runtime_error("Not an ATI3DCIF trace: " + path);
+    }
+
+    uint32_t version = read<uint32_t>();
+    if (version != TRACE_VERSION) {
+        throw std::runtime_error(
+            "Unsupported trace version " + std::to_string(version));
+    }
+}
+
+std::vector<double> Player::play()
+{
+    std::vector<double> frameTimes;
+
+    // rewind to the first record
+    m_pos = sizeof(TRACE_MAGIC) + sizeof(TRACE_VERSION);
+    m_blobs.clear();
+    m_vertexType = C3D_EV_VTCF;
+    m_errors = 0;
+
+    auto frameStart = TimeUtils::Clock::now();
+
+    while (m_pos < m_data.size()) {
+        auto op = read<TraceOp>();
+
+        if (op == TraceOp::Frame) {
+            m_context.swapBuffers();
+
+            // wait for the GPU so the frame time includes the rendering
+            glFinish();
+
+            auto now = TimeUtils::Clock::now();
+            std::chrono::duration<double, std::milli> frameTime =
+                now - frameStart;
+            frameTimes.push_back(frameTime.count());
+            frameStart = now;
+            continue;
+        }
+
+        try {
+            dispatch(op);
+        } catch (const Error& ex) {
+            // the game gets an error code and carries on, so does the replay
+            LOG_DEBUG("CIF error: %s", ex.what());
+            m_errors++;
+        }
+    }
+
+    m_renderer.reset();
+    m_textures.clear();
+    m_palettes.clear();
+
+    return frameTimes;
+}
+
+uint32_t Player::errors()
+{
+    return m_errors;
+}
+
+void Player::dispatch(TraceOp op)
+{
+    switch (op) {
+        case TraceOp::Init:
+            m_renderer = Renderer::create();
+            m_vertexType = C3D_EV_VTCF;
+            break;
+
+        case TraceOp::Term:
+            m_renderer.reset();
+            m_textures.clear();
+            m_palettes.clear();
+            break;
+
+        case TraceOp::DisplaySize: {
+            auto width = read<uint32_t>();
+            auto height = read<uint32_t>();
+            m_context.setDisplaySize(width, height);
+            m_context.setupViewport();
+            break;
+        }
+
+        case TraceOp::Blob: {
+            auto size = read<uint32_t>();
+            m_blobs.push_back(std::make_pair(read(size), size));
+            break;
+        }
+
+        case TraceOp::TextureReg:
+            textureReg();
+            break;
+
+        case TraceOp::TextureUnreg: {
+            auto it = m_textures.find(read<uint32_t>());
+            if (it != m_textures.end()) {
+                C3D_HTX htx = it->second;
+                m_textures.erase(it);
+                m_renderer->textureUnreg(htx);
+            }
+            break;
+        }
+
+        case TraceOp::PaletteCreate: {
+            auto type = static_cast<C3D_ECI_TMAP_TYPE>(read<uint32_t>());
+            auto entries = read<uint32_t>();
+
+            std::vector<C3D_PALETTENTRY> palette(entries);
+            memcpy(palette.data(), read(entries * sizeof(C3D_PALETTENTRY)),
+                entries * sizeof(C3D_PALETTENTRY));
+
+            m_lastWasTexture = false;
+            m_lastPalette = nullptr;
+            m_renderer->texturePaletteCreate(
+                type, palette.data(), &m_lastPalette);
+            break;
+        }
+
+        case TraceOp::PaletteDestroy: {
+            auto it = m_palettes.find(read<uint32_t>());
+            if (it != m_palettes.end()) {
+                C3D_HTXPAL htxpal = it->second;
+                m_palettes.erase(it);
+                m_renderer->texturePaletteDestroy(htxpal);
+            }
+            break;
+        }
+
+        case TraceOp::PaletteAnimate: {
+            auto handle = read<uint32_t>();
+            auto start = read<uint32_t>();
+            auto entries = read<uint32_t>();
+
+            std::vector<C3D_PALETTENTRY> palette(entries);
+            memcpy(palette.data(), read(entries * sizeof(C3D_PALETTENTRY)),
+                entries * sizeof(C3D_PALETTENTRY));
+
+            m_renderer->texturePaletteAnimate(
+                m_palettes[handle], start, entries, palette.data());
+            break;
+        }
+
+        case TraceOp::Handle: {
+            auto handle = read<uint32_t>();
+            if (m_lastWasTexture) {
+                m_textures[handle] = m_lastTexture;
+            } else {
+                m_palettes[handle] = m_lastPalette;
+            }
+            break;
+        }
+
+        case TraceOp::ContextCreate:
+        case TraceOp::ContextDestroy:
+            // the renderer doesn't track contexts
+            break;
+
+        case TraceOp::SetState: {
+            auto id = static_cast<C3D_ERSID>(read<uint32_t>());
+            auto size = read<uint32_t>();
+
+            StateVar::Value value{0};
+            memcpy(&value.raw[0], read(size),
+                (std::min)(size, static_cast<uint32_t>(value.raw.size())));
+
+            // texture handles differ between the recording and the replay
+            if (id == C3D_ERS_TMAP_SELECT || id == C3D_ERS_COMPOSITE_SELECT) {
+                uint32_t handle;
+                memcpy(&handle, &value.raw[0], sizeof(handle));
+                value.htx = handle ? m_textures[handle] : nullptr;
+            }
+
+            m_renderer->setState(id, &value);
+
+            // remember the vertex type to validate the primitive records
+            if (id == C3D_ERS_VERTEX_TYPE) {
+                m_vertexType = value.evertex;
+            }
+            break;
+        }
+
+        case TraceOp::RenderBegin:
+            m_renderer->renderBegin(reinterpret_cast<C3D_HRC>(1));
+            break;
+
+        case TraceOp::RenderEnd:
+            m_renderer->renderEnd();
+            break;
+
+        case TraceOp::PrimStrip:
+        case TraceOp::PrimList:
+            primitives(op);
+            break;
+
+        default:
+            throw std::runtime_error("Invalid trace opcode " +
+                                     std::to_string(static_cast<int>(op)));
+    }
+}
+
+void Player::textureReg()
+{
+    C3D_TMAP tmap;
+    memset(&tmap, 0, sizeof(tmap));
+    tmap.u32Size = sizeof(tmap);
+    tmap.eTexFormat = static_cast<C3D_ETEXFMT>(read<uint32_t>());
+    tmap.u32MaxMapXSizeLg2 = read<uint32_t>();
+    tmap.u32MaxMapYSizeLg2 = read<uint32_t>();
+    tmap.bMipMap = read<uint32_t>();
+    tmap.clrTexChromaKey = read<C3D_COLOR>();
+    tmap.htxpalTexPalette = m_palettes[read<uint32_t>()];
+
+    if (tmap.u32MaxMapXSizeLg2 >= cu32MAX_TMAP_LEV ||
+        tmap.u32MaxMapYSizeLg2 >= cu32MAX_TMAP_LEV) {
+        throw std::runtime_error("Invalid texture size in trace");
+    }
+
+    // bits per texel of each format, same as the recorder
+    uint32_t bits;
+    switch (tmap.eTexFormat) {
+        case C3D_ETF_CI4:
+            bits = 4;
+            break;
+        case C3D_ETF_CI8:
+        case C3D_ETF_RGB332:
+        case C3D_ETF_Y8:
+            bits = 8;
+            break;
+        case C3D_ETF_RGB8888:
+            bits = 32;
+            break;
+        default:
+            bits = 16;
+            break;
+    }
+
+    // copy the levels, since the renderer may convert them in place
+    auto levels = read<uint32_t>();
+    if (levels > cu32MAX_TMAP_LEV) {
+        throw std::runtime_error("Invalid texture level count in trace");
+    }
+
+    uint32_t width = 1 << tmap.u32MaxMapXSizeLg2;
+    uint32_t height = 1 << tmap.u32MaxMapYSizeLg2;
+
+    std::vector<std::vector<uint8_t>> data(levels);
+    for (uint32_t level = 0; level < levels; level++) {
+        auto& blob = m_blobs.at(read<uint32_t>());
+        if (blob.second < (std::max)(width * height * bits / 8, 1u)) {
+            throw std::runtime_error("Texture level too small in trace");
+        }
+
+        data[level].assign(blob.first, blob.first + blob.second);
+        tmap.apvLevels[level] = data[level].data();
+
+        width = (std::max)(1u, width / 2);
+        height = (std::max)(1u, height / 2);
+    }
+
+    m_lastWasTexture = true;
+    m_lastTexture = nullptr;
+    m_renderer->textureReg(&tmap, &m_lastTexture);
+}
+
+void Player::primitives(TraceOp op)
+{
+    // the vertex type has already been set by a SetState record, but the
+    // renderer reads the vertices by its own idea of the vertex size
+    auto vertexType = static_cast<C3D_EVERTEX>(read<uint32_t>());
+    auto numVert = read<uint32_t>();
+    auto vertexSize = read<uint32_t>();
+
+    if (vertexType != m_vertexType ||
+        vertexSize != Utils::vertexSize(m_vertexType) || vertexSize == 0) {
+        throw std::runtime_error("Invalid vertex size in trace");
+    }
+
+    // copy to an aligned buffer, the trace has no alignment guarantees
+    size_t size = static_cast<size_t>(numVert) * vertexSize;
+    m_vertices.resize((size + 3) / 4);
+    memcpy(m_vertices.data(), read(size), size);
+
+    if (op == TraceOp::PrimStrip) {
+        m_renderer->renderPrimStrip(m_vertices.data(), numVert);
+    } else {
+        // rebuild the list of pointers
+        auto bytes = reinterpret_cast<uint8_t*>(m_vertices.data());
+        m_vertexList.resize(numVert);
+        for (uint32_t i = 0; i < numVert; i++) {
+            m_vertexList[i] = bytes + static_cast<size_t>(i) * vertexSize;
+        }
+
+        m_renderer->renderPrimList(m_vertexList.data(), numVert);
+    }
+}
+
+const uint8_t* Player::read(size_t size)
+{
+    if (m_pos + size > m_data.size()) {
+        throw std::runtime_error("Unexpected end of trace");
+    }
+
+    const uint8_t* data = &m_data[m_pos];
+    m_pos += size;
+    return data;
+}
+
+} // namespace cif
+} // namespace glrage
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <ati3dcif/Renderer.hpp>
+#include <ati3dcif/Trace.hpp>
+
+#include <glrage/GLRage.hpp>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace glrage {
+namespace cif {
+
+// Replays an ATI3DCIF trace written by Recorder with a Renderer, translating
+// the recorded texture and palette handles to the ones of the replay.
+class Player
+{
+public:
+    Player(const std::string& path);
+
+    // replay the entire trace and return the time of each frame in
+    // milliseconds
+    std::vector<double> play();
+
+    // number of calls that failed in the last replay
+    uint32_t errors();
+
+private:
+    void dispatch(TraceOp op);
+    void textureReg();
+    void primitives(TraceOp op);
+    const uint8_t* read(size_t size);
+
+    template <typename T>
+    T read()
+    {
+        T value;
+        memcpy(&value, read(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    Context& m_context{GLRage::getContext()};
+    std::vector<uint8_t> m_data;
+    size_t m_pos{0};
+    std::unique_ptr<Renderer> m_renderer;
+    std::vector<std::pair<const uint8_t*, uint32_t>> m_blobs;
+    std::map<uint32_t, C3D_HTX> m_textures;
+    std::map<uint32_t, C3D_HTXPAL> m_palettes;
+    C3D_HTX m_lastTexture{nullptr};
+    C3D_HTXPAL m_lastPalette{nullptr};
+    bool m_lastWasTexture{false};
+    C3D_EVERTEX m_vertexType{C3D_EV_VTCF};
+    std::vector<uint32_t> m_vertices;
+    std::vector<void*> m_vertexList;
+    uint32_t m_errors{0};
+};
+
+} // namespace cif
+} // namespace glrage
\ No newline at end of file
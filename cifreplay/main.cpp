@@ -0,0 +1,93 @@
+#include "Player.hpp"
+
+#include <glrage/GLRage.hpp>
+#include <glrage_util/Logger.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+using namespace glrage;
+
+// Replays an ATI3DCIF trace recorded with "record = true" in the [ATI3DCIF]
+// section of glrage.ini and reports the frame rate and frame times. Build
+// glrage with GLR_HEADLESS to replay without a window.
+
+static double percentile(std::vector<double> times, double p)
+{
+    std::sort(times.begin(), times.end());
+    auto index = static_cast<size_t>(p / 100.0 * (times.size() - 1) + 0.5);
+    return times[index];
+}
+
+static void report(uint32_t pass, const std::vector<double>& times,
+    uint32_t errors)
+{
+    if (times.empty()) {
+        printf("pass %u: no frames\n", pass);
+        return;
+    }
+
+    double total = std::accumulate(times.begin(), times.end(), 0.0);
+    double mean = total / times.size();
+
+    printf("pass %u: %u frames in %.1f ms, %.1f fps\n", pass,
+        static_cast<uint32_t>(times.size()), total, 1000.0 / mean);
+    printf("  frame ms: mean %.3f, p50 %.3f, p95 %.3f, p99 %.3f, max %.3f\n",
+        mean, percentile(times, 50), percentile(times, 95),
+        percentile(times, 99), *std::max_element(times.begin(), times.end()));
+
+    if (errors > 0) {
+        printf("  %u calls failed\n", errors);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        printf("usage: cifreplay <trace> [passes] [frames.csv]\n");
+        return 1;
+    }
+
+    uint32_t passes = argc > 2 ? (std::max)(atoi(argv[2]), 1) : 1;
+
+    try {
+        Logger::setCurrent(&GLRage::getLogger());
+        Tracer::setCurrent(&GLRage::getTracer());
+
+        Context& context = GLRage::getContext();
+        context.init();
+
+        printf("renderer: %s\n", glGetString(GL_RENDERER));
+
+        cif::Player player(argv[1]);
+
+        // the first pass includes shader compilation and texture uploads that
+        // are cached by the driver later on, so compare later passes
+        for (uint32_t pass = 1; pass <= passes; pass++) {
+            auto times = player.play();
+            report(pass, times, player.errors());
+
+            // write the frame times of the last pass if requested
+            if (pass == passes && argc > 3) {
+                std::ofstream file(argv[3]);
+                file << "frame,ms\n";
+                for (size_t i = 0; i < times.size(); i++) {
+                    file << i << "," << times[i] << "\n";
+                }
+            }
+        }
+
+        context.detach();
+    } catch (const std::exception& ex) {
+        fprintf(stderr, "error: %s\n", ex.what());
+        return 1;
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -1,18 +1,17 @@
 #include "Blitter.hpp"
 
 #include <algorithm>
+#include <cstring>
+
+#include <emmintrin.h>
 
 namespace glrage {
 namespace ddraw {
 
-void Blitter::blit(Image& srcImg, Rect& srcRect, Image dstImg, Rect& dstRect)
+template <typename Func>
+void Blitter::scale(
+    Image& srcImg, Rect& srcRect, Image& dstImg, Rect& dstRect, Func func)
 {
-    // do fast direct copy if possible
-    if (srcImg == dstImg && srcRect == dstRect) {
-        dstImg.buffer = srcImg.buffer;
-        return;
-    }
-
     int32_t srcRectWidth = srcRect.width();
     int32_t srcRectHeight = srcRect.height();
 
@@ -60,10 +59,281 @@ void Blitter::blit(Image& srcImg, Rect& srcRect, Image dstImg, Rect& dstRect)
                 x2 += srcRect.left;
             }
 
+            func(x1, y1, x2, y2);
+        }
+    }
+}
+
+void Blitter::blit(Image& srcImg, Rect& srcRect, Image dstImg, Rect& dstRect)
+{
+    // do fast direct copy if possible
+    if (srcImg == dstImg && srcRect == dstRect) {
+        if (dstImg.buffer != srcImg.buffer) {
+            size_t size = dstImg.width * dstImg.height * dstImg.depth;
+            std::copy_n(srcImg.buffer, size, dstImg.buffer);
+        }
+        return;
+    }
+
+    scale(srcImg, srcRect, dstImg, dstRect,
+        [&](int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
             for (int32_t n = 0; n < dstImg.depth; n++) {
                 dstImg(x1, y1, n) = srcImg(x2, y2, n);
             }
+        });
+}
+
+void Blitter::blitColorKey(Image& srcImg, Rect& srcRect, Image dstImg,
+    Rect& dstRect, uint32_t colorKey)
+{
+    int32_t depth = srcImg.depth;
+
+    // ignore unused bits of the color key
+    if (depth < 4) {
+        colorKey &= (1u << (depth * 8)) - 1;
+    }
+
+    scale(srcImg, srcRect, dstImg, dstRect,
+        [&](int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+            uint32_t pixel = 0;
+            std::memcpy(&pixel, &srcImg(x2, y2, 0), depth);
+            if (pixel != colorKey) {
+                std::memcpy(&dstImg(x1, y1, 0), &pixel, depth);
+            }
+        });
+}
+
+void Blitter::copy(
+    Image& srcImg, Rect& srcRect, Image& dstImg, int32_t dstX, int32_t dstY)
+{
+    int32_t rowSize = srcRect.width() * srcImg.depth;
+    int32_t height = srcRect.height();
+
+    // copy bottom-up if the destination starts below the source in the same
+    // image, so no row is overwritten before it has been read
+    bool reverse = srcImg.buffer == dstImg.buffer && dstY > srcRect.top;
+
+    for (int32_t i = 0; i < height; i++) {
+        int32_t y = reverse ? height - 1 - i : i;
+        uint8_t* src = &srcImg(srcRect.left, srcRect.top + y, 0);
+        uint8_t* dst = &dstImg(dstX, dstY + y, 0);
+
+        // source and destination rows may overlap as well
+        std::memmove(dst, src, rowSize);
+    }
+}
+
+void Blitter::copyColorKey(Image& srcImg, Rect& srcRect, Image& dstImg,
+    int32_t dstX, int32_t dstY, uint32_t colorKey)
+{
+    int32_t width = srcRect.width();
+    int32_t depth = srcImg.depth;
+
+    // ignore unused bits of the color key
+    if (depth < 4) {
+        colorKey &= (1u << (depth * 8)) - 1;
+    }
+
+    // vectors with the color key repeated for the pixel size
+    __m128i key;
+    switch (depth) {
+        case 1:
+            key = _mm_set1_epi8(static_cast<char>(colorKey));
+            break;
+        case 2:
+            key = _mm_set1_epi16(static_cast<short>(colorKey));
+            break;
+        case 4:
+            key = _mm_set1_epi32(static_cast<int>(colorKey));
+            break;
+        default:
+            // 24 bit pixels don't fit into vector lanes
+            key = _mm_setzero_si128();
+            break;
+    }
+
+    int32_t vecPixels = depth == 3 ? 0 : 16 / depth;
+    int32_t height = srcRect.height();
+
+    // copy bottom-up if the destination starts below the source in the same
+    // image, so no row is overwritten before it has been read
+    bool sameImage = srcImg.buffer == dstImg.buffer;
+    bool reverse = sameImage && dstY > srcRect.top;
+
+    // pixels are processed left to right, so a row that is moved to the
+    // right within itself is read from a copy
+    std::vector<uint8_t> row;
+    if (sameImage && dstY == srcRect.top && dstX > srcRect.left) {
+        row.resize(width * depth);
+    }
+
+    for (int32_t i = 0; i < height; i++) {
+        int32_t y = reverse ? height - 1 - i : i;
+        uint8_t* src = &srcImg(srcRect.left, srcRect.top + y, 0);
+        uint8_t* dst = &dstImg(dstX, dstY + y, 0);
+
+        if (!row.empty()) {
+            std::memcpy(row.data(), src, row.size());
+            src = row.data();
+        }
+
+        int32_t x = 0;
+        for (; vecPixels && x + vecPixels <= width; x += vecPixels) {
+            auto srcPtr = reinterpret_cast<__m128i*>(src + x * depth);
+            auto dstPtr = reinterpret_cast<__m128i*>(dst + x * depth);
+            __m128i srcVec = _mm_loadu_si128(srcPtr);
+            __m128i dstVec = _mm_loadu_si128(dstPtr);
+
+            // mask is set for all transparent pixels
+            __m128i mask;
+            switch (depth) {
+                case 1:
+                    mask = _mm_cmpeq_epi8(srcVec, key);
+                    break;
+                case 2:
+                    mask = _mm_cmpeq_epi16(srcVec, key);
+                    break;
+                default:
+                    mask = _mm_cmpeq_epi32(srcVec, key);
+                    break;
+            }
+
+            // keep destination pixels where the mask is set
+            __m128i res = _mm_or_si128(
+                _mm_and_si128(mask, dstVec), _mm_andnot_si128(mask, srcVec));
+            _mm_storeu_si128(dstPtr, res);
+        }
+
+        // process remaining pixels
+        for (; x < width; x++) {
+            uint32_t pixel = 0;
+            std::memcpy(&pixel, src + x * depth, depth);
+            if (pixel != colorKey) {
+                std::memcpy(dst + x * depth, &pixel, depth);
+            }
+        }
+    }
+}
+
+void Blitter::fill(uint8_t* buffer, size_t size, int32_t depth, int32_t color)
+{
+    // trivial case, which is handled best by memset
+    if (depth == 1 || color == 0) {
+        std::fill_n(buffer, size, color & 0xff);
+        return;
+    }
+
+    // create a pattern that is a multiple of both the pixel size and the
+    // vector size, which allows storing whole vectors for 16, 24 and 32 bit
+    // colors alike
+    const size_t patternSize = 48;
+    alignas(16) uint8_t pattern[patternSize];
+    for (size_t i = 0; i < patternSize; i++) {
+        pattern[i] = (color >> (i % depth * 8)) & 0xff;
+    }
+
+    auto patternVec = reinterpret_cast<const __m128i*>(pattern);
+    __m128i p0 = _mm_load_si128(patternVec);
+    __m128i p1 = _mm_load_si128(patternVec + 1);
+    __m128i p2 = _mm_load_si128(patternVec + 2);
+
+    size_t i = 0;
+    for (; i + patternSize <= size; i += patternSize) {
+        auto dst = reinterpret_cast<__m128i*>(buffer + i);
+        _mm_storeu_si128(dst, p0);
+        _mm_storeu_si128(dst + 1, p1);
+        _mm_storeu_si128(dst + 2, p2);
+    }
+
+    // fill remaining bytes
+    for (; i < size; i++) {
+        buffer[i] = pattern[i % patternSize];
+    }
+}
+
+void Blitter::fill(Image& dstImg, Rect& dstRect, int32_t color)
+{
+    // clip the rectangle against the image
+    int32_t left = (std::max)((std::min)(dstRect.left, dstRect.right), 0);
+    int32_t top = (std::max)((std::min)(dstRect.top, dstRect.bottom), 0);
+    int32_t right =
+        (std::min)((std::max)(dstRect.left, dstRect.right), dstImg.width);
+    int32_t bottom =
+        (std::min)((std::max)(dstRect.top, dstRect.bottom), dstImg.height);
+
+    if (right <= left) {
+        return;
+    }
+
+    // a rectangle that spans entire rows is filled in one go
+    size_t rowSize = (right - left) * dstImg.depth;
+    if (left == 0 && right == dstImg.width && bottom > top) {
+        fill(&dstImg(0, top, 0), rowSize * (bottom - top), dstImg.depth,
+            color);
+        return;
+    }
+
+    for (int32_t y = top; y < bottom; y++) {
+        fill(&dstImg(left, y, 0), rowSize, dstImg.depth, color);
+    }
+}
+
+void Blitter::rgba5551Brightness(uint16_t* buffer, size_t count, bool brighten)
+{
+    // color channel masks, alpha is always preserved
+    const uint16_t halveMask = 0x3def;
+    const uint16_t channelMask = 0x1f;
+    const uint16_t alphaMask = 0x8000;
+
+    const __m128i halveMaskVec = _mm_set1_epi16(halveMask);
+    const __m128i channelMaskVec = _mm_set1_epi16(channelMask);
+    const __m128i alphaMaskVec = _mm_set1_epi16(alphaMask);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        auto ptr = reinterpret_cast<__m128i*>(buffer + i);
+        __m128i src = _mm_loadu_si128(ptr);
+        __m128i dst = _mm_and_si128(src, alphaMaskVec);
+
+        if (brighten) {
+            // double each channel separately and saturate at the maximum
+            __m128i r = _mm_and_si128(_mm_srli_epi16(src, 10), channelMaskVec);
+            __m128i g = _mm_and_si128(_mm_srli_epi16(src, 5), channelMaskVec);
+            __m128i b = _mm_and_si128(src, channelMaskVec);
+
+            r = _mm_min_epi16(_mm_slli_epi16(r, 1), channelMaskVec);
+            g = _mm_min_epi16(_mm_slli_epi16(g, 1), channelMaskVec);
+            b = _mm_min_epi16(_mm_slli_epi16(b, 1), channelMaskVec);
+
+            dst = _mm_or_si128(dst, _mm_slli_epi16(r, 10));
+            dst = _mm_or_si128(dst, _mm_slli_epi16(g, 5));
+            dst = _mm_or_si128(dst, b);
+        } else {
+            // halve all channels at once and drop the bits that were shifted
+            // into neighboring channels
+            __m128i half = _mm_and_si128(_mm_srli_epi16(src, 1), halveMaskVec);
+            dst = _mm_or_si128(dst, half);
+        }
+
+        _mm_storeu_si128(ptr, dst);
+    }
+
+    // process remaining pixels
+    for (; i < count; i++) {
+        uint16_t src = buffer[i];
+        uint16_t dst = src & alphaMask;
+
+        if (brighten) {
+            for (int32_t j = 0; j < 15; j += 5) {
+                uint16_t c = (src >> j) & channelMask;
+                c = std::min<uint16_t>(c * 2, channelMask);
+                dst |= c << j;
+            }
+        } else {
+            dst |= (src >> 1) & halveMask;
         }
+
+        buffer[i] = dst;
     }
 }
 
@@ -36,7 +36,7 @@ public:
         int32_t width;
         int32_t height;
         int32_t depth;
-        std::vector<uint8_t>& buffer;
+        uint8_t* buffer;
 
         uint8_t& operator()(int32_t x, int32_t y, int32_t z)
         {
@@ -50,8 +50,24 @@ public:
     };
 
     static void blit(Image& srcImg, Rect& srcRect, Image dstImg, Rect& dstRect);
+    static void blitColorKey(Image& srcImg, Rect& srcRect, Image dstImg,
+        Rect& dstRect, uint32_t colorKey);
+    static void copy(Image& srcImg, Rect& srcRect, Image& dstImg, int32_t dstX,
+        int32_t dstY);
+    static void copyColorKey(Image& srcImg, Rect& srcRect, Image& dstImg,
+        int32_t dstX, int32_t dstY, uint32_t colorKey);
+    static void fill(uint8_t* buffer, size_t size, int32_t depth, int32_t color);
+    static void fill(Image& dstImg, Rect& dstRect, int32_t color);
+    static void rgba5551Brightness(
+        uint16_t* buffer, size_t count, bool brighten);
 
 private:
+    // calls func(dstX, dstY, srcX, srcY) for every destination pixel of a
+    // scaled and possibly mirrored blit
+    template <typename Func>
+    static void scale(Image& srcImg, Rect& srcRect, Image& dstImg,
+        Rect& dstRect, Func func);
+
     static const int32_t m_ratioBias = 16;
 };
 
@@ -1,20 +1,35 @@
 #include "DirectDraw.hpp"
 #include "DirectDrawClipper.hpp"
+#include "DirectDrawPalette.hpp"
 #include "DirectDrawSurface.hpp"
 
 #include <glrage_util/Logger.hpp>
 
+#include <algorithm>
+
 namespace glrage {
 namespace ddraw {
 
-DirectDraw::DirectDraw()
+DirectDraw::DirectDraw(Recorder* recorder)
+    : m_recorder(recorder)
 {
     LOG_TRACE("");
+
+    // the renderer creates OpenGL objects, so it belongs to the render thread
+    m_renderThread.call([this] { m_renderer = std::make_unique<Renderer>(); });
 }
 
 DirectDraw::~DirectDraw()
 {
     LOG_TRACE("");
+
+    if (m_timerResolution) {
+        TimeUtils::restoreTimerResolution();
+    }
+
+    // queued commands of the surfaces may still use the renderer
+    m_renderThread.run(
+        [renderer = std::move(m_renderer)]() mutable { renderer.reset(); });
 }
 
 /*** IUnknown methods ***/
@@ -72,7 +87,18 @@ HRESULT WINAPI DirectDraw::CreatePalette(DWORD dwFlags,
 {
     LOG_TRACE("");
 
-    return DDERR_UNSUPPORTED;
+    if (!lplpDDPalette) {
+        return DDERR_INVALIDPARAMS;
+    }
+
+    auto palette = new DirectDrawPalette(dwFlags, lpDDColorArray, m_recorder);
+    *lplpDDPalette = palette;
+
+    if (m_recorder) {
+        m_recorder->createPalette(palette, dwFlags, palette->entries());
+    }
+
+    return DD_OK;
 }
 
 HRESULT WINAPI DirectDraw::CreateSurface(LPDDSURFACEDESC lpDDSurfaceDesc,
@@ -80,7 +106,12 @@ HRESULT WINAPI DirectDraw::CreateSurface(LPDDSURFACEDESC lpDDSurfaceDesc,
 {
     LOG_TRACE("");
 
-    *lplpDDSurface = new DirectDrawSurface(*this, m_renderer, lpDDSurfaceDesc);
+    auto surface = new DirectDrawSurface(*this, *m_renderer, lpDDSurfaceDesc);
+    *lplpDDSurface = surface;
+
+    if (m_recorder) {
+        m_recorder->createSurface(surface, *lpDDSurfaceDesc);
+    }
 
     return DD_OK;
 }
@@ -158,12 +189,22 @@ HRESULT WINAPI DirectDraw::GetDisplayMode(LPDDSURFACEDESC lpDDSurfaceDesc)
 
     LPDDSURFACEDESC desc = lpDDSurfaceDesc;
 
-    desc->ddpfPixelFormat.dwFlags = DDPF_RGB;
-    desc->ddpfPixelFormat.dwRGBBitCount = 16;
-    desc->ddpfPixelFormat.dwRBitMask = 15 << 10;
-    desc->ddpfPixelFormat.dwGBitMask = 15 << 5;
-    desc->ddpfPixelFormat.dwBBitMask = 15;
-    desc->ddpfPixelFormat.dwRGBAlphaBitMask = 1 << 15;
+    if (m_bits == 8) {
+        // palettized mode, colors are resolved by the renderer
+        desc->ddpfPixelFormat.dwFlags = DDPF_RGB | DDPF_PALETTEINDEXED8;
+        desc->ddpfPixelFormat.dwRGBBitCount = 8;
+        desc->ddpfPixelFormat.dwRBitMask = 0;
+        desc->ddpfPixelFormat.dwGBitMask = 0;
+        desc->ddpfPixelFormat.dwBBitMask = 0;
+        desc->ddpfPixelFormat.dwRGBAlphaBitMask = 0;
+    } else {
+        desc->ddpfPixelFormat.dwFlags = DDPF_RGB;
+        desc->ddpfPixelFormat.dwRGBBitCount = 16;
+        desc->ddpfPixelFormat.dwRBitMask = 15 << 10;
+        desc->ddpfPixelFormat.dwGBitMask = 15 << 5;
+        desc->ddpfPixelFormat.dwBBitMask = 15;
+        desc->ddpfPixelFormat.dwRGBAlphaBitMask = 1 << 15;
+    }
 
     desc->dwWidth = m_width;
     desc->dwHeight = m_height;
@@ -203,7 +244,16 @@ HRESULT WINAPI DirectDraw::GetScanLine(LPDWORD lpdwScanLine)
 {
     LOG_TRACE("");
 
-    return DDERR_UNSUPPORTED;
+    uint32_t scanLine = getEmulatedScanLine();
+    if (scanLine >= m_height) {
+        return DDERR_VERTICALBLANKINPROGRESS;
+    }
+
+    if (lpdwScanLine) {
+        *lpdwScanLine = scanLine;
+    }
+
+    return DD_OK;
 }
 
 HRESULT WINAPI DirectDraw::GetVerticalBlankStatus(LPBOOL lpbIsInVB)
@@ -211,7 +261,7 @@ HRESULT WINAPI DirectDraw::GetVerticalBlankStatus(LPBOOL lpbIsInVB)
     LOG_TRACE("");
 
     if (lpbIsInVB) {
-        *lpbIsInVB = TRUE;
+        *lpbIsInVB = getEmulatedScanLine() >= m_height;
     }
 
     return DD_OK;
@@ -253,6 +303,37 @@ HRESULT WINAPI DirectDraw::WaitForVerticalBlank(DWORD dwFlags, HANDLE hEvent)
 {
     LOG_TRACE("");
 
+    // the emulated vertical blank would be missed with the default timer
+    // resolution, which is raised until the DirectDraw object is released
+    if (!m_timerResolution) {
+        TimeUtils::raiseTimerResolution();
+        m_timerResolution = true;
+    }
+
+    auto now = TimeUtils::Clock::now();
+    auto period = getRefreshPeriod();
+    auto frameStart = now - (now - m_vblankEpoch) % period;
+
+    switch (dwFlags) {
+        case DDWAITVB_BLOCKBEGIN: {
+            // the vertical blank follows the visible lines of each frame
+            auto vblankStart =
+                frameStart + period * m_height / getScanLineCount();
+            if (vblankStart <= now) {
+                vblankStart += period;
+            }
+            TimeUtils::sleepUntil(vblankStart);
+            break;
+        }
+
+        case DDWAITVB_BLOCKEND:
+            TimeUtils::sleepUntil(frameStart + period);
+            break;
+
+        default:
+            return DDERR_UNSUPPORTED;
+    }
+
     return DD_OK;
 }
 
@@ -267,6 +348,10 @@ HRESULT WINAPI DirectDraw::SetDisplayMode(DWORD dwWidth, DWORD dwHeight,
     m_bits = dwBPP;
     m_refreshRate = dwRefreshRate;
 
+    if (m_recorder) {
+        m_recorder->displayMode(dwWidth, dwHeight, dwBPP);
+    }
+
     m_context.setDisplaySize(m_width, m_height);
 
     return DD_OK;
@@ -283,5 +368,38 @@ HRESULT WINAPI DirectDraw::GetAvailableVidMem(
     return DD_OK;
 }
 
+/*** Custom methods ***/
+Recorder* DirectDraw::recorder()
+{
+    return m_recorder;
+}
+
+Renderer& DirectDraw::renderer()
+{
+    return *m_renderer;
+}
+
+std::chrono::nanoseconds DirectDraw::getRefreshPeriod()
+{
+    uint32_t refreshRate = m_refreshRate ? m_refreshRate : DEFAULT_REFRESH_RATE;
+    return std::chrono::nanoseconds(1000000000 / refreshRate);
+}
+
+uint32_t DirectDraw::getScanLineCount()
+{
+    // add blanking lines in the same ratio as standard VGA timings, which
+    // has 45 blanking lines for 480 visible lines
+    return m_height + (std::max)(m_height * 45 / 480, 1u);
+}
+
+uint32_t DirectDraw::getEmulatedScanLine()
+{
+    // there's no access to the actual display timings, so derive the beam
+    // position from the refresh rate and the time since creation
+    auto period = getRefreshPeriod();
+    auto phase = (TimeUtils::Clock::now() - m_vblankEpoch) % period;
+    return static_cast<uint32_t>(phase * getScanLineCount() / period);
+}
+
 } // namespace ddraw
 } // namespace glrage
\ No newline at end of file
@@ -1,12 +1,15 @@
 #pragma once
 
+#include "Recorder.hpp"
 #include "Renderer.hpp"
 #include "Unknown.hpp"
 #include "ddraw.hpp"
 
 #include <glrage/GLRage.hpp>
+#include <glrage_util/TimeUtils.hpp>
 
 #include <cstdint>
+#include <memory>
 
 namespace glrage {
 namespace ddraw {
@@ -14,7 +17,7 @@ namespace ddraw {
 class DirectDraw : public Unknown, public IDirectDraw, public IDirectDraw2
 {
 public:
-    DirectDraw();
+    DirectDraw(Recorder* recorder = nullptr);
     virtual ~DirectDraw();
 
     /*** IUnknown methods ***/
@@ -58,6 +61,10 @@ public:
     HRESULT WINAPI GetAvailableVidMem(LPDDSCAPS lpDDSCaps, LPDWORD lpdwTotal,
         LPDWORD lpdwFree); // added in v2
 
+    /*** Custom methods ***/
+    Recorder* recorder();
+    Renderer& renderer();
+
 private:
     const uint32_t DEFAULT_WIDTH = 640;
     const uint32_t DEFAULT_HEIGHT = 480;
@@ -65,11 +72,20 @@ private:
     const uint32_t DEFAULT_REFRESH_RATE = 60;
 
     Context& m_context = GLRage::getContext();
-    Renderer m_renderer;
+    RenderThread& m_renderThread = GLRage::getRenderThread();
+    std::unique_ptr<Renderer> m_renderer;
+    Recorder* m_recorder;
     uint32_t m_width = DEFAULT_WIDTH;
     uint32_t m_height = DEFAULT_HEIGHT;
     uint32_t m_refreshRate = DEFAULT_REFRESH_RATE;
     uint32_t m_bits = DEFAULT_BITS;
+    TimeUtils::Clock::time_point m_vblankEpoch = TimeUtils::Clock::now();
+    bool m_timerResolution = false;
+
+    /*** Custom methods ***/
+    std::chrono::nanoseconds getRefreshPeriod();
+    uint32_t getScanLineCount();
+    uint32_t getEmulatedScanLine();
 };
 
 } // namespace ddraw
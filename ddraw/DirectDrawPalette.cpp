@@ -0,0 +1,150 @@
+#include "DirectDrawPalette.hpp"
+#include "DirectDrawSurface.hpp"
+
+#include <glrage_util/Logger.hpp>
+
+#include <algorithm>
+
+namespace glrage {
+namespace ddraw {
+
+DirectDrawPalette::DirectDrawPalette(
+    DWORD dwFlags, LPPALETTEENTRY lpDDColorArray, Recorder* recorder)
+    : m_caps(dwFlags)
+    , m_recorder(recorder)
+{
+    LOG_TRACE("");
+
+    m_entries.fill(PALETTEENTRY{0, 0, 0, 0});
+
+    if (lpDDColorArray) {
+        // only 8 bit palettes are supported, smaller palettes are simply
+        // copied into the first entries
+        size_t count = SIZE;
+        if (dwFlags & DDPCAPS_4BIT) {
+            count = 16;
+        } else if (dwFlags & DDPCAPS_2BIT) {
+            count = 4;
+        } else if (dwFlags & DDPCAPS_1BIT) {
+            count = 2;
+        }
+
+        std::copy_n(lpDDColorArray, count, m_entries.begin());
+    }
+}
+
+DirectDrawPalette::~DirectDrawPalette()
+{
+    LOG_TRACE("");
+
+    if (m_recorder) {
+        m_recorder->destroy(this);
+    }
+}
+
+/*** IUnknown methods ***/
+HRESULT WINAPI DirectDrawPalette::QueryInterface(REFIID riid, LPVOID* ppvObj)
+{
+    LOG_TRACE("");
+
+    if (IsEqualGUID(riid, IID_IDirectDrawPalette)) {
+        *ppvObj = static_cast<IDirectDrawPalette*>(this);
+    } else {
+        return Unknown::QueryInterface(riid, ppvObj);
+    }
+
+    Unknown::AddRef();
+    return S_OK;
+}
+
+ULONG WINAPI DirectDrawPalette::AddRef()
+{
+    LOG_TRACE("");
+
+    return Unknown::AddRef();
+}
+
+ULONG WINAPI DirectDrawPalette::Release()
+{
+    LOG_TRACE("");
+
+    return Unknown::Release();
+}
+
+/*** IDirectDrawPalette methods ***/
+HRESULT WINAPI DirectDrawPalette::GetCaps(LPDWORD lpdwCaps)
+{
+    LOG_TRACE("");
+
+    *lpdwCaps = m_caps;
+    return DD_OK;
+}
+
+HRESULT WINAPI DirectDrawPalette::GetEntries(DWORD dwFlags, DWORD dwBase,
+    DWORD dwNumEntries, LPPALETTEENTRY lpEntries)
+{
+    LOG_TRACE("");
+
+    if (!lpEntries || dwBase + dwNumEntries > SIZE) {
+        return DDERR_INVALIDPARAMS;
+    }
+
+    std::copy_n(m_entries.begin() + dwBase, dwNumEntries, lpEntries);
+    return DD_OK;
+}
+
+HRESULT WINAPI DirectDrawPalette::Initialize(
+    LPDIRECTDRAW lpDD, DWORD dwFlags, LPPALETTEENTRY lpDDColorTable)
+{
+    LOG_TRACE("");
+
+    // "Because the DirectDrawPalette object is initialized when it is
+    // created, this method always returns DDERR_ALREADYINITIALIZED."
+    return DDERR_ALREADYINITIALIZED;
+}
+
+HRESULT WINAPI DirectDrawPalette::SetEntries(DWORD dwFlags,
+    DWORD dwStartingEntry, DWORD dwCount, LPPALETTEENTRY lpEntries)
+{
+    LOG_TRACE("");
+
+    if (!lpEntries || dwStartingEntry + dwCount > SIZE) {
+        return DDERR_INVALIDPARAMS;
+    }
+
+    std::copy_n(lpEntries, dwCount, m_entries.begin() + dwStartingEntry);
+
+    if (m_recorder) {
+        m_recorder->setEntries(this, dwStartingEntry, dwCount, lpEntries);
+    }
+
+    // let surfaces know that the palette needs to be uploaded again
+    m_version++;
+
+    // fades and color cycling on a static frame wouldn't be visible until the
+    // next flip otherwise
+    if (m_primary) {
+        m_primary->presentPalette();
+    }
+
+    return DD_OK;
+}
+
+/*** Custom methods ***/
+const PALETTEENTRY* DirectDrawPalette::entries()
+{
+    return m_entries.data();
+}
+
+uint32_t DirectDrawPalette::version()
+{
+    return m_version;
+}
+
+void DirectDrawPalette::setPrimary(DirectDrawSurface* surface)
+{
+    m_primary = surface;
+}
+
+} // namespace ddraw
+} // namespace glrage
\ No newline at end of file
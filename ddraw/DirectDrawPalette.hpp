@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Recorder.hpp"
+#include "Unknown.hpp"
+#include "ddraw.hpp"
+
+#include <array>
+#include <cstdint>
+
+namespace glrage {
+namespace ddraw {
+
+class DirectDrawSurface;
+
+class DirectDrawPalette : public Unknown, public IDirectDrawPalette
+{
+public:
+    static const size_t SIZE = 256;
+
+    DirectDrawPalette(DWORD dwFlags, LPPALETTEENTRY lpDDColorArray,
+        Recorder* recorder = nullptr);
+    virtual ~DirectDrawPalette();
+
+    /*** IUnknown methods ***/
+    virtual HRESULT WINAPI QueryInterface(REFIID riid, LPVOID* ppvObj);
+    virtual ULONG WINAPI AddRef();
+    virtual ULONG WINAPI Release();
+
+    /*** IDirectDrawPalette methods ***/
+    HRESULT WINAPI GetCaps(LPDWORD lpdwCaps);
+    HRESULT WINAPI GetEntries(DWORD dwFlags, DWORD dwBase, DWORD dwNumEntries,
+        LPPALETTEENTRY lpEntries);
+    HRESULT WINAPI Initialize(
+        LPDIRECTDRAW lpDD, DWORD dwFlags, LPPALETTEENTRY lpDDColorTable);
+    HRESULT WINAPI SetEntries(DWORD dwFlags, DWORD dwStartingEntry,
+        DWORD dwCount, LPPALETTEENTRY lpEntries);
+
+    /*** Custom methods ***/
+    const PALETTEENTRY* entries();
+    uint32_t version();
+
+    // the primary surface the palette is attached to, which is presented
+    // again when the entries change
+    void setPrimary(DirectDrawSurface* surface);
+
+private:
+    DWORD m_caps;
+    std::array<PALETTEENTRY, SIZE> m_entries;
+    uint32_t m_version = 1;
+    DirectDrawSurface* m_primary = nullptr;
+    Recorder* m_recorder;
+};
+
+} // namespace ddraw
+} // namespace glrage
\ No newline at end of file
@@ -14,6 +14,7 @@ DirectDrawSurface::DirectDrawSurface(
     DirectDraw& lpDD, Renderer& renderer, LPDDSURFACEDESC lpDDSurfaceDesc)
     : m_dd(lpDD)
     , m_renderer(renderer)
+    , m_recorder(lpDD.recorder())
     , m_desc(*lpDDSurfaceDesc)
 {
     LOG_TRACE("");
@@ -43,8 +44,19 @@ DirectDrawSurface::DirectDrawSurface(
         m_desc.dwFlags |= DDSD_PITCH;
     }
 
-    // allocate surface buffer
-    m_buffer.resize(m_desc.lPitch * m_desc.dwHeight, 0);
+    // allocate surface buffer, preferably in a pixel buffer that is mapped to
+    // the client memory for surfaces that are uploaded on every frame
+    m_dataSize = m_desc.lPitch * m_desc.dwHeight;
+    if (m_desc.ddsCaps.dwCaps &
+        (DDSCAPS_PRIMARYSURFACE | DDSCAPS_BACKBUFFER)) {
+        m_pixelBuffer = m_renderer.createPixelBuffer(m_dataSize, &m_data);
+    }
+
+    if (!m_pixelBuffer) {
+        m_buffer.resize(m_dataSize, 0);
+        m_data = &m_buffer[0];
+    }
+
     m_desc.lpSurface = nullptr;
 
     // attach back buffer if defined
@@ -78,8 +90,25 @@ DirectDrawSurface::~DirectDrawSurface()
         m_depthBuffer = nullptr;
     }
 
+    if (m_palette) {
+        if (isPrimary()) {
+            m_palette->setPrimary(nullptr);
+        }
+        m_palette->Release();
+        m_palette = nullptr;
+    }
+
     m_dd.Release();
 
+    if (m_recorder) {
+        m_recorder->destroy(this);
+    }
+
+    if (m_uploadFence) {
+        glDeleteSync(m_uploadFence);
+        m_uploadFence = nullptr;
+    }
+
     if (m_desc.lpSurface) {
         m_desc.lpSurface = nullptr;
     }
@@ -137,6 +166,10 @@ HRESULT WINAPI DirectDrawSurface::AddAttachedSurface(
         return DDERR_CANNOTATTACHSURFACE;
     }
 
+    if (m_recorder) {
+        m_recorder->addAttachedSurface(this, ps);
+    }
+
     ps->AddRef();
     return DD_OK;
 }
@@ -159,74 +192,23 @@ HRESULT WINAPI DirectDrawSurface::Blt(LPRECT lpDestRect,
         return DDERR_LOCKEDSURFACES;
     }
 
-    if (lpDDSrcSurface) {
-        m_dirty = true;
-
-        int32_t dstWidth = m_desc.dwWidth;
-        int32_t dstHeight = m_desc.dwHeight;
-
-        Blitter::Rect dstRect{0, 0, dstWidth, dstHeight};
-        if (lpDestRect) {
-            dstRect.left = lpDestRect->left;
-            dstRect.top = lpDestRect->top;
-            dstRect.right = lpDestRect->right;
-            dstRect.bottom = lpDestRect->bottom;
-        }
-
-        auto src = static_cast<DirectDrawSurface*>(lpDDSrcSurface);
-
-        int32_t depth = m_desc.ddpfPixelFormat.dwRGBBitCount / 8;
-
-        if (src->m_desc.ddsCaps.dwCaps & DDSCAPS_PRIMARYSURFACE) {
-            // This is a somewhat ugly and slow hack to get a rescaled and
-            // converted copy of the framebuffer for the surface, which is
-            // required to display the in-game menu of Tomb Raider correctly.
-            GLint width;
-            GLint height;
-            std::vector<uint8_t> buffer;
-
-            gl::Screenshot::capture(buffer, width, height, depth, GL_BGRA,
-                GL_UNSIGNED_SHORT_1_5_5_5_REV);
-
-            Blitter::Rect srcRect{0, height, width, 0};
-
-            Blitter::Image srcImg{width, height, depth, buffer};
-            Blitter::Image dstImg{dstWidth, dstHeight, depth, m_buffer};
-
-            Blitter::blit(srcImg, srcRect, dstImg, dstRect);
-
-            if (isTombRaider()) {
-                // simulate dimming of DOS/PSX menu
-                rgba5551AdjustBrightness(false);
-            }
-        } else {
-            int32_t srcWidth = src->m_desc.dwWidth;
-            int32_t srcHeight = src->m_desc.dwHeight;
-
-            Blitter::Rect srcRect{0, 0, srcWidth, srcHeight};
-
-            if (lpSrcRect) {
-                srcRect.left = lpSrcRect->left;
-                srcRect.top = lpSrcRect->top;
-                srcRect.right = lpSrcRect->right;
-                srcRect.bottom = lpSrcRect->bottom;
-            }
-
-            Blitter::Image srcImg{srcWidth, srcHeight, depth, src->m_buffer};
-            Blitter::Image dstImg{dstWidth, dstHeight, depth, m_buffer};
-
-            Blitter::blit(srcImg, srcRect, dstImg, dstRect);
-        }
+    auto src = static_cast<DirectDrawSurface*>(lpDDSrcSurface);
+    HRESULT result = validateBlt(src, dwFlags, lpDDBltFx);
+    if (result != DD_OK) {
+        return result;
     }
 
-    if (dwFlags & DDBLT_COLORFILL) {
-        clear(lpDDBltFx->dwFillColor);
+    if (m_recorder) {
+        m_recorder->blt(this, lpDestRect, src, lpSrcRect, dwFlags, lpDDBltFx);
     }
 
-    if (dwFlags & DDBLT_DEPTHFILL && m_depthBuffer) {
-        m_depthBuffer->clear(0);
+    if (src || dwFlags & DDBLT_COLORFILL) {
+        waitForUpload();
+        m_dirty = true;
     }
 
+    bltImpl(lpDestRect, src, lpSrcRect, dwFlags, lpDDBltFx);
+
     return DD_OK;
 }
 
@@ -240,20 +222,127 @@ HRESULT WINAPI DirectDrawSurface::BltBatch(
         return DDERR_LOCKEDSURFACES;
     }
 
-    return DDERR_UNSUPPORTED;
+    if (!lpDDBltBatch) {
+        return DDERR_INVALIDPARAMS;
+    }
+
+    // validate the entire batch upfront, so it's either applied completely or
+    // not at all
+    for (DWORD i = 0; i < dwCount; i++) {
+        DDBLTBATCH& batch = lpDDBltBatch[i];
+        HRESULT result =
+            validateBlt(static_cast<DirectDrawSurface*>(batch.lpDDSSrc),
+                batch.dwFlags, batch.lpDDBltFx);
+        if (result != DD_OK) {
+            return result;
+        }
+    }
+
+    if (m_recorder) {
+        for (DWORD i = 0; i < dwCount; i++) {
+            DDBLTBATCH& batch = lpDDBltBatch[i];
+            m_recorder->blt(this, batch.lprDest,
+                static_cast<DirectDrawSurface*>(batch.lpDDSSrc), batch.lprSrc,
+                batch.dwFlags, batch.lpDDBltFx);
+        }
+    }
+
+    // wait for pending uploads only once for the entire batch
+    waitForUpload();
+    m_dirty = true;
+
+    for (DWORD i = 0; i < dwCount; i++) {
+        DDBLTBATCH& batch = lpDDBltBatch[i];
+        bltImpl(batch.lprDest, static_cast<DirectDrawSurface*>(batch.lpDDSSrc),
+            batch.lprSrc, batch.dwFlags, batch.lpDDBltFx);
+    }
+
+    return DD_OK;
 }
 
 HRESULT WINAPI DirectDrawSurface::BltFast(DWORD dwX, DWORD dwY,
     LPDIRECTDRAWSURFACE lpDDSrcSurface, LPRECT lpSrcRect, DWORD dwTrans)
 {
-    LOG_TRACE("");
+    LOG_TRACE("%d, %d, %p, %p, %d", dwX, dwY, lpDDSrcSurface, lpSrcRect,
+        dwTrans);
 
     // can't blit while locked
     if (m_locked) {
         return DDERR_LOCKEDSURFACES;
     }
 
-    return DDERR_UNSUPPORTED;
+    if (!lpDDSrcSurface) {
+        return DDERR_INVALIDPARAMS;
+    }
+
+    // destination color keys aren't supported
+    if (dwTrans & DDBLTFAST_DESTCOLORKEY) {
+        return DDERR_UNSUPPORTED;
+    }
+
+    auto src = static_cast<DirectDrawSurface*>(lpDDSrcSurface);
+
+    // BltFast can't convert pixel formats
+    int32_t depth = m_desc.ddpfPixelFormat.dwRGBBitCount / 8;
+    if (src->m_desc.ddpfPixelFormat.dwRGBBitCount / 8 != depth) {
+        return DDERR_INVALIDPIXELFORMAT;
+    }
+
+    if (m_recorder) {
+        m_recorder->bltFast(this, dwX, dwY, src, lpSrcRect, dwTrans);
+    }
+
+    int32_t srcWidth = src->m_desc.dwWidth;
+    int32_t srcHeight = src->m_desc.dwHeight;
+    int32_t dstWidth = m_desc.dwWidth;
+    int32_t dstHeight = m_desc.dwHeight;
+
+    Blitter::Rect srcRect{0, 0, srcWidth, srcHeight};
+    if (lpSrcRect) {
+        srcRect.left = lpSrcRect->left;
+        srcRect.top = lpSrcRect->top;
+        srcRect.right = lpSrcRect->right;
+        srcRect.bottom = lpSrcRect->bottom;
+    }
+
+    // clip source rectangle against both surfaces, the destination moves by
+    // the amount that is clipped off the left and top
+    int32_t dstX = dwX;
+    int32_t dstY = dwY;
+    if (srcRect.left < 0) {
+        dstX -= srcRect.left;
+        srcRect.left = 0;
+    }
+    if (srcRect.top < 0) {
+        dstY -= srcRect.top;
+        srcRect.top = 0;
+    }
+    srcRect.right = (std::min)({srcRect.right, srcWidth,
+        srcRect.left + dstWidth - dstX});
+    srcRect.bottom = (std::min)({srcRect.bottom, srcHeight,
+        srcRect.top + dstHeight - dstY});
+
+    if (srcRect.right <= srcRect.left || srcRect.bottom <= srcRect.top) {
+        // nothing to do
+        return DD_OK;
+    }
+
+    waitForUpload();
+    m_dirty = true;
+
+    Blitter::Image srcImg{srcWidth, srcHeight, depth, src->m_data};
+    Blitter::Image dstImg{dstWidth, dstHeight, depth, m_data};
+
+    // only single color keys are supported, which is what most games use
+    if (dwTrans & DDBLTFAST_SRCCOLORKEY &&
+        src->m_desc.dwFlags & DDSD_CKSRCBLT) {
+        uint32_t colorKey = src->m_desc.ddckCKSrcBlt.dwColorSpaceLowValue;
+        Blitter::copyColorKey(srcImg, srcRect, dstImg, dstX, dstY, colorKey);
+    } else {
+        Blitter::copy(srcImg, srcRect, dstImg, dstX, dstY);
+    }
+
+    return DD_OK;
 }
 
 HRESULT WINAPI DirectDrawSurface::DeleteAttachedSurface(
@@ -285,13 +374,24 @@ HRESULT WINAPI DirectDrawSurface::Flip(
 {
     LOG_TRACE("");
 
+    ProfilerScope profilerScope(m_profiler, ProfilerSection::DirectDraw);
+
     // check if the surface can be flipped
     if (!(m_desc.ddsCaps.dwCaps & DDSCAPS_FLIP) ||
         !(m_desc.ddsCaps.dwCaps & DDSCAPS_FRONTBUFFER) || !m_backBuffer) {
         return DDERR_NOTFLIPPABLE;
     }
 
-    bool rendered = m_context.isRendered();
+    if (m_recorder) {
+        m_recorder->flip(this);
+    }
+
+    // the flag of the context lags behind with a render thread, so use the
+    // one of the game's thread, which knows if render blocks have been queued
+    // since the last swap
+    bool rendered = m_renderThread.isQueued() ? m_context.isRenderQueued()
+                                              : m_context.isRendered();
+    m_context.setRenderQueued(false);
 
     // don't re-upload surfaces if external rendering was active after lock()
     // has
@@ -304,36 +404,45 @@ HRESULT WINAPI DirectDrawSurface::Flip(
     // TODO: use buffer chain correctly
     // TODO: use lpDDSurfaceTargetOverride when defined
     m_buffer.swap(m_backBuffer->m_buffer);
+    m_pixelBuffer.swap(m_backBuffer->m_pixelBuffer);
+    std::swap(m_data, m_backBuffer->m_data);
+    std::swap(m_uploadFence, m_backBuffer->m_uploadFence);
 
     bool dirtyTmp = m_dirty;
     m_dirty = m_backBuffer->m_dirty;
     m_backBuffer->m_dirty = dirtyTmp;
 
     // upload surface if dirty
-    if (m_dirty) {
-        m_renderer.upload(m_desc, m_buffer);
-        m_dirty = false;
-    }
+    auto upload = prepareUpload(m_dirty);
+    m_dirty = false;
+
+    Renderer& renderer = m_renderer;
+    Context& context = m_context;
+    m_renderThread.run(
+        [&renderer, &context, rendered, upload = std::move(upload) ]() mutable {
+            upload.apply(renderer);
+
+            // swap buffer now if there was external rendering, otherwise the
+            // surface would overwrite it
+            if (rendered) {
+                context.swapBuffers();
+            }
 
-    // swap buffer now if there was external rendering, otherwise the surface
-    // would overwrite it
-    if (rendered) {
-        m_context.swapBuffers();
-    }
+            // update viewport in case the window size has changed
+            context.setupViewport();
 
-    // update viewport in case the window size has changed
-    m_context.setupViewport();
+            // render surface
+            renderer.render();
 
-    // render surface
-    m_renderer.render();
+            // swap buffer after the surface has been rendered if there was no
+            // external rendering for this frame, fixes title screens and other
+            // pure 2D operations that aren't continuously updated
+            if (!rendered) {
+                context.swapBuffers();
+            }
+        });
 
-    // swap buffer after the surface has been rendered if there was no external
-    // rendering for this frame, fixes title screens and other pure 2D
-    // operations
-    // that aren't continuously updated
-    if (!rendered) {
-        m_context.swapBuffers();
-    }
+    m_renderThread.frame();
 
     return DD_OK;
 }
@@ -343,17 +452,21 @@ HRESULT WINAPI DirectDrawSurface::GetAttachedSurface(
 {
     LOG_TRACE("");
 
+    DirectDrawSurface* attached = nullptr;
     if (lpDDSCaps->dwCaps & DDSCAPS_BACKBUFFER) {
-        *lplpDDAttachedSurface = m_backBuffer;
-        return DD_OK;
+        attached = m_backBuffer;
+    } else if (lpDDSCaps->dwCaps & DDSCAPS_ZBUFFER) {
+        attached = m_depthBuffer;
+    } else {
+        return DDERR_SURFACENOTATTACHED;
     }
 
-    if (lpDDSCaps->dwCaps & DDSCAPS_ZBUFFER) {
-        *lplpDDAttachedSurface = m_depthBuffer;
-        return DD_OK;
+    if (m_recorder) {
+        m_recorder->getAttachedSurface(this, lpDDSCaps->dwCaps, attached);
     }
 
-    return DDERR_SURFACENOTATTACHED;
+    *lplpDDAttachedSurface = attached;
+    return DD_OK;
 }
 
 HRESULT WINAPI DirectDrawSurface::GetBltStatus(DWORD dwFlags)
@@ -384,7 +497,25 @@ HRESULT WINAPI DirectDrawSurface::GetColorKey(
 {
     LOG_TRACE("");
 
-    return DDERR_UNSUPPORTED;
+    if (!lpDDColorKey) {
+        return DDERR_INVALIDPARAMS;
+    }
+
+    if (dwFlags & DDCKEY_SRCBLT) {
+        if (!(m_desc.dwFlags & DDSD_CKSRCBLT)) {
+            return DDERR_NOCOLORKEY;
+        }
+        *lpDDColorKey = m_desc.ddckCKSrcBlt;
+    } else if (dwFlags & DDCKEY_DESTBLT) {
+        if (!(m_desc.dwFlags & DDSD_CKDESTBLT)) {
+            return DDERR_NOCOLORKEY;
+        }
+        *lpDDColorKey = m_desc.ddckCKDestBlt;
+    } else {
+        return DDERR_UNSUPPORTED;
+    }
+
+    return DD_OK;
 }
 
 HRESULT WINAPI DirectDrawSurface::GetDC(HDC* phDC)
@@ -412,7 +543,14 @@ HRESULT WINAPI DirectDrawSurface::GetPalette(LPDIRECTDRAWPALETTE* lplpDDPalette)
 {
     LOG_TRACE("");
 
-    return DDERR_UNSUPPORTED;
+    if (!m_palette) {
+        return DDERR_NOPALETTEATTACHED;
+    }
+
+    m_palette->AddRef();
+    *lplpDDPalette = m_palette;
+
+    return DD_OK;
 }
 
 HRESULT WINAPI DirectDrawSurface::GetPixelFormat(
@@ -466,8 +604,15 @@ HRESULT WINAPI DirectDrawSurface::Lock(LPRECT lpDestRect,
         return DDERR_SURFACEBUSY;
     }
 
+    // the surface memory must not be modified while the GPU is reading it
+    waitForUpload();
+
+    if (m_recorder) {
+        m_recorder->lock(this, m_data, m_dataSize);
+    }
+
     // assign lpSurface
-    m_desc.lpSurface = &m_buffer[0];
+    m_desc.lpSurface = m_data;
     m_desc.dwFlags |= DDSD_LPSURFACE;
 
     m_locked = true;
@@ -507,7 +652,30 @@ HRESULT WINAPI DirectDrawSurface::SetColorKey(
 {
     LOG_TRACE("");
 
-    return DDERR_UNSUPPORTED;
+    if (m_recorder) {
+        m_recorder->setColorKey(this, dwFlags, lpDDColorKey);
+    }
+
+    // a null color key removes the current one
+    if (dwFlags & DDCKEY_SRCBLT) {
+        if (lpDDColorKey) {
+            m_desc.ddckCKSrcBlt = *lpDDColorKey;
+            m_desc.dwFlags |= DDSD_CKSRCBLT;
+        } else {
+            m_desc.dwFlags &= ~DDSD_CKSRCBLT;
+        }
+    } else if (dwFlags & DDCKEY_DESTBLT) {
+        if (lpDDColorKey) {
+            m_desc.ddckCKDestBlt = *lpDDColorKey;
+            m_desc.dwFlags |= DDSD_CKDESTBLT;
+        } else {
+            m_desc.dwFlags &= ~DDSD_CKDESTBLT;
+        }
+    } else {
+        return DDERR_UNSUPPORTED;
+    }
+
+    return DD_OK;
 }
 
 HRESULT WINAPI DirectDrawSurface::SetOverlayPosition(LONG lX, LONG lY)
@@ -521,18 +689,48 @@ HRESULT WINAPI DirectDrawSurface::SetPalette(LPDIRECTDRAWPALETTE lpDDPalette)
 {
     LOG_TRACE("");
 
-    return DDERR_UNSUPPORTED;
+    auto palette = static_cast<DirectDrawPalette*>(lpDDPalette);
+    if (palette) {
+        palette->AddRef();
+    }
+
+    if (m_recorder) {
+        m_recorder->setPalette(this, palette);
+    }
+
+    // a null palette detaches the current one
+    if (m_palette) {
+        if (isPrimary()) {
+            m_palette->setPrimary(nullptr);
+        }
+        m_palette->Release();
+    }
+
+    m_palette = palette;
+    m_paletteVersion = 0;
+
+    if (m_palette && isPrimary()) {
+        m_palette->setPrimary(this);
+    }
+
+    return DD_OK;
 }
 
 HRESULT WINAPI DirectDrawSurface::Unlock(LPVOID lp)
 {
     LOG_TRACE("");
 
+    ProfilerScope profilerScope(m_profiler, ProfilerSection::DirectDraw);
+
     // ensure that the surface is actually locked
     if (!m_locked) {
         return DDERR_NOTLOCKED;
     }
 
+    if (m_recorder) {
+        m_recorder->unlock(this, m_data, m_dataSize);
+    }
+
     // unassign lpSurface
     m_desc.lpSurface = nullptr;
     m_desc.dwFlags &= ~DDSD_LPSURFACE;
@@ -545,29 +743,37 @@ HRESULT WINAPI DirectDrawSurface::Unlock(LPVOID lp)
         !(m_desc.ddsCaps.dwCaps & DDSCAPS_FLIP)) {
         // FMV hack for Tomb Raider
         bool tomb = isTombRaider();
-        if (tomb) {
-            // fix black lines by copying even to odd lines
-            for (DWORD i = 0; i < m_desc.dwHeight; i += 2) {
-                auto itrEven = std::next(m_buffer.begin(), i * m_desc.lPitch);
-                auto itrOdd =
-                    std::next(m_buffer.begin(), (i + 1) * m_desc.lPitch);
-                std::copy(itrEven, std::next(itrEven, m_desc.lPitch), itrOdd);
-            }
-
-            // video frames have only half brightness, fix it
-            rgba5551AdjustBrightness(true);
-        }
-
-        m_context.swapBuffers();
-        m_context.setupViewport();
-        m_renderer.upload(m_desc, m_buffer);
-        m_renderer.render();
-
-        // the video codec updates changed pixels only. so the original
-        // brightness must be restored after rendering to avoid errors
-        if (tomb) {
-            rgba5551AdjustBrightness(false);
-        }
+        auto upload = prepareUpload(true);
+        m_context.setRenderQueued(false);
+
+        Renderer& renderer = m_renderer;
+        Context& context = m_context;
+        m_renderThread.run(
+            [&renderer, &context, tomb, upload = std::move(upload) ]() mutable {
+                if (tomb) {
+                    // fix black lines by repeating even lines in place of odd
+                    // lines
+                    renderer.setLineDoubling(true);
+
+                    // video frames have only half brightness, fix it
+                    renderer.setBrightness(2);
+                }
+
+                context.swapBuffers();
+                context.setupViewport();
+                upload.apply(renderer);
+                renderer.render();
+
+                // the video codec updates changed pixels only, so the surface
+                // itself is left untouched and only the presentation is
+                // adjusted
+                if (tomb) {
+                    renderer.setLineDoubling(false);
+                    renderer.setBrightness(1);
+                }
+            });
+
+        m_renderThread.frame();
     }
 
     return DD_OK;
@@ -611,7 +817,10 @@ HRESULT WINAPI DirectDrawSurface::Blt(LPRECT lpDestRect,
     LPDDBLTFX lpDDBltFx)
 {
     LOG_TRACE("");
-    return DDERR_UNSUPPORTED;
+
+    auto src = static_cast<DirectDrawSurface*>(lpDDSrcSurface);
+    return Blt(lpDestRect, static_cast<LPDIRECTDRAWSURFACE>(src), lpSrcRect,
+        dwFlags, lpDDBltFx);
 }
 
 HRESULT WINAPI DirectDrawSurface::BltFast(DWORD dwX, DWORD dwY,
@@ -619,7 +828,9 @@ HRESULT WINAPI DirectDrawSurface::BltFast(DWORD dwX, DWORD dwY,
 {
     LOG_TRACE("");
 
-    return DDERR_UNSUPPORTED;
+    auto src = static_cast<DirectDrawSurface*>(lpDDSrcSurface);
+    return BltFast(
+        dwX, dwY, static_cast<LPDIRECTDRAWSURFACE>(src), lpSrcRect, dwTrans);
 }
 
 HRESULT WINAPI DirectDrawSurface::DeleteAttachedSurface(
@@ -685,17 +896,266 @@ HRESULT WINAPI DirectDrawSurface::PageUnlock(DWORD dwFlags)
 }
 
 /*** Custom methods ***/
-void DirectDrawSurface::clear(int32_t color)
+void DirectDrawSurface::presentPalette()
 {
-    if (m_desc.ddpfPixelFormat.dwRGBBitCount == 8 || color == 0) {
-        std::fill(m_buffer.begin(), m_buffer.end(), color & 0xff);
-    } else if (m_desc.ddpfPixelFormat.dwRGBBitCount % 8 == 0) {
-        int32_t i = 0;
-        std::generate(m_buffer.begin(), m_buffer.end(), [this, &i, &color]() {
-            int32_t colorOffset =
-                i++ * 8 % this->m_desc.ddpfPixelFormat.dwRGBBitCount;
-            return (color >> colorOffset) & 0xff;
+    // only palettized surfaces are affected by the palette
+    if (m_desc.ddpfPixelFormat.dwRGBBitCount != 8) {
+        return;
+    }
+
+    auto upload = prepareUpload(m_dirty);
+    m_dirty = false;
+
+    Renderer& renderer = m_renderer;
+    Context& context = m_context;
+    m_renderThread.run(
+        [&renderer, &context, upload = std::move(upload) ]() mutable {
+            upload.apply(renderer);
+            context.setupViewport();
+            renderer.render();
+            context.swapBuffers();
         });
+
+    m_renderThread.frame();
+}
+
+DirectDrawSurface::Upload DirectDrawSurface::prepareUpload(bool dirty)
+{
+    Upload upload;
+    upload.desc = m_desc;
+    upload.data = nullptr;
+
+    if (dirty) {
+        if (m_pixelBuffer) {
+            // pixel buffers aren't used together with the render thread, so
+            // they're uploaded right away
+            m_renderer.upload(m_desc, *m_pixelBuffer);
+
+            // the transfer from the pixel buffer happens asynchronously, so
+            // remember when it's safe to write to the mapped memory again
+            m_uploadFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        } else if (m_renderThread.isQueued()) {
+            // the game may write to the surface again before the render thread
+            // uploads it
+            upload.dataCopy.assign(m_data, m_data + m_dataSize);
+        } else {
+            upload.data = m_data;
+        }
+    }
+
+    // only upload palettes after they have been changed, which keeps fades and
+    // color cycling cheap
+    if (m_palette && m_palette->version() != m_paletteVersion) {
+        auto entries = m_palette->entries();
+        upload.palette.assign(entries, entries + DirectDrawPalette::SIZE);
+        m_paletteVersion = m_palette->version();
+    }
+
+    return upload;
+}
+
+bool DirectDrawSurface::isPrimary()
+{
+    // back buffers inherit the primary surface caps
+    return m_desc.ddsCaps.dwCaps & DDSCAPS_PRIMARYSURFACE &&
+           !(m_desc.ddsCaps.dwCaps & DDSCAPS_BACKBUFFER);
+}
+
+void DirectDrawSurface::Upload::apply(Renderer& renderer)
+{
+    if (!dataCopy.empty()) {
+        renderer.upload(desc, dataCopy.data());
+    } else if (data) {
+        renderer.upload(desc, data);
+    }
+
+    if (!palette.empty()) {
+        renderer.uploadPalette(palette.data());
+    }
+}
+
+HRESULT DirectDrawSurface::validateBlt(
+    DirectDrawSurface* src, DWORD dwFlags, LPDDBLTFX lpDDBltFx)
+{
+    // color fills and color key overrides need the blit parameters
+    if (dwFlags & (DDBLT_COLORFILL | DDBLT_KEYSRCOVERRIDE) && !lpDDBltFx) {
+        return DDERR_INVALIDPARAMS;
+    }
+
+    // destination color keys aren't supported
+    if (dwFlags & (DDBLT_KEYDEST | DDBLT_KEYDESTOVERRIDE)) {
+        return DDERR_UNSUPPORTED;
+    }
+
+    // the blitter can't convert pixel formats and the framebuffer is read as
+    // RGBA5551, so only 16 bit surfaces can be blitted from the primary
+    // surface, and only without a color key
+    if (src) {
+        DWORD bits = m_desc.ddpfPixelFormat.dwRGBBitCount;
+        if (src->m_desc.ddsCaps.dwCaps & DDSCAPS_PRIMARYSURFACE) {
+            if (bits != 16) {
+                return DDERR_INVALIDPIXELFORMAT;
+            }
+            if (dwFlags & (DDBLT_KEYSRC | DDBLT_KEYSRCOVERRIDE)) {
+                return DDERR_UNSUPPORTED;
+            }
+        } else if (src->m_desc.ddpfPixelFormat.dwRGBBitCount != bits) {
+            return DDERR_INVALIDPIXELFORMAT;
+        }
+    }
+
+    return DD_OK;
+}
+
+void DirectDrawSurface::bltImpl(LPRECT lpDestRect, DirectDrawSurface* src,
+    LPRECT lpSrcRect, DWORD dwFlags, LPDDBLTFX lpDDBltFx)
+{
+    if (src) {
+        int32_t dstWidth = m_desc.dwWidth;
+        int32_t dstHeight = m_desc.dwHeight;
+
+        Blitter::Rect dstRect{0, 0, dstWidth, dstHeight};
+        if (lpDestRect) {
+            dstRect.left = lpDestRect->left;
+            dstRect.top = lpDestRect->top;
+            dstRect.right = lpDestRect->right;
+            dstRect.bottom = lpDestRect->bottom;
+        }
+
+        int32_t depth = m_desc.ddpfPixelFormat.dwRGBBitCount / 8;
+
+        if (src->m_desc.ddsCaps.dwCaps & DDSCAPS_PRIMARYSURFACE) {
+            // This is a somewhat ugly and slow hack to get a rescaled and
+            // converted copy of the framebuffer for the surface, which is
+            // required to display the in-game menu of Tomb Raider correctly.
+            // The last presented frame is read from its offscreen framebuffer
+            // on the thread that owns the OpenGL context.
+            // The readback is always two bytes per pixel, which validateBlt()
+            // only allows for surfaces with the same depth.
+            int32_t width = 0;
+            int32_t height = 0;
+            std::vector<uint8_t> buffer;
+
+            m_renderThread.call([&] {
+                m_context.bindFrame(true, width, height);
+                if (width > 0 && height > 0) {
+                    gl::Screenshot::capture(buffer, width, height,
+                        sizeof(uint16_t), GL_BGRA,
+                        GL_UNSIGNED_SHORT_1_5_5_5_REV);
+                }
+            });
+
+            if (!buffer.empty()) {
+                Blitter::Rect srcRect{0, height, width, 0};
+
+                Blitter::Image srcImg{width, height, depth, &buffer[0]};
+                Blitter::Image dstImg{dstWidth, dstHeight, depth, m_data};
+
+                Blitter::blit(srcImg, srcRect, dstImg, dstRect);
+
+                if (isTombRaider()) {
+                    // simulate dimming of DOS/PSX menu
+                    rgba5551AdjustBrightness(false);
+                }
+            }
+        } else {
+            int32_t srcWidth = src->m_desc.dwWidth;
+            int32_t srcHeight = src->m_desc.dwHeight;
+
+            Blitter::Rect srcRect{0, 0, srcWidth, srcHeight};
+
+            if (lpSrcRect) {
+                srcRect.left = lpSrcRect->left;
+                srcRect.top = lpSrcRect->top;
+                srcRect.right = lpSrcRect->right;
+                srcRect.bottom = lpSrcRect->bottom;
+            }
+
+            Blitter::Image srcImg{srcWidth, srcHeight, depth, src->m_data};
+            Blitter::Image dstImg{dstWidth, dstHeight, depth, m_data};
+
+            // the color key is either passed with the blit or taken from the
+            // source surface
+            bool colorKeyEn = false;
+            uint32_t colorKey = 0;
+            if (dwFlags & DDBLT_KEYSRCOVERRIDE) {
+                colorKey = lpDDBltFx->ddckSrcColorkey.dwColorSpaceLowValue;
+                colorKeyEn = true;
+            } else if (dwFlags & DDBLT_KEYSRC &&
+                       src->m_desc.dwFlags & DDSD_CKSRCBLT) {
+                colorKey = src->m_desc.ddckCKSrcBlt.dwColorSpaceLowValue;
+                colorKeyEn = true;
+            }
+
+            // unscaled and unmirrored rectangles within both surfaces are
+            // copied row by row
+            auto inside = [](Blitter::Rect& rect, Blitter::Image& img) {
+                return rect.left >= 0 && rect.top >= 0 &&
+                       rect.left < rect.right && rect.top < rect.bottom &&
+                       rect.right <= img.width && rect.bottom <= img.height;
+            };
+            bool unscaled = srcRect.width() == dstRect.width() &&
+                            srcRect.height() == dstRect.height() &&
+                            inside(srcRect, srcImg) && inside(dstRect, dstImg);
+
+            if (!colorKeyEn) {
+                Blitter::blit(srcImg, srcRect, dstImg, dstRect);
+            } else if (unscaled) {
+                Blitter::copyColorKey(srcImg, srcRect, dstImg, dstRect.left,
+                    dstRect.top, colorKey);
+            } else {
+                Blitter::blitColorKey(
+                    srcImg, srcRect, dstImg, dstRect, colorKey);
+            }
+        }
+    }
+
+    if (dwFlags & DDBLT_COLORFILL) {
+        if (lpDestRect && m_desc.ddpfPixelFormat.dwRGBBitCount % 8 == 0) {
+            // only fill the destination rectangle
+            int32_t dstWidth = m_desc.dwWidth;
+            int32_t dstHeight = m_desc.dwHeight;
+            int32_t depth = m_desc.ddpfPixelFormat.dwRGBBitCount / 8;
+
+            Blitter::Rect dstRect;
+            dstRect.left = lpDestRect->left;
+            dstRect.top = lpDestRect->top;
+            dstRect.right = lpDestRect->right;
+            dstRect.bottom = lpDestRect->bottom;
+
+            Blitter::Image dstImg{dstWidth, dstHeight, depth, m_data};
+            Blitter::fill(dstImg, dstRect, lpDDBltFx->dwFillColor);
+            m_dirty = true;
+        } else {
+            clear(lpDDBltFx->dwFillColor);
+        }
+    }
+
+    if (dwFlags & DDBLT_DEPTHFILL && m_depthBuffer) {
+        m_depthBuffer->waitForUpload();
+        m_depthBuffer->clear(0);
+    }
+}
+
+void DirectDrawSurface::waitForUpload()
+{
+    if (!m_uploadFence) {
+        return;
+    }
+
+    // wait for one second at most, which should be plenty for a single
+    // texture transfer
+    glClientWaitSync(
+        m_uploadFence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000 * 1000 * 1000);
+    glDeleteSync(m_uploadFence);
+    m_uploadFence = nullptr;
+}
+
+void DirectDrawSurface::clear(int32_t color)
+{
+    if (m_desc.ddpfPixelFormat.dwRGBBitCount % 8 == 0) {
+        int32_t depth = m_desc.ddpfPixelFormat.dwRGBBitCount / 8;
+        Blitter::fill(m_data, m_dataSize, depth, color);
     } else {
         // TODO: support odd bit counts?
     }
@@ -712,28 +1172,10 @@ void DirectDrawSurface::rgba5551AdjustBrightness(bool brighten)
     }
 
     // living on the edge...
-    auto buf = reinterpret_cast<uint16_t*>(&m_buffer[0]);
-    int32_t size = m_desc.dwWidth * m_desc.dwHeight;
-
-    for (int32_t i = 0; i < size; i++) {
-        for (int32_t j = 0; j < 15; j += 5) {
-            // extract channel
-            uint16_t c = (buf[i] >> j) & 0x1f;
-
-            // update value
-            if (brighten) {
-                c *= 2;
-            } else {
-                c /= 2;
-            }
-
-            // clear channel bits
-            buf[i] &= ~(0x1f << j);
+    auto buf = reinterpret_cast<uint16_t*>(m_data);
+    size_t count = m_desc.dwWidth * m_desc.dwHeight;
 
-            // write channel bits
-            buf[i] |= c << j;
-        }
-    }
+    Blitter::rgba5551Brightness(buf, count, brighten);
 }
 
 bool DirectDrawSurface::isTombRaider()
@@ -2,6 +2,7 @@
 
 #include "DirectDraw.hpp"
 #include "DirectDrawClipper.hpp"
+#include "DirectDrawPalette.hpp"
 #include "Renderer.hpp"
 #include "Unknown.hpp"
 #include "ddraw.hpp"
@@ -9,6 +10,7 @@
 #include <glrage/GLRage.hpp>
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace glrage {
@@ -100,19 +102,57 @@ public:
     HRESULT WINAPI PageLock(DWORD dwFlags);                  // added in v2
     HRESULT WINAPI PageUnlock(DWORD dwFlags);                // added in v2
 
+    /*** Custom methods ***/
+    // presents the surface again after its palette has been changed
+    void presentPalette();
+
 private:
+    // surface contents and palette changes for the renderer, which are copied
+    // if the render thread uploads them after the game has moved on
+    struct Upload
+    {
+        DDSURFACEDESC desc;
+        uint8_t* data;
+        std::vector<uint8_t> dataCopy;
+        std::vector<PALETTEENTRY> palette;
+
+        void apply(Renderer& renderer);
+    };
+
     Context& m_context = GLRage::getContext();
+    Profiler& m_profiler = GLRage::getProfiler();
+    RenderThread& m_renderThread = GLRage::getRenderThread();
     DirectDraw& m_dd;
     Renderer& m_renderer;
+    Recorder* m_recorder;
     std::vector<uint8_t> m_buffer;
+    std::unique_ptr<gl::Buffer> m_pixelBuffer;
+    uint8_t* m_data = nullptr;
+    size_t m_dataSize = 0;
+    GLsync m_uploadFence = nullptr;
     DDSURFACEDESC m_desc;
     DirectDrawSurface* m_backBuffer = nullptr;
     DirectDrawSurface* m_depthBuffer = nullptr;
     DirectDrawClipper* m_clipper = nullptr;
+    DirectDrawPalette* m_palette = nullptr;
+    uint32_t m_paletteVersion = 0;
     bool m_locked = false;
     bool m_dirty = false;
 
-    /*** Custom methods ***/
+    Upload prepareUpload(bool dirty);
+    bool isPrimary();
+
+    // checks the parameters of Blt and BltBatch entries
+    HRESULT validateBlt(
+        DirectDrawSurface* src, DWORD dwFlags, LPDDBLTFX lpDDBltFx);
+
+    // performs a validated blit, pending uploads must have been waited for
+    void bltImpl(LPRECT lpDestRect, DirectDrawSurface* src, LPRECT lpSrcRect,
+        DWORD dwFlags, LPDDBLTFX lpDDBltFx);
+
+    void waitForUpload();
+
+    // these expect that pending uploads have been waited for as well
     void clear(int32_t color);
     void rgba5551AdjustBrightness(bool brighten);
     bool isTombRaider();
@@ -4,11 +4,14 @@
 #include <glrage_util/ErrorUtils.hpp>
 #include <glrage_util/Logger.hpp>
 
+#include <memory>
 #include <string>
 
 namespace glrage {
 namespace ddraw {
 
+static std::unique_ptr<Recorder> recorder;
+
 HRESULT WINAPI DirectDrawCreate(
     GUID FAR* lpGUID, LPDIRECTDRAW FAR* lplpDD, IUnknown FAR* pUnkOuter)
 {
@@ -18,10 +21,25 @@ HRESULT WINAPI DirectDrawCreate(
     context.init();
     context.attach();
 
+    Logger::setCurrent(&GLRage::getLogger());
+    Tracer::setCurrent(&GLRage::getTracer());
+
     ErrorUtils::setHWnd(context.getHWnd());
 
+    // record all calls for the replay tool if enabled, the trace spans all
+    // DirectDraw objects until the game exits
+    Config& config = GLRage::getConfig();
+    if (!recorder && config.getBool("directdraw.record", false)) {
+        try {
+            recorder = std::make_unique<Recorder>(
+                context.getBasePath() + L"\\ddraw.trace");
+        } catch (const std::exception& ex) {
+            LOG_INFO("Can't record DirectDraw calls: %s", ex.what());
+        }
+    }
+
     try {
-        *lplpDD = new DirectDraw();
+        *lplpDD = new DirectDraw(recorder.get());
     } catch (const std::exception& ex) {
         ErrorUtils::warning(ex);
         return DDERR_GENERIC;
@@ -0,0 +1,274 @@
+#include "Recorder.hpp"
+
+#include <glrage_util/ErrorUtils.hpp>
+#include <glrage_util/Logger.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace glrage {
+namespace ddraw {
+
+Recorder::Recorder(const std::wstring& path)
+{
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_file.good()) {
+        throw std::runtime_error(
+            "Can't open trace file: " + ErrorUtils::getSystemErrorString());
+    }
+
+    m_buffer.reserve(BUFFER_SIZE);
+
+    write(TRACE_MAGIC);
+    write(TRACE_VERSION);
+
+    LOG_INFO("Recording DirectDraw calls");
+}
+
+Recorder::~Recorder()
+{
+    flush();
+}
+
+void Recorder::displayMode(DWORD width, DWORD height, DWORD bits)
+{
+    op(TraceOp::DisplayMode);
+    write<uint32_t>(width);
+    write<uint32_t>(height);
+    write<uint32_t>(bits);
+}
+
+void Recorder::createSurface(const void* surface, const DDSURFACEDESC& desc)
+{
+    uint32_t surfaceID = id(surface);
+    m_objects[surface].created = true;
+
+    op(TraceOp::CreateSurface);
+    write(surfaceID);
+    write(desc);
+}
+
+void Recorder::getAttachedSurface(
+    const void* surface, DWORD caps, const void* attached)
+{
+    op(TraceOp::GetAttachedSurface);
+    write(id(surface));
+    write<uint32_t>(caps);
+    write(id(attached));
+}
+
+void Recorder::addAttachedSurface(const void* surface, const void* attached)
+{
+    op(TraceOp::AddAttachedSurface);
+    write(id(surface));
+    write(id(attached));
+}
+
+void Recorder::destroy(const void* object)
+{
+    auto it = m_objects.find(object);
+    if (it == m_objects.end()) {
+        return;
+    }
+
+    // only objects created by the game itself are released by the replay,
+    // attached surfaces are released by their owners
+    if (it->second.created) {
+        op(TraceOp::Destroy);
+        write(it->second.id);
+    }
+
+    // the address may be reused by a new object
+    m_objects.erase(it);
+    m_snapshots.erase(object);
+}
+
+void Recorder::createPalette(
+    const void* palette, DWORD flags, const PALETTEENTRY* entries)
+{
+    uint32_t paletteID = id(palette);
+    m_objects[palette].created = true;
+
+    op(TraceOp::CreatePalette);
+    write(paletteID);
+    write<uint32_t>(flags);
+    write(entries, 256 * sizeof(PALETTEENTRY));
+}
+
+void Recorder::setEntries(const void* palette, DWORD start, DWORD count,
+    const PALETTEENTRY* entries)
+{
+    op(TraceOp::SetEntries);
+    write(id(palette));
+    write<uint32_t>(start);
+    write<uint32_t>(count);
+    write(entries, count * sizeof(PALETTEENTRY));
+}
+
+void Recorder::setPalette(const void* surface, const void* palette)
+{
+    op(TraceOp::SetPalette);
+    write(id(surface));
+    write(id(palette));
+}
+
+void Recorder::setColorKey(const void* surface, DWORD flags, LPDDCOLORKEY key)
+{
+    DDCOLORKEY keyTmp{0, 0};
+    if (key) {
+        keyTmp = *key;
+    }
+
+    op(TraceOp::SetColorKey);
+    write(id(surface));
+    write<uint32_t>(flags);
+    write<uint32_t>(key != nullptr);
+    write(keyTmp);
+}
+
+void Recorder::lock(const void* surface, const uint8_t* data, size_t size)
+{
+    // remember the contents, which are compared on unlock
+    m_snapshots[surface].assign(data, data + size);
+}
+
+void Recorder::unlock(const void* surface, const uint8_t* data, size_t size)
+{
+    auto& snapshot = m_snapshots[surface];
+    snapshot.resize(size, 0);
+
+    // XOR the contents against the snapshot and store only the runs of
+    // changed bytes, which is usually a small fraction of the surface
+    std::vector<uint8_t> encoded;
+    std::vector<uint8_t> chunk;
+    size_t pos = 0;
+    while (pos < size) {
+        size_t start = pos;
+        while (pos < size && data[pos] == snapshot[pos]) {
+            pos++;
+        }
+
+        if (pos == size) {
+            break;
+        }
+
+        uint32_t skip = static_cast<uint32_t>(pos - start);
+
+        // extend the chunk until enough unchanged bytes follow
+        chunk.clear();
+        size_t same = 0;
+        while (pos < size && same < MIN_SKIP) {
+            uint8_t diff = data[pos] ^ snapshot[pos];
+            same = diff ? 0 : same + 1;
+            chunk.push_back(diff);
+            pos++;
+        }
+
+        // don't include the unchanged bytes at the end of the chunk
+        chunk.resize(chunk.size() - same);
+        pos -= same;
+
+        uint32_t length = static_cast<uint32_t>(chunk.size());
+        auto skipBytes = reinterpret_cast<const uint8_t*>(&skip);
+        auto lengthBytes = reinterpret_cast<const uint8_t*>(&length);
+        encoded.insert(encoded.end(), skipBytes, skipBytes + sizeof(skip));
+        encoded.insert(
+            encoded.end(), lengthBytes, lengthBytes + sizeof(length));
+        encoded.insert(encoded.end(), chunk.begin(), chunk.end());
+    }
+
+    op(TraceOp::Unlock);
+    write(id(surface));
+    write(static_cast<uint32_t>(encoded.size()));
+    write(encoded.data(), encoded.size());
+
+    m_snapshots.erase(surface);
+}
+
+void Recorder::blt(const void* surface, LPRECT dstRect, const void* src,
+    LPRECT srcRect, DWORD flags, LPDDBLTFX bltFx)
+{
+    op(TraceOp::Blt);
+    write(id(surface));
+    write(src ? id(src) : 0);
+    rect(dstRect);
+    rect(srcRect);
+    write<uint32_t>(flags);
+    write<uint32_t>(bltFx ? bltFx->dwFillColor : 0);
+    write(bltFx ? bltFx->ddckSrcColorkey : DDCOLORKEY{0, 0});
+}
+
+void Recorder::bltFast(const void* surface, DWORD x, DWORD y, const void* src,
+    LPRECT srcRect, DWORD trans)
+{
+    op(TraceOp::BltFast);
+    write(id(surface));
+    write<uint32_t>(x);
+    write<uint32_t>(y);
+    write(src ? id(src) : 0);
+    rect(srcRect);
+    write<uint32_t>(trans);
+}
+
+void Recorder::flip(const void* surface)
+{
+    op(TraceOp::Flip);
+    write(id(surface));
+}
+
+void Recorder::flush()
+{
+    if (m_buffer.empty()) {
+        return;
+    }
+
+    m_file.write(
+        reinterpret_cast<const char*>(m_buffer.data()), m_buffer.size());
+    m_file.flush();
+    m_buffer.clear();
+}
+
+uint32_t Recorder::id(const void* object)
+{
+    if (!object) {
+        return 0;
+    }
+
+    auto it = m_objects.find(object);
+    if (it != m_objects.end()) {
+        return it->second.id;
+    }
+
+    uint32_t objectID = m_nextID++;
+    m_objects[object] = Object{objectID, false};
+    return objectID;
+}
+
+void Recorder::rect(LPRECT rect)
+{
+    RECT rectTmp{0, 0, 0, 0};
+    if (rect) {
+        rectTmp = *rect;
+    }
+
+    write<uint32_t>(rect != nullptr);
+    write(rectTmp);
+}
+
+void Recorder::op(TraceOp code)
+{
+    write(code);
+}
+
+void Recorder::write(const void* data, size_t size)
+{
+    auto bytes = static_cast<const uint8_t*>(data);
+    m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+
+    if (m_buffer.size() >= BUFFER_SIZE) {
+        flush();
+    }
+}
+
+} // namespace ddraw
+} // namespace glrage
\ No newline at end of file
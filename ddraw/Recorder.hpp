@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Trace.hpp"
+#include "ddraw.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace glrage {
+namespace ddraw {
+
+// Serializes DirectDraw surface and palette calls into a trace file that can
+// be replayed outside of the game with the ddrawreplay tool. Surface contents
+// are recorded as compressed differences between Lock and Unlock, so static
+// surfaces and partial updates stay small.
+class Recorder
+{
+public:
+    Recorder(const std::wstring& path);
+    ~Recorder();
+    void displayMode(DWORD width, DWORD height, DWORD bits);
+    void createSurface(const void* surface, const DDSURFACEDESC& desc);
+    void getAttachedSurface(
+        const void* surface, DWORD caps, const void* attached);
+    void addAttachedSurface(const void* surface, const void* attached);
+    void destroy(const void* object);
+    void createPalette(
+        const void* palette, DWORD flags, const PALETTEENTRY* entries);
+    void setEntries(const void* palette, DWORD start, DWORD count,
+        const PALETTEENTRY* entries);
+    void setPalette(const void* surface, const void* palette);
+    void setColorKey(const void* surface, DWORD flags, LPDDCOLORKEY key);
+    void lock(const void* surface, const uint8_t* data, size_t size);
+    void unlock(const void* surface, const uint8_t* data, size_t size);
+    void blt(const void* surface, LPRECT dstRect, const void* src,
+        LPRECT srcRect, DWORD flags, LPDDBLTFX bltFx);
+    void bltFast(const void* surface, DWORD x, DWORD y, const void* src,
+        LPRECT srcRect, DWORD trans);
+    void flip(const void* surface);
+    void flush();
+
+private:
+    // size of the write buffer before it's flushed to the file
+    static const size_t BUFFER_SIZE = 4 << 20;
+
+    // minimum number of unchanged bytes that end a chunk of changed bytes
+    static const size_t MIN_SKIP = 8;
+
+    struct Object
+    {
+        uint32_t id;
+        bool created;
+    };
+
+    uint32_t id(const void* object);
+    void rect(LPRECT rect);
+    void op(TraceOp code);
+    void write(const void* data, size_t size);
+
+    template <typename T>
+    void write(const T& value)
+    {
+        write(&value, sizeof(T));
+    }
+
+    std::ofstream m_file;
+    std::vector<uint8_t> m_buffer;
+    std::map<const void*, Object> m_objects;
+    std::map<const void*, std::vector<uint8_t>> m_snapshots;
+    uint32_t m_nextID{1};
+};
+
+} // namespace ddraw
+} // namespace glrage
\ No newline at end of file
@@ -2,6 +2,9 @@
 
 #include <glrage_gl/Shader.hpp>
 #include <glrage_gl/Utils.hpp>
+#include <glrage_util/Tracer.hpp>
+
+#include <algorithm>
 
 namespace glrage {
 namespace ddraw {
@@ -23,41 +26,155 @@ Renderer::Renderer()
     m_sampler.parameteri(GL_TEXTURE_MAG_FILTER, filterMethodEnum);
     m_sampler.parameteri(GL_TEXTURE_MIN_FILTER, filterMethodEnum);
 
+    // persistently mapped pixel buffers require GL_ARB_buffer_storage and
+    // can't be written by the game while the render thread owns the context
+    m_pixelBuffers = m_config.getBool("directdraw.pixel_buffers", false) &&
+                     !m_config.getBool("context.render_thread", false) &&
+                     ogl_ext_ARB_buffer_storage;
+
     // configure shaders
     std::wstring basePath = m_context.getBasePath();
     m_program.attach(gl::Shader(GL_VERTEX_SHADER)
-                         .fromFile(basePath + L"\\shaders\\ddraw.vsh"));
+                         .fromFile(basePath + L"/shaders/ddraw.vsh"));
     m_program.attach(gl::Shader(GL_FRAGMENT_SHADER)
-                         .fromFile(basePath + L"\\shaders\\ddraw.fsh"));
+                         .fromFile(basePath + L"/shaders/ddraw.fsh"));
     m_program.link();
     m_program.fragmentData("fragColor");
 
     gl::Utils::checkError(__FUNCTION__);
 }
 
-void Renderer::upload(DDSURFACEDESC& desc, std::vector<uint8_t>& data)
+std::unique_ptr<gl::Buffer> Renderer::createPixelBuffer(
+    size_t size, uint8_t** data)
 {
+    if (!m_pixelBuffers) {
+        return nullptr;
+    }
+
+    // Create an immutable buffer that stays mapped for its entire lifetime,
+    // so surfaces can be locked and written directly without a copy. The
+    // mapping is coherent, which makes explicit flushes unnecessary. Read
+    // access is still required for blits and brightness adjustments.
+    GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT |
+                       GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    auto buffer = std::make_unique<gl::Buffer>(GL_PIXEL_UNPACK_BUFFER);
+    buffer->bind();
+    buffer->storage(size, nullptr, flags);
+    *data = static_cast<uint8_t*>(buffer->mapRange(0, size, flags));
+    buffer->unbind();
+
+    gl::Utils::checkError(__FUNCTION__);
+
+    if (!*data) {
+        return nullptr;
+    }
+
+    // surfaces are expected to be cleared after creation
+    std::fill_n(*data, size, 0);
+
+    return buffer;
+}
+
+void Renderer::upload(DDSURFACEDESC& desc, gl::Buffer& buffer)
+{
+    // with a pixel unpack buffer bound, the data pointer is interpreted as an
+    // offset into the buffer, so the upload is performed without any copy on
+    // the CPU side
+    buffer.bind();
+    upload(desc, static_cast<uint8_t*>(nullptr));
+    buffer.unbind();
+}
+
+void Renderer::upload(DDSURFACEDESC& desc, uint8_t* data)
+{
+    TRACE_SCOPE(__FUNCTION__);
+
     m_surfaceTexture.bind();
+    m_uploadBytes += desc.lPitch * desc.dwHeight;
+
+    // palettized surfaces are uploaded as plain indices, which are resolved
+    // to colors in the fragment shader
+    bool palettized = desc.ddpfPixelFormat.dwRGBBitCount == 8;
+    GLenum internalFormat =
+        palettized ? TEX_INTERNAL_FORMAT_8 : TEX_INTERNAL_FORMAT;
+    GLenum format = palettized ? TEX_FORMAT_8 : TEX_FORMAT;
+    GLenum type = palettized ? TEX_TYPE_8 : TEX_TYPE;
+
+    // rows of 8 bit surfaces aren't necessarily 4 byte aligned
+    if (palettized) {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    }
 
     // update buffer if the size is unchanged, otherwise create a new one
-    if (desc.dwWidth != m_width || desc.dwHeight != m_height) {
+    if (desc.dwWidth != m_width || desc.dwHeight != m_height ||
+        palettized != m_palettized) {
         m_width = desc.dwWidth;
         m_height = desc.dwHeight;
-        glTexImage2D(GL_TEXTURE_2D, 0, TEX_INTERNAL_FORMAT, m_width, m_height,
-            0, TEX_FORMAT, TEX_TYPE, &data[0]);
+        m_palettized = palettized;
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, m_width, m_height, 0,
+            format, type, data);
     } else {
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, TEX_FORMAT,
-            TEX_TYPE, &data[0]);
+        glTexSubImage2D(
+            GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, format, type, data);
+    }
+
+    if (palettized) {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
     }
 }
 
+void Renderer::uploadPalette(const PALETTEENTRY* entries)
+{
+    glActiveTexture(GL_TEXTURE1);
+    m_paletteTexture.bind();
+
+    // PALETTEENTRY has the same layout as RGBA8 texels
+    if (!m_paletteCreated) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, PALETTE_SIZE, 1, 0, GL_RGBA,
+            GL_UNSIGNED_BYTE, entries);
+        m_paletteCreated = true;
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, PALETTE_SIZE, 1, GL_RGBA,
+            GL_UNSIGNED_BYTE, entries);
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+
+    gl::Utils::checkError(__FUNCTION__);
+}
+
+void Renderer::setBrightness(float brightness)
+{
+    m_brightness = brightness;
+}
+
+void Renderer::setLineDoubling(bool lineDoubling)
+{
+    m_lineDoubling = lineDoubling;
+}
+
 void Renderer::render()
 {
+    TRACE_SCOPE(__FUNCTION__);
+
     m_program.bind();
+    m_program.uniform1f("brightness", m_brightness);
+    m_program.uniform1i("lineDoubling", m_lineDoubling);
+    m_program.uniform1i("palettized", m_palettized);
+    m_program.uniform1i("tex1", 1);
     m_surfaceFormat.bind();
     m_surfaceTexture.bind();
     m_sampler.bind(0);
 
+    if (m_palettized) {
+        glActiveTexture(GL_TEXTURE1);
+        m_paletteTexture.bind();
+        glActiveTexture(GL_TEXTURE0);
+    }
+
     GLboolean blend = glIsEnabled(GL_BLEND);
     if (blend) {
         glDisable(GL_BLEND);
@@ -81,5 +198,10 @@ void Renderer::render()
     gl::Utils::checkError(__FUNCTION__);
 }
 
+uint64_t Renderer::uploadBytes()
+{
+    return m_uploadBytes;
+}
+
 } // namespace ddraw
 } // namespace glrage
\ No newline at end of file
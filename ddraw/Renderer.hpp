@@ -11,7 +11,7 @@
 #include <glrage_util/Config.hpp>
 
 #include <cstdint>
-#include <vector>
+#include <memory>
 
 namespace glrage {
 namespace ddraw {
@@ -20,20 +20,37 @@ class Renderer
 {
 public:
     Renderer();
-    void upload(DDSURFACEDESC& desc, std::vector<uint8_t>& data);
+    std::unique_ptr<gl::Buffer> createPixelBuffer(size_t size, uint8_t** data);
+    void upload(DDSURFACEDESC& desc, uint8_t* data);
+    void upload(DDSURFACEDESC& desc, gl::Buffer& buffer);
+    void uploadPalette(const PALETTEENTRY* entries);
+    void setBrightness(float brightness);
+    void setLineDoubling(bool lineDoubling);
     void render();
+    uint64_t uploadBytes();
 
 private:
     static const GLenum TEX_INTERNAL_FORMAT = GL_RGBA;
     static const GLenum TEX_FORMAT = GL_BGRA;
     static const GLenum TEX_TYPE = GL_UNSIGNED_SHORT_1_5_5_5_REV;
+    static const GLenum TEX_INTERNAL_FORMAT_8 = GL_R8;
+    static const GLenum TEX_FORMAT_8 = GL_RED;
+    static const GLenum TEX_TYPE_8 = GL_UNSIGNED_BYTE;
+    static const GLsizei PALETTE_SIZE = 256;
 
     Context& m_context{GLRage::getContext()};
     Config& m_config{GLRage::getConfig()};
     uint32_t m_width = 0;
     uint32_t m_height = 0;
+    bool m_palettized = false;
+    bool m_paletteCreated = false;
+    bool m_pixelBuffers = false;
+    float m_brightness = 1;
+    bool m_lineDoubling = false;
+    uint64_t m_uploadBytes = 0;
     gl::VertexArray m_surfaceFormat;
     gl::Texture m_surfaceTexture = GL_TEXTURE_2D;
+    gl::Texture m_paletteTexture = GL_TEXTURE_2D;
     gl::Sampler m_sampler;
     gl::Program m_program;
 };
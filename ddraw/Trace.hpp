@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+namespace glrage {
+namespace ddraw {
+
+// Binary format of DirectDraw call traces, written by Recorder and read by
+// the ddrawreplay tool.
+//
+// A trace starts with TRACE_MAGIC and TRACE_VERSION, followed by records that
+// consist of a one byte opcode and its payload. Surfaces and palettes are
+// referenced by ids that are assigned in the order the objects are first
+// seen, starting at 1, with 0 standing for no object. Surface contents are
+// stored per lock as the XOR difference to the contents at the time of the
+// lock, which is run-length encoded as a sequence of chunks:
+//
+//   u32 unchanged bytes, u32 changed bytes, XOR data of the changed bytes
+static const uint32_t TRACE_MAGIC = 0x54524444; // "DDRT"
+static const uint32_t TRACE_VERSION = 2;
+
+enum class TraceOp : uint8_t
+{
+    // u32 width, u32 height, u32 bits per pixel
+    DisplayMode,
+
+    // u32 surface id, DDSURFACEDESC
+    CreateSurface,
+
+    // u32 surface id, u32 caps, u32 attached surface id
+    GetAttachedSurface,
+
+    // u32 surface id, u32 attached surface id
+    AddAttachedSurface,
+
+    // u32 surface or palette id, released by the replay
+    Destroy,
+
+    // u32 palette id, u32 flags, 256 PALETTEENTRY
+    CreatePalette,
+
+    // u32 palette id, u32 start, u32 count, PALETTEENTRY per entry
+    SetEntries,
+
+    // u32 surface id, u32 palette id
+    SetPalette,
+
+    // u32 surface id, u32 flags, u32 has key, DDCOLORKEY
+    SetColorKey,
+
+    // u32 surface id, u32 encoded size, encoded XOR difference
+    Unlock,
+
+    // u32 dst id, u32 src id, u32 has dst rect, RECT, u32 has src rect,
+    // RECT, u32 flags, u32 fill color, DDCOLORKEY source color key override
+    Blt,
+
+    // u32 dst id, u32 x, u32 y, u32 src id, u32 has src rect, RECT,
+    // u32 trans
+    BltFast,
+
+    // u32 surface id
+    Flip,
+};
+
+} // namespace ddraw
+} // namespace glrage
\ No newline at end of file
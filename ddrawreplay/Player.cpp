@@ -0,0 +1,337 @@
+#include "Player.hpp"
+
+#include <fstream>
+#include <stdexcept>
+
+namespace glrage {
+namespace ddraw {
+
+Player::Player(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.good()) {
+        throw std::runtime_error("Can't open trace file " + path);
+    }
+
+    // load the entire trace upfront so file access doesn't affect the timing
+    m_data.assign(std::istreambuf_iterator<char>(file),
+        std::istreambuf_iterator<char>());
+
+    if (read<uint32_t>() != TRACE_MAGIC) {
+        throw std::runtime_error("Not a DirectDraw trace: " + path);
+    }
+
+    uint32_t version = read<uint32_t>();
+    if (version != TRACE_VERSION) {
+        throw std::runtime_error(
+            "Unsupported trace version " + std::to_string(version));
+    }
+}
+
+std::vector<Player::Frame> Player::play()
+{
+    // rewind to the first record
+    m_pos = sizeof(TRACE_MAGIC) + sizeof(TRACE_VERSION);
+    m_frames.clear();
+    m_frame = Frame{0, 0, 0, 0};
+
+    m_dd = new DirectDraw();
+
+    uint64_t uploadBytes = m_dd->renderer().uploadBytes();
+    m_frameStart = TimeUtils::Clock::now();
+
+    while (m_pos < m_data.size()) {
+        dispatch(read<TraceOp>());
+
+        uint64_t uploadBytesNew = m_dd->renderer().uploadBytes();
+        m_frame.uploadBytes += uploadBytesNew - uploadBytes;
+        uploadBytes = uploadBytesNew;
+    }
+
+    // release everything the game didn't release before the recording ended
+    for (auto& it : m_surfaces) {
+        it.second->Release();
+    }
+
+    for (auto& it : m_palettes) {
+        it.second->Release();
+    }
+
+    m_surfaces.clear();
+    m_attached.clear();
+    m_palettes.clear();
+
+    m_dd->Release();
+    m_dd = nullptr;
+
+    return m_frames;
+}
+
+void Player::dispatch(TraceOp op)
+{
+    switch (op) {
+        case TraceOp::DisplayMode: {
+            auto width = read<uint32_t>();
+            auto height = read<uint32_t>();
+            auto bits = read<uint32_t>();
+            m_dd->SetDisplayMode(width, height, bits);
+            break;
+        }
+
+        case TraceOp::CreateSurface: {
+            auto id = read<uint32_t>();
+            auto desc = read<DDSURFACEDESC>();
+
+            LPDIRECTDRAWSURFACE surface = nullptr;
+            m_dd->CreateSurface(&desc, &surface, nullptr);
+            m_surfaces[id] = static_cast<DirectDrawSurface*>(surface);
+            break;
+        }
+
+        case TraceOp::GetAttachedSurface: {
+            auto parent = surface(read<uint32_t>());
+            DDSCAPS caps{read<uint32_t>()};
+            auto id = read<uint32_t>();
+
+            // attached surfaces are owned by their parent, so they're only
+            // looked up and never released by the replay
+            LPDIRECTDRAWSURFACE attached = nullptr;
+            parent->GetAttachedSurface(&caps, &attached);
+            if (attached && id) {
+                m_attached[id] = static_cast<DirectDrawSurface*>(attached);
+            }
+            break;
+        }
+
+        case TraceOp::AddAttachedSurface: {
+            auto parent = surface(read<uint32_t>());
+            LPDIRECTDRAWSURFACE attached = surface(read<uint32_t>());
+            parent->AddAttachedSurface(attached);
+            break;
+        }
+
+        case TraceOp::Destroy: {
+            auto id = read<uint32_t>();
+
+            auto surfaceIt = m_surfaces.find(id);
+            if (surfaceIt != m_surfaces.end()) {
+                surfaceIt->second->Release();
+                m_surfaces.erase(surfaceIt);
+            }
+
+            auto paletteIt = m_palettes.find(id);
+            if (paletteIt != m_palettes.end()) {
+                paletteIt->second->Release();
+                m_palettes.erase(paletteIt);
+            }
+            break;
+        }
+
+        case TraceOp::CreatePalette: {
+            auto id = read<uint32_t>();
+            auto flags = read<uint32_t>();
+
+            std::vector<PALETTEENTRY> entries(DirectDrawPalette::SIZE);
+            memcpy(entries.data(), read(entries.size() * sizeof(PALETTEENTRY)),
+                entries.size() * sizeof(PALETTEENTRY));
+
+            LPDIRECTDRAWPALETTE palette = nullptr;
+            m_dd->CreatePalette(flags, entries.data(), &palette, nullptr);
+            m_palettes[id] = static_cast<DirectDrawPalette*>(palette);
+            break;
+        }
+
+        case TraceOp::SetEntries: {
+            auto target = palette(read<uint32_t>());
+            auto start = read<uint32_t>();
+            auto count = read<uint32_t>();
+
+            std::vector<PALETTEENTRY> entries(count);
+            memcpy(entries.data(), read(count * sizeof(PALETTEENTRY)),
+                count * sizeof(PALETTEENTRY));
+
+            target->SetEntries(0, start, count, entries.data());
+            break;
+        }
+
+        case TraceOp::SetPalette: {
+            auto target = surface(read<uint32_t>());
+            auto paletteID = read<uint32_t>();
+            target->SetPalette(paletteID ? palette(paletteID) : nullptr);
+            break;
+        }
+
+        case TraceOp::SetColorKey: {
+            auto target = surface(read<uint32_t>());
+            auto flags = read<uint32_t>();
+            auto hasKey = read<uint32_t>();
+            auto key = read<DDCOLORKEY>();
+            target->SetColorKey(flags, hasKey ? &key : nullptr);
+            break;
+        }
+
+        case TraceOp::Unlock:
+            unlock();
+            break;
+
+        case TraceOp::Blt: {
+            auto target = surface(read<uint32_t>());
+            auto srcID = read<uint32_t>();
+            auto hasDstRect = read<uint32_t>();
+            auto dstRect = read<RECT>();
+            auto hasSrcRect = read<uint32_t>();
+            auto srcRect = read<RECT>();
+            auto flags = read<uint32_t>();
+
+            DDBLTFX bltFx;
+            memset(&bltFx, 0, sizeof(bltFx));
+            bltFx.dwSize = sizeof(bltFx);
+            bltFx.dwFillColor = read<uint32_t>();
+            bltFx.ddckSrcColorkey = read<DDCOLORKEY>();
+
+            LPDIRECTDRAWSURFACE src = srcID ? surface(srcID) : nullptr;
+
+            auto start = TimeUtils::Clock::now();
+            target->Blt(hasDstRect ? &dstRect : nullptr, src,
+                hasSrcRect ? &srcRect : nullptr, flags, &bltFx);
+            std::chrono::duration<double, std::milli> time =
+                TimeUtils::Clock::now() - start;
+            m_frame.bltTime += time.count();
+            break;
+        }
+
+        case TraceOp::BltFast: {
+            auto target = surface(read<uint32_t>());
+            auto x = read<uint32_t>();
+            auto y = read<uint32_t>();
+            auto srcID = read<uint32_t>();
+            auto hasSrcRect = read<uint32_t>();
+            auto srcRect = read<RECT>();
+            auto trans = read<uint32_t>();
+
+            LPDIRECTDRAWSURFACE src = srcID ? surface(srcID) : nullptr;
+
+            auto start = TimeUtils::Clock::now();
+            target->BltFast(
+                x, y, src, hasSrcRect ? &srcRect : nullptr, trans);
+            std::chrono::duration<double, std::milli> time =
+                TimeUtils::Clock::now() - start;
+            m_frame.bltTime += time.count();
+            break;
+        }
+
+        case TraceOp::Flip: {
+            auto target = surface(read<uint32_t>());
+            target->Flip(static_cast<LPDIRECTDRAWSURFACE>(nullptr), 0);
+            endFrame();
+            break;
+        }
+
+        default:
+            throw std::runtime_error("Invalid trace opcode " +
+                                     std::to_string(static_cast<int>(op)));
+    }
+}
+
+void Player::unlock()
+{
+    auto target = surface(read<uint32_t>());
+    auto encodedSize = read<uint32_t>();
+    auto encoded = read(encodedSize);
+
+    DDSURFACEDESC desc;
+    memset(&desc, 0, sizeof(desc));
+    desc.dwSize = sizeof(desc);
+    if (FAILED(target->Lock(nullptr, &desc, DDLOCK_WAIT, nullptr))) {
+        return;
+    }
+
+    // apply the XOR difference to the locked surface
+    auto data = static_cast<uint8_t*>(desc.lpSurface);
+    size_t size = desc.lPitch * desc.dwHeight;
+    size_t pos = 0;
+    size_t encodedPos = 0;
+    while (encodedPos + 8 <= encodedSize) {
+        uint32_t skip;
+        uint32_t length;
+        memcpy(&skip, encoded + encodedPos, sizeof(skip));
+        memcpy(&length, encoded + encodedPos + 4, sizeof(length));
+        encodedPos += 8;
+
+        pos += skip;
+        if (pos + length > size || encodedPos + length > encodedSize) {
+            throw std::runtime_error("Invalid surface difference");
+        }
+
+        for (uint32_t i = 0; i < length; i++) {
+            data[pos + i] ^= encoded[encodedPos + i];
+        }
+
+        pos += length;
+        encodedPos += length;
+    }
+
+    m_frame.lockBytes += encodedSize;
+
+    target->Unlock(nullptr);
+
+    // stand-alone primary surfaces are presented on unlock, which is how
+    // video sequences are displayed
+    DWORD caps = desc.ddsCaps.dwCaps;
+    if (caps & DDSCAPS_PRIMARYSURFACE && !(caps & DDSCAPS_FLIP)) {
+        endFrame();
+    }
+}
+
+void Player::endFrame()
+{
+    // wait for the GPU so the frame time includes the rendering
+    glFinish();
+
+    auto now = TimeUtils::Clock::now();
+    std::chrono::duration<double, std::milli> time = now - m_frameStart;
+    m_frame.time = time.count();
+    m_frames.push_back(m_frame);
+
+    m_frame = Frame{0, 0, 0, 0};
+    m_frameStart = now;
+}
+
+DirectDrawSurface* Player::surface(uint32_t id)
+{
+    auto it = m_surfaces.find(id);
+    if (it != m_surfaces.end()) {
+        return it->second;
+    }
+
+    auto attachedIt = m_attached.find(id);
+    if (attachedIt != m_attached.end()) {
+        return attachedIt->second;
+    }
+
+    throw std::runtime_error("Invalid surface id " + std::to_string(id));
+}
+
+DirectDrawPalette* Player::palette(uint32_t id)
+{
+    auto it = m_palettes.find(id);
+    if (it == m_palettes.end()) {
+        throw std::runtime_error("Invalid palette id " + std::to_string(id));
+    }
+
+    return it->second;
+}
+
+const uint8_t* Player::read(size_t size)
+{
+    if (m_pos + size > m_data.size()) {
+        throw std::runtime_error("Unexpected end of trace");
+    }
+
+    const uint8_t* data = &m_data[m_pos];
+    m_pos += size;
+    return data;
+}
+
+} // namespace ddraw
+} // namespace glrage
\ No newline at end of file
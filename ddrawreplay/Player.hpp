@@ -0,0 +1,75 @@
+#pragma once
+
+#include <ddraw/DirectDraw.hpp>
+#include <ddraw/DirectDrawPalette.hpp>
+#include <ddraw/DirectDrawSurface.hpp>
+#include <ddraw/Trace.hpp>
+
+#include <glrage/GLRage.hpp>
+#include <glrage_util/TimeUtils.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace glrage {
+namespace ddraw {
+
+// Replays a DirectDraw trace written by Recorder with the DirectDraw
+// implementation of the ddraw module, translating the recorded object ids to
+// the objects of the replay.
+class Player
+{
+public:
+    struct Frame
+    {
+        // time from the end of the previous frame in milliseconds
+        double time;
+
+        // time spent in Blt and BltFast in milliseconds
+        double bltTime;
+
+        // bytes uploaded to the surface texture
+        uint64_t uploadBytes;
+
+        // bytes of encoded surface changes read from the trace
+        uint64_t lockBytes;
+    };
+
+    Player(const std::string& path);
+
+    // replay the entire trace and return the statistics of each frame
+    std::vector<Frame> play();
+
+private:
+    void dispatch(TraceOp op);
+    void unlock();
+    void endFrame();
+    DirectDrawSurface* surface(uint32_t id);
+    DirectDrawPalette* palette(uint32_t id);
+    const uint8_t* read(size_t size);
+
+    template <typename T>
+    T read()
+    {
+        T value;
+        memcpy(&value, read(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    Context& m_context{GLRage::getContext()};
+    std::vector<uint8_t> m_data;
+    size_t m_pos{0};
+    DirectDraw* m_dd{nullptr};
+    std::map<uint32_t, DirectDrawSurface*> m_surfaces;
+    std::map<uint32_t, DirectDrawSurface*> m_attached;
+    std::map<uint32_t, DirectDrawPalette*> m_palettes;
+    std::vector<Frame> m_frames;
+    Frame m_frame;
+    TimeUtils::Clock::time_point m_frameStart;
+};
+
+} // namespace ddraw
+} // namespace glrage
\ No newline at end of file
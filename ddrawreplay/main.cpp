@@ -0,0 +1,110 @@
+#include "Player.hpp"
+
+#include <glrage/GLRage.hpp>
+#include <glrage_util/Logger.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+using namespace glrage;
+
+// Replays a DirectDraw trace recorded with "record = true" in the
+// [DirectDraw] section of glrage.ini and reports frame times, blit times and
+// the amount of surface data uploaded per frame. The replay uses the
+// DirectDraw COM interfaces of the ddraw module, so it only builds on Windows
+// and isn't part of the headless CMake build.
+
+typedef ddraw::Player::Frame Frame;
+
+static double percentile(std::vector<double> times, double p)
+{
+    std::sort(times.begin(), times.end());
+    auto index = static_cast<size_t>(p / 100.0 * (times.size() - 1) + 0.5);
+    return times[index];
+}
+
+static void report(uint32_t pass, const std::vector<Frame>& frames)
+{
+    if (frames.empty()) {
+        printf("pass %u: no frames\n", pass);
+        return;
+    }
+
+    std::vector<double> times;
+    double bltTime = 0;
+    uint64_t uploadBytes = 0;
+    uint64_t lockBytes = 0;
+    for (auto& frame : frames) {
+        times.push_back(frame.time);
+        bltTime += frame.bltTime;
+        uploadBytes += frame.uploadBytes;
+        lockBytes += frame.lockBytes;
+    }
+
+    double count = static_cast<double>(frames.size());
+    double total = std::accumulate(times.begin(), times.end(), 0.0);
+    double mean = total / count;
+
+    printf("pass %u: %u frames in %.1f ms, %.1f fps\n", pass,
+        static_cast<uint32_t>(frames.size()), total, 1000.0 / mean);
+    printf("  frame ms: mean %.3f, p50 %.3f, p95 %.3f, p99 %.3f, max %.3f\n",
+        mean, percentile(times, 50), percentile(times, 95),
+        percentile(times, 99), *std::max_element(times.begin(), times.end()));
+    printf("  blit ms per frame: %.3f\n", bltTime / count);
+    printf("  KiB per frame: %.1f uploaded, %.1f changed by locks\n",
+        uploadBytes / count / 1024.0, lockBytes / count / 1024.0);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        printf("usage: ddrawreplay <trace> [passes] [frames.csv]\n");
+        return 1;
+    }
+
+    uint32_t passes = argc > 2 ? (std::max)(atoi(argv[2]), 1) : 1;
+
+    try {
+        Logger::setCurrent(&GLRage::getLogger());
+        Tracer::setCurrent(&GLRage::getTracer());
+
+        Context& context = GLRage::getContext();
+        context.init();
+
+        printf("renderer: %s\n", glGetString(GL_RENDERER));
+
+        ddraw::Player player(argv[1]);
+
+        // the first pass includes shader compilation and texture allocation,
+        // so compare later passes
+        for (uint32_t pass = 1; pass <= passes; pass++) {
+            auto frames = player.play();
+            report(pass, frames);
+
+            // write the frame statistics of the last pass if requested
+            if (pass == passes && argc > 3) {
+                std::ofstream file(argv[3]);
+                file << "frame,ms,blt_ms,upload_bytes,lock_bytes\n";
+                for (size_t i = 0; i < frames.size(); i++) {
+                    auto& frame = frames[i];
+                    file << i << "," << frame.time << "," << frame.bltTime
+                         << "," << frame.uploadBytes << ","
+                         << frame.lockBytes << "\n";
+                }
+            }
+        }
+
+        context.detach();
+    } catch (const std::exception& ex) {
+        fprintf(stderr, "error: %s\n", ex.what());
+        return 1;
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -2,7 +2,9 @@
 
 #include "GameID.hpp"
 
+#ifdef _WIN32
 #include <Windows.h>
+#endif
 
 #include <cstdint>
 #include <string>
@@ -13,12 +15,8 @@ class Context
 {
 public:
     virtual void init() = 0;
-    virtual void attach(HWND hwnd) = 0;
     virtual void attach() = 0;
     virtual void detach() = 0;
-    virtual LRESULT windowProc(
-        HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) = 0;
-    virtual BOOL enumWindowsProc(HWND hwnd) = 0;
     virtual bool isFullscreen() = 0;
     virtual void setFullscreen(bool fullscreen) = 0;
     virtual void toggleFullscreen() = 0;
@@ -31,13 +29,30 @@ public:
     virtual int32_t getScreenWidth() = 0;
     virtual int32_t getScreenHeight() = 0;
     virtual void setupViewport() = 0;
+
+    // binds the frame that is currently rendered or the last presented one
+    // to GL_READ_FRAMEBUFFER and returns its size, which may differ from the
+    // viewport if the render scale isn't 1
+    virtual void bindFrame(bool front, int32_t& width, int32_t& height) = 0;
+
     virtual void swapBuffers() = 0;
     virtual void setRendered() = 0;
     virtual bool isRendered() = 0;
-    virtual HWND getHWnd() = 0;
+
+    // same as the rendering flag, but set and reset by the game's thread when
+    // it queues render blocks and buffer swaps, so it doesn't lag behind the
+    // render thread
+    virtual void setRenderQueued(bool queued) = 0;
+    virtual bool isRenderQueued() = 0;
     virtual std::wstring getBasePath() = 0;
     virtual GameID getGameID() = 0;
     virtual void setGameID(GameID gameID) = 0;
+
+#ifdef _WIN32
+    // window system integration, a headless context has no window
+    virtual void attach(HWND hwnd) = 0;
+    virtual HWND getHWnd() = 0;
+#endif
 };
 
 } // namespace glrage
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include "ContextBase.hpp"
+#include "ProfilerImpl.hpp"
+
+#include <glrage_util/Logger.hpp>
+#include <glrage_util/Tracer.hpp>
+
+#include <algorithm>
+
+namespace glrage {
+
+void ContextBase::setDisplaySize(int32_t width, int32_t height)
+{
+    LOG_INFO("Display size: %dx%d", width, height);
+
+    m_width = width;
+    m_height = height;
+
+    // update window size if not fullscreen
+    if (!isFullscreen()) {
+        setWindowSize(m_width, m_height);
+    }
+}
+
+int32_t ContextBase::getDisplayWidth()
+{
+    return m_width;
+}
+
+int32_t ContextBase::getDisplayHeight()
+{
+    return m_height;
+}
+
+void ContextBase::setupViewport()
+{
+    auto vpWidth = getWindowWidth();
+    auto vpHeight = getWindowHeight();
+
+    // default to bottom left corner of the window
+    auto vpX = 0;
+    auto vpY = 0;
+
+    auto hw = m_height * vpWidth;
+    auto wh = m_width * vpHeight;
+
+    // create viewport offset if the window has a different
+    // aspect ratio than the current display mode
+    if (hw > wh) {
+        auto wMax = wh / m_height;
+        vpX = (vpWidth - wMax) / 2;
+        vpWidth = wMax;
+    } else if (hw < wh) {
+        auto hMax = hw / m_width;
+        vpY = (vpHeight - hMax) / 2;
+        vpHeight = hMax;
+    }
+
+    m_renderTarget.setViewport(vpX, vpY, vpWidth, vpHeight);
+}
+
+void ContextBase::bindFrame(bool front, int32_t& width, int32_t& height)
+{
+    m_renderTarget.bindFrame(front, width, height);
+}
+
+void ContextBase::setRendered()
+{
+    m_render = true;
+}
+
+bool ContextBase::isRendered()
+{
+    return m_render;
+}
+
+void ContextBase::setRenderQueued(bool queued)
+{
+    m_renderQueued = queued;
+}
+
+bool ContextBase::isRenderQueued()
+{
+    return m_renderQueued;
+}
+
+GameID ContextBase::getGameID()
+{
+    return m_gameID;
+}
+
+void ContextBase::setGameID(GameID gameID)
+{
+    m_gameID = gameID;
+}
+
+void ContextBase::initGL()
+{
+    // query available extensions, which isn't done by the loader itself
+    ogl_CheckExtensions();
+
+    glClearColor(0, 0, 0, 0);
+    glClearDepth(1);
+
+    ProfilerImpl::instance().init();
+
+    // bind a render target for the whole window until a display mode is set
+    m_renderTarget.init(m_config);
+    setupViewport();
+    Tracer::instance().setEnabled(m_config.getBool("context.trace", false));
+
+    m_maxFramesInFlight =
+        (std::max)(m_config.getInt("context.max_frames_in_flight", 1), 0);
+
+    int32_t fpsLimit = m_config.getInt("context.fps_limit", 0);
+    if (fpsLimit > 0) {
+        m_frameDuration = std::chrono::nanoseconds(1000000000 / fpsLimit);
+        m_frameTime = TimeUtils::Clock::now();
+
+        // increase the timer resolution so the limiter can sleep accurately
+        if (!m_timerResolution) {
+            TimeUtils::raiseTimerResolution();
+            m_timerResolution = true;
+        }
+    }
+}
+
+void ContextBase::releaseGL()
+{
+    m_renderTarget.release();
+
+    // the fences belong to the context that is going away
+    for (GLsync fence : m_frameFences) {
+        glDeleteSync(fence);
+    }
+    m_frameFences.clear();
+
+    ProfilerImpl::instance().release();
+
+    if (m_timerResolution) {
+        TimeUtils::restoreTimerResolution();
+        m_timerResolution = false;
+    }
+}
+
+void ContextBase::beginSwap()
+{
+    // the frame's draws are complete, the following waits and presenting it
+    // don't count towards its GPU time
+    m_renderTarget.endFrame();
+
+    // wait until the frame is due if the frame rate is limited
+    if (m_frameDuration.count() > 0) {
+        m_frameTime += m_frameDuration;
+        TimeUtils::sleepUntil(m_frameTime);
+
+        // don't try to catch up with frames that took too long to render
+        auto now = TimeUtils::Clock::now();
+        if (now - m_frameTime > m_frameDuration) {
+            m_frameTime = now;
+        }
+    }
+
+    ProfilerImpl::instance().frame();
+}
+
+void ContextBase::endSwap()
+{
+    // limit the number of frames the GPU may lag behind, which bounds the
+    // input latency without draining the entire pipeline on every frame
+    m_frameFences.push_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    bool gpuBound = false;
+    while (m_frameFences.size() > m_maxFramesInFlight) {
+        GLsync fence = m_frameFences.front();
+        m_frameFences.pop_front();
+        GLenum status = glClientWaitSync(
+            fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000 * 1000 * 1000);
+        gpuBound = gpuBound || status != GL_ALREADY_SIGNALED;
+        glDeleteSync(fence);
+    }
+
+    m_renderTarget.swap(gpuBound);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    m_render = false;
+}
+
+} // namespace glrage
\ No newline at end of file
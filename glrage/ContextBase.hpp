@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Context.hpp"
+#include "RenderTarget.hpp"
+
+#include <glrage_gl/gl_core_3_3.h>
+#include <glrage_util/Config.hpp>
+#include <glrage_util/TimeUtils.hpp>
+
+#include <atomic>
+#include <deque>
+
+namespace glrage {
+
+// platform-neutral part of the context, which handles the display mode, the
+// viewport and the frame pacing
+class ContextBase : public Context
+{
+public:
+    void setDisplaySize(int32_t width, int32_t height);
+    int32_t getDisplayWidth();
+    int32_t getDisplayHeight();
+    void setupViewport();
+    void bindFrame(bool front, int32_t& width, int32_t& height);
+    void setRendered();
+    bool isRendered();
+    void setRenderQueued(bool queued);
+    bool isRenderQueued();
+    GameID getGameID();
+    void setGameID(GameID gameID);
+
+protected:
+    // called once the OpenGL context has been created and made current
+    void initGL();
+
+    // called before the OpenGL context is destroyed
+    void releaseGL();
+
+    // called before and after the frame is presented
+    void beginSwap();
+    void endSwap();
+
+    // config object
+    Config& m_config{Config::instance()};
+
+    // offscreen framebuffers the frames are rendered into
+    RenderTarget m_renderTarget;
+
+    // rendering flag, set by the render thread if enabled
+    std::atomic<bool> m_render{false};
+
+    // rendering flag of the game's thread
+    bool m_renderQueued = false;
+
+    // fences for frames that haven't been completed by the GPU yet
+    std::deque<GLsync> m_frameFences;
+    size_t m_maxFramesInFlight = 1;
+
+    // frame limiter
+    std::chrono::nanoseconds m_frameDuration{0};
+    TimeUtils::Clock::time_point m_frameTime;
+    bool m_timerResolution = false;
+
+    // DirectDraw display mode
+    int32_t m_width = 0;
+    int32_t m_height = 0;
+
+    // detected game
+    GameID m_gameID = GameID::Unknown;
+};
+
+} // namespace glrage
\ No newline at end of file
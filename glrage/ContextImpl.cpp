@@ -2,6 +2,7 @@
 
 #include <glrage_util/ErrorUtils.hpp>
 #include <glrage_util/Logger.hpp>
+#include <glrage_util/RenderThread.hpp>
 #include <glrage_util/StringUtils.hpp>
 
 #include <glrage_gl/gl_core_3_3.h>
@@ -9,6 +10,7 @@
 
 #include <Shlwapi.h>
 
+#include <algorithm>
 #include <stdexcept>
 
 namespace glrage {
@@ -35,6 +37,11 @@ ContextImpl::ContextImpl()
     // load main config file
     m_config.load(getBasePath() + L"\\glrage.ini");
 
+    // write log messages to a file in addition to the debug output
+    if (m_config.getBool("context.log", false)) {
+        Logger::instance().setFile(getBasePath() + L"\\glrage.log");
+    }
+
     // init rect
     SetRectEmpty(&m_tmprect);
 
@@ -108,12 +115,15 @@ void ContextImpl::init()
             ErrorUtils::getWindowsErrorString());
     }
 
-    glClearColor(0, 0, 0, 0);
-    glClearDepth(1);
-
     if (m_config.getBool("context.vsync", true)) {
         wglSwapIntervalEXT(1);
     }
+
+    initGL();
+
+    if (m_config.getBool("context.capture", false)) {
+        m_frameCapture.toggle();
+    }
 }
 
 void ContextImpl::attach(HWND hwnd)
@@ -164,6 +174,12 @@ void ContextImpl::attach(HWND hwnd)
 
     // apply previously applied fullscreen mode
     setFullscreen(m_fullscreen);
+
+    // hand the context over to the render thread if enabled, the game's thread
+    // only queues render commands from now on
+    if (m_config.getBool("context.render_thread", false)) {
+        startRenderThread();
+    }
 }
 
 void ContextImpl::attach()
@@ -182,6 +198,14 @@ void ContextImpl::detach()
         return;
     }
 
+    // the context must not be current on the render thread anymore
+    RenderThread::instance().stop();
+
+    wglMakeCurrent(m_hdc, m_hglrc_core);
+    m_screenshot.release();
+    releaseGL();
+    wglMakeCurrent(NULL, NULL);
+
     wglDeleteContext(m_hglrc);
     m_hglrc = nullptr;
 
@@ -203,9 +227,14 @@ ContextImpl::windowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         // hook the key and implement screenshot saving to files.
         // For some reason, VK_SNAPSHOT doesn't generate WM_KEYDOWN events but
         // only WM_KEYUP. Works just as well, though.
+        // Ctrl + Printscreen starts and stops the frame capture instead.
         case WM_KEYUP:
             if (wParam == VK_SNAPSHOT) {
-                m_screenshot.schedule(true);
+                if (GetKeyState(VK_CONTROL) & 0x8000) {
+                    m_frameCapture.toggle();
+                } else {
+                    m_screenshot.schedule(true);
+                }
                 return TRUE;
             }
             break;
@@ -316,29 +345,6 @@ void ContextImpl::toggleFullscreen()
     setFullscreen(!m_fullscreen);
 }
 
-void ContextImpl::setDisplaySize(int32_t width, int32_t height)
-{
-    LOG_INFO("Display size: %dx%d", width, height);
-
-    m_width = width;
-    m_height = height;
-
-    // update window size if not fullscreen
-    if (!m_fullscreen) {
-        setWindowSize(m_width, m_height);
-    }
-}
-
-int32_t ContextImpl::getDisplayWidth()
-{
-    return m_width;
-}
-
-int32_t ContextImpl::getDisplayHeight()
-{
-    return m_height;
-}
-
 void ContextImpl::setWindowSize(int32_t width, int32_t height)
 {
     if (!m_hwnd) {
@@ -400,36 +406,9 @@ int32_t ContextImpl::getScreenHeight()
     return m_screenHeight;
 }
 
-void ContextImpl::setupViewport()
-{
-    auto vpWidth = getWindowWidth();
-    auto vpHeight = getWindowHeight();
-
-    // default to bottom left corner of the window
-    auto vpX = 0;
-    auto vpY = 0;
-
-    auto hw = m_height * vpWidth;
-    auto wh = m_width * vpHeight;
-
-    // create viewport offset if the window has a different
-    // aspect ratio than the current display mode
-    if (hw > wh) {
-        auto wMax = wh / m_height;
-        vpX = (vpWidth - wMax) / 2;
-        vpWidth = wMax;
-    } else if (hw < wh) {
-        auto hMax = hw / m_width;
-        vpY = (vpHeight - hMax) / 2;
-        vpHeight = hMax;
-    }
-
-    glViewport(vpX, vpY, vpWidth, vpHeight);
-}
-
 void ContextImpl::swapBuffers()
 {
-    glFinish();
+    TRACE_SCOPE(__FUNCTION__);
 
     try {
         m_screenshot.captureScheduled();
@@ -438,21 +417,39 @@ void ContextImpl::swapBuffers()
         m_screenshot.schedule(false);
     }
 
+    beginSwap();
+
+    // the frame capture records the presented frame at window resolution
+    m_renderTarget.present();
+    m_frameCapture.frame();
+
     SwapBuffers(m_hdc);
-    glDrawBuffer(GL_BACK);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    m_render = false;
+    glDrawBuffer(GL_BACK);
+    endSwap();
 }
 
-void ContextImpl::setRendered()
+void ContextImpl::startRenderThread()
 {
-    m_render = true;
-}
+    // a context can only be current on one thread at a time
+    wglMakeCurrent(NULL, NULL);
 
-bool ContextImpl::isRendered()
-{
-    return m_render;
+    auto maxQueuedFrames = static_cast<uint32_t>(
+        (std::max)(m_config.getInt("context.render_thread_frames", 1), 1));
+
+    try {
+        RenderThread::instance().start(
+            [this] {
+                if (!wglMakeCurrent(m_hdc, m_hglrc_core)) {
+                    throw std::runtime_error(
+                        ErrorUtils::getWindowsErrorString());
+                }
+            },
+            [] { wglMakeCurrent(NULL, NULL); }, maxQueuedFrames);
+    } catch (const std::exception& ex) {
+        LOG_INFO("Can't start render thread: %s", ex.what());
+        wglMakeCurrent(m_hdc, m_hglrc_core);
+    }
 }
 
 HWND ContextImpl::getHWnd()
@@ -478,14 +475,4 @@ std::wstring ContextImpl::getBasePath()
     return path;
 }
 
-GameID ContextImpl::getGameID()
-{
-    return m_gameID;
-}
-
-void ContextImpl::setGameID(GameID gameID)
-{
-    m_gameID = gameID;
-}
-
 } // namespace glrage
\ No newline at end of file
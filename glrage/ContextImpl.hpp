@@ -1,13 +1,14 @@
 #pragma once
 
-#include "Context.hpp"
+#include "ContextBase.hpp"
+#include "FrameCapture.hpp"
 #include "Screenshot.hpp"
 
-#include <glrage_util/Config.hpp>
+#include <Windows.h>
 
 namespace glrage {
 
-class ContextImpl : public Context
+class ContextImpl : public ContextBase
 {
 public:
     static ContextImpl& instance();
@@ -24,37 +25,28 @@ public:
     bool isFullscreen();
     void setFullscreen(bool fullscreen);
     void toggleFullscreen();
-    void setDisplaySize(int32_t width, int32_t height);
-    int32_t getDisplayWidth();
-    int32_t getDisplayHeight();
     void setWindowSize(int32_t width, int32_t height);
     int32_t getWindowWidth();
     int32_t getWindowHeight();
     int32_t getScreenWidth();
     int32_t getScreenHeight();
-    void setupViewport();
     void swapBuffers();
-    void setRendered();
-    bool isRendered();
     HWND getHWnd();
     std::wstring getBasePath();
-    GameID getGameID();
-    void setGameID(GameID gameID);
 
 private:
     ContextImpl();
     ContextImpl(ContextImpl const&) = delete;
     void operator=(ContextImpl const&) = delete;
 
+    void startRenderThread();
+
     // constants
     static const LONG STYLE_WINDOW =
         WS_CAPTION | WS_THICKFRAME | WS_OVERLAPPED | WS_SYSMENU;
     static const LONG STYLE_WINDOW_EX = WS_EX_DLGMODALFRAME | WS_EX_WINDOWEDGE |
                                         WS_EX_CLIENTEDGE | WS_EX_STATICEDGE;
 
-    // config object
-    Config& m_config{Config::instance()};
-
     // window handle
     HWND m_hwnd = nullptr;
     HWND m_hwndTmp = nullptr;
@@ -81,25 +73,18 @@ private:
     // fullscreen override mode
     int32_t m_fullscreenMode = 0;
 
-    // rendering flag
-    bool m_render = false;
-
     // screenshot object
     Screenshot m_screenshot;
 
+    // continuous frame capture
+    FrameCapture m_frameCapture;
+
     // temporary rectangle
     RECT m_tmprect{0};
 
-    // DirectDraw display mode
-    int32_t m_width = 0;
-    int32_t m_height = 0;
-
     // Screen display mode
     int32_t m_screenWidth = 0;
     int32_t m_screenHeight = 0;
-
-    // detected game
-    GameID m_gameID = GameID::Unknown;
 };
 
 } // namespace glrage
\ No newline at end of file
@@ -10,8 +10,26 @@ BOOL APIENTRY DllMain(HINSTANCE hInst, DWORD dwReason, LPVOID lpReserved)
 
     switch (dwReason) {
         case DLL_PROCESS_ATTACH:
+            Logger::setCurrent(&Logger::instance());
+            Tracer::setCurrent(&Tracer::instance());
             GLRage::getPatcher().patch();
             break;
+
+        case DLL_PROCESS_DETACH: {
+            std::wstring basePath = GLRage::getContext().getBasePath();
+            ProfilerImpl::instance().report(basePath);
+
+            if (Tracer::instance().isEnabled()) {
+                try {
+                    Tracer::instance().write(basePath + L"\\trace.json");
+                } catch (const std::exception& ex) {
+                    LOG_INFO("Can't write trace: %s", ex.what());
+                }
+            }
+
+            Logger::instance().shutdown();
+            break;
+        }
     }
 
     return TRUE;
@@ -0,0 +1,426 @@
+#include "FrameCapture.hpp"
+#include "GLRage.hpp"
+
+#include <glrage_util/Config.hpp>
+#include <glrage_util/ErrorUtils.hpp>
+#include <glrage_util/FileUtils.hpp>
+#include <glrage_util/ImageWriter.hpp>
+#include <glrage_util/Logger.hpp>
+#include <glrage_util/StringUtils.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+namespace glrage {
+
+FrameCapture::~FrameCapture()
+{
+    // the workers are terminated already if the process is exiting, so don't
+    // join them
+    std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+    m_running = false;
+
+    for (auto& worker : m_workers) {
+        worker.detach();
+    }
+
+    if (lock.owns_lock()) {
+        m_condition.notify_all();
+    }
+}
+
+void FrameCapture::toggle()
+{
+    m_toggle = !m_toggle.load();
+}
+
+void FrameCapture::frame()
+{
+    if (m_toggle.exchange(false)) {
+        if (m_session) {
+            stop();
+        } else {
+            start();
+        }
+    }
+
+    if (!m_session) {
+        return;
+    }
+
+    // hand finished readbacks to the workers without waiting for the GPU
+    finishReadbacks(false);
+    read();
+}
+
+void FrameCapture::start()
+{
+    Config& config = Config::instance();
+
+    auto session = std::make_shared<Session>();
+
+    std::string format = config.getString("context.capture_format", "y4m");
+    if (format == "png") {
+        session->format = Format::PNG;
+    } else if (format == "tga") {
+        session->format = Format::TGA;
+    } else {
+        session->format = Format::Y4M;
+    }
+
+    session->scale = config.getInt("context.capture_scale", 1) > 1 ? 2 : 1;
+
+    int32_t fps = config.getInt("context.fps_limit", 0);
+    session->fps = fps > 0 ? fps : 60;
+
+    session->path = nextPath();
+
+    // the buffer ring and the workers are kept between captures
+    if (m_slots.empty()) {
+        int32_t numSlots = config.getInt("context.capture_buffers", 3);
+        for (int32_t i = 0; i < (std::max)(numSlots, 1); i++) {
+            m_slots.push_back(std::make_unique<Slot>());
+        }
+
+        m_persistent = ogl_ext_ARB_buffer_storage != 0;
+
+        int32_t numWorkers = config.getInt("context.capture_threads", 2);
+        numWorkers = (std::max)(numWorkers, 1);
+        for (int32_t i = 0; i < numWorkers; i++) {
+            m_workers.emplace_back(&FrameCapture::workerProc, this);
+        }
+
+        // limit the number of frames waiting for a worker, which bounds the
+        // memory usage if the workers can't keep up
+        m_maxJobs = numWorkers * 2;
+    }
+
+    m_frames = 0;
+    m_dropped = 0;
+    m_session = session;
+
+    LOG_INFO("Frame capture started: %s",
+        StringUtils::wideToUtf8(session->path).c_str());
+}
+
+void FrameCapture::stop()
+{
+    finishReadbacks(true);
+
+    LOG_INFO("Frame capture stopped: %llu frames captured, %u dropped",
+        m_frames, m_dropped);
+
+    // the file is closed by the last worker that holds the session
+    m_session.reset();
+}
+
+std::wstring FrameCapture::nextPath()
+{
+    std::wstring basePath = GLRage::getContext().getBasePath();
+
+    uint32_t nextIndex = FileUtils::nextIndex(basePath, L"capture");
+
+    std::string fileName = StringUtils::format("capture%04d", nextIndex);
+    return basePath + L"/" + StringUtils::utf8ToWide(fileName);
+}
+
+void FrameCapture::read()
+{
+    // drop the frame if the next buffer is still in use
+    Slot& slot = *m_slots[m_nextSlot];
+    if (slot.busy) {
+        m_dropped++;
+        return;
+    }
+
+    m_nextSlot = (m_nextSlot + 1) % m_slots.size();
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    uint32_t width = viewport[2];
+    uint32_t height = viewport[3];
+    size_t size = width * height * 3;
+
+    if (!slot.buffer || slot.size < size) {
+        slot.buffer = std::make_unique<gl::Buffer>(GL_PIXEL_PACK_BUFFER);
+        slot.buffer->bind();
+        slot.data = nullptr;
+        slot.size = size;
+
+        // keep the buffer mapped so the workers can read the pixels directly
+        // without a copy on this thread
+        if (m_persistent) {
+            GLbitfield flags =
+                GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            slot.buffer->storage(size, nullptr, flags);
+            slot.data =
+                static_cast<uint8_t*>(slot.buffer->mapRange(0, size, flags));
+        } else {
+            slot.buffer->data(size, nullptr, GL_STREAM_READ);
+        }
+    } else {
+        slot.buffer->bind();
+    }
+
+    GLenum format = m_session->format == Format::TGA ? GL_BGR : GL_RGB;
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadBuffer(GL_BACK);
+    glReadPixels(viewport[0], viewport[1], width, height, format,
+        GL_UNSIGNED_BYTE, nullptr);
+
+    slot.buffer->unbind();
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.width = width;
+    slot.height = height;
+    slot.busy = true;
+
+    m_pending.push_back(&slot);
+}
+
+void FrameCapture::finishReadbacks(bool wait)
+{
+    while (!m_pending.empty()) {
+        Slot* slot = m_pending.front();
+
+        GLenum status = glClientWaitSync(slot->fence,
+            wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+            wait ? 1000 * 1000 * 1000 : 0);
+        if (status == GL_TIMEOUT_EXPIRED && !wait) {
+            break;
+        }
+
+        glDeleteSync(slot->fence);
+        slot->fence = nullptr;
+        m_pending.pop_front();
+
+        Job job;
+        job.session = m_session;
+        job.slot = slot;
+        job.width = slot->width;
+        job.height = slot->height;
+
+        // copy the pixels if the buffer can't stay mapped
+        if (!slot->data) {
+            size_t size = job.width * job.height * 3;
+
+            slot->buffer->bind();
+            auto data = static_cast<uint8_t*>(
+                slot->buffer->mapRange(0, size, GL_MAP_READ_BIT));
+            if (data) {
+                job.pixels.assign(data, data + size);
+                slot->buffer->unmap();
+            }
+            slot->buffer->unbind();
+
+            job.slot = nullptr;
+            slot->busy = false;
+
+            if (!data) {
+                m_dropped++;
+                continue;
+            }
+        }
+
+        submit(job);
+    }
+}
+
+void FrameCapture::submit(Job& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_jobs.size() < m_maxJobs) {
+            job.index = m_frames++;
+            m_jobs.push_back(std::move(job));
+            m_condition.notify_one();
+            return;
+        }
+    }
+
+    // the workers can't keep up
+    if (job.slot) {
+        job.slot->busy = false;
+    }
+    m_dropped++;
+}
+
+void FrameCapture::workerProc()
+{
+    std::vector<uint8_t> frame;
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    for (;;) {
+        m_condition.wait(lock, [this] { return !m_running || !m_jobs.empty(); });
+        if (!m_running) {
+            break;
+        }
+
+        Job job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+
+        lock.unlock();
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+        try {
+            convert(job, frame, width, height);
+        } catch (const std::exception& ex) {
+            LOG_INFO("Can't convert captured frame: %s", ex.what());
+            frame.clear();
+        }
+
+        // the pixel buffer can be reused as soon as the frame is converted
+        if (job.slot) {
+            job.slot->busy = false;
+        }
+
+        try {
+            write(job, frame, width, height);
+        } catch (const std::exception& ex) {
+            LOG_INFO("Can't write captured frame: %s", ex.what());
+        }
+
+        lock.lock();
+    }
+}
+
+void FrameCapture::convert(const Job& job, std::vector<uint8_t>& output,
+    uint32_t& width, uint32_t& height)
+{
+    const uint8_t* pixels = job.slot ? job.slot->data : &job.pixels[0];
+    width = job.width;
+    height = job.height;
+
+    // downsample with a 2x2 box filter
+    std::vector<uint8_t> scaled;
+    if (job.session->scale > 1) {
+        uint32_t srcPitch = width * 3;
+        width /= 2;
+        height /= 2;
+        scaled.resize(width * height * 3);
+
+        uint8_t* dst = &scaled[0];
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t* row0 = pixels + y * 2 * srcPitch;
+            const uint8_t* row1 = row0 + srcPitch;
+            for (uint32_t x = 0; x < width * 3; x += 3) {
+                for (uint32_t c = 0; c < 3; c++) {
+                    uint32_t i = x * 2 + c;
+                    *dst++ = (row0[i] + row0[i + 3] + row1[i] + row1[i + 3] +
+                                 2) >> 2;
+                }
+            }
+        }
+
+        pixels = &scaled[0];
+    }
+
+    size_t size = width * height;
+
+    if (job.session->format != Format::Y4M) {
+        output.assign(pixels, pixels + size * 3);
+        return;
+    }
+
+    // convert to BT.601 YCbCr planes without chroma subsampling and flip the
+    // rows, since Y4M frames are stored top-down
+    output.resize(size * 3);
+    uint8_t* dstY = &output[0];
+    uint8_t* dstU = dstY + size;
+    uint8_t* dstV = dstU + size;
+
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* src = pixels + (height - y - 1) * width * 3;
+        for (uint32_t x = 0; x < width; x++) {
+            int32_t r = *src++;
+            int32_t g = *src++;
+            int32_t b = *src++;
+            *dstY++ = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+            *dstU++ = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+            *dstV++ = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+        }
+    }
+}
+
+void FrameCapture::write(const Job& job, const std::vector<uint8_t>& frame,
+    uint32_t width, uint32_t height)
+{
+    Session& session = *job.session;
+
+    if (session.format != Format::Y4M) {
+        if (frame.empty()) {
+            return;
+        }
+
+        std::string suffix = StringUtils::format("_%06llu", job.index);
+        std::wstring path = session.path + StringUtils::utf8ToWide(suffix);
+        if (session.format == Format::PNG) {
+            ImageWriter::writePNG(path + L".png", frame, width, height);
+        } else {
+            ImageWriter::writeTGA(path + L".tga", frame, width, height);
+        }
+        return;
+    }
+
+    // wait until all previous frames have been written, frames that couldn't
+    // be converted are skipped but still take their turn
+    std::unique_lock<std::mutex> lock(session.mutex);
+    session.condition.wait(
+        lock, [&] { return session.nextWrite == job.index; });
+
+    try {
+        if (!frame.empty()) {
+            writeY4M(session, frame, width, height);
+        }
+    } catch (...) {
+        session.nextWrite++;
+        session.condition.notify_all();
+        throw;
+    }
+
+    session.nextWrite++;
+    session.condition.notify_all();
+}
+
+void FrameCapture::writeY4M(Session& session,
+    const std::vector<uint8_t>& frame, uint32_t width, uint32_t height)
+{
+    // start a new file if the display mode has changed
+    if (!session.file.is_open() || session.width != width ||
+        session.height != height) {
+        session.file.close();
+
+        std::wstring path = session.path;
+        if (session.segment > 0) {
+            std::string suffix = StringUtils::format("_%d", session.segment);
+            path += StringUtils::utf8ToWide(suffix);
+        }
+        path += L".y4m";
+        session.segment++;
+
+        session.file.open(
+            StringUtils::nativePath(path), std::ofstream::binary);
+        if (!session.file.good()) {
+            throw std::runtime_error("Can't open capture file '" +
+                                     StringUtils::wideToUtf8(path) + "': " +
+                                     ErrorUtils::getSystemErrorString());
+        }
+
+        session.file << StringUtils::format(
+            "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C444\n", width, height,
+            session.fps);
+        session.width = width;
+        session.height = height;
+    }
+
+    session.file << "FRAME\n";
+    session.file.write(
+        reinterpret_cast<const char*>(&frame[0]), frame.size());
+}
+
+} // namespace glrage
\ No newline at end of file
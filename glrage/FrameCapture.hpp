@@ -0,0 +1,116 @@
+#pragma once
+
+#include <glrage_gl/Buffer.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace glrage {
+
+// Records every presented frame to a Y4M video or an image sequence. Frames
+// are read back asynchronously and encoded by a pool of worker threads. If
+// the readback or the workers can't keep up, frames are dropped instead of
+// stalling the game.
+class FrameCapture
+{
+public:
+    ~FrameCapture();
+    void toggle();
+    void frame();
+
+private:
+    enum class Format
+    {
+        Y4M,
+        TGA,
+        PNG
+    };
+
+    struct Slot
+    {
+        std::unique_ptr<gl::Buffer> buffer;
+        size_t size = 0;
+
+        // persistent mapping, if supported
+        uint8_t* data = nullptr;
+
+        GLsync fence = nullptr;
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+        // set while the slot is read back or encoded
+        std::atomic<bool> busy{false};
+    };
+
+    struct Session
+    {
+        std::wstring path;
+        Format format;
+        uint32_t scale;
+        uint32_t fps;
+
+        // Y4M frames are written in order, even with multiple workers
+        std::mutex mutex;
+        std::condition_variable condition;
+        uint64_t nextWrite = 0;
+        std::ofstream file;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t segment = 0;
+    };
+
+    struct Job
+    {
+        std::shared_ptr<Session> session;
+        uint64_t index;
+        Slot* slot;
+        std::vector<uint8_t> pixels;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    void start();
+    void stop();
+    std::wstring nextPath();
+    void read();
+    void finishReadbacks(bool wait);
+    void submit(Job& job);
+    void workerProc();
+    static void convert(const Job& job, std::vector<uint8_t>& output,
+        uint32_t& width, uint32_t& height);
+    static void write(const Job& job, const std::vector<uint8_t>& frame,
+        uint32_t width, uint32_t height);
+    static void writeY4M(Session& session, const std::vector<uint8_t>& frame,
+        uint32_t width, uint32_t height);
+
+    // set by the window procedure, which may run on another thread than the
+    // renderer
+    std::atomic<bool> m_toggle{false};
+    std::shared_ptr<Session> m_session;
+    bool m_persistent = false;
+    uint64_t m_frames = 0;
+    uint32_t m_dropped = 0;
+
+    // pixel buffer ring, slots are read back in order
+    std::vector<std::unique_ptr<Slot>> m_slots;
+    size_t m_nextSlot = 0;
+    std::deque<Slot*> m_pending;
+
+    // worker pool and its bounded job queue
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<Job> m_jobs;
+    size_t m_maxJobs = 0;
+    bool m_running = true;
+};
+
+} // namespace glrage
\ No newline at end of file
@@ -1,13 +1,26 @@
 #pragma once
 
+#include "ProfilerImpl.hpp"
+
+#ifdef GLR_HEADLESS
+#include "HeadlessContext.hpp"
+#else
 #include "ContextImpl.hpp"
+#endif
 
+#ifdef _WIN32
 #include <glrage_patch/RuntimePatcher.hpp>
+#endif
+
 #include <glrage_util/Config.hpp>
+#include <glrage_util/Logger.hpp>
+#include <glrage_util/Overlay.hpp>
+#include <glrage_util/RenderThread.hpp>
+#include <glrage_util/Tracer.hpp>
 
 namespace glrage {
 
-#ifdef _LIB
+#if defined(_LIB) || !defined(_WIN32)
 #define GLRAPI
 #elif defined(GLR_EXPORTS)
 #define GLRAPI __declspec(dllexport)
@@ -18,12 +31,20 @@ namespace glrage {
 class GLRage {
 public:
     static GLRAPI Context& getContext();
+#ifdef _WIN32
     static GLRAPI RuntimePatcher& getPatcher();
+#endif
     static GLRAPI Config& getConfig();
+    static GLRAPI Profiler& getProfiler();
+    static GLRAPI Tracer& getTracer();
+    static GLRAPI Logger& getLogger();
+    static GLRAPI RenderThread& getRenderThread();
+    static GLRAPI Overlay& getOverlay();
 
+#ifdef _WIN32
 private:
-    static ContextImpl m_context;
     static RuntimePatcher m_patcher;
+#endif
 };
 
 } // namespace glrage
\ No newline at end of file
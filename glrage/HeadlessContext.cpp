@@ -0,0 +1,194 @@
+#include "HeadlessContext.hpp"
+
+#ifdef GLR_HEADLESS
+
+#include <glrage_util/Logger.hpp>
+#include <glrage_util/StringUtils.hpp>
+
+#include <EGL/eglext.h>
+
+#include <cstdlib>
+#include <stdexcept>
+
+namespace glrage {
+
+HeadlessContext& HeadlessContext::instance()
+{
+    static HeadlessContext instance;
+    return instance;
+}
+
+HeadlessContext::HeadlessContext()
+{
+    // load main config file
+    m_config.load(getBasePath() + L"/glrage.ini");
+}
+
+void HeadlessContext::init()
+{
+    if (m_context != EGL_NO_CONTEXT) {
+        return;
+    }
+
+    // prefer the surfaceless platform, which doesn't need a display server
+    auto eglGetPlatformDisplayEXT =
+        reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (eglGetPlatformDisplayEXT) {
+        m_display = eglGetPlatformDisplayEXT(
+            EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+
+    if (m_display == EGL_NO_DISPLAY) {
+        m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint major;
+    EGLint minor;
+    if (m_display == EGL_NO_DISPLAY ||
+        !eglInitialize(m_display, &major, &minor)) {
+        throw std::runtime_error("Can't initialize EGL display");
+    }
+
+    LOG_INFO("EGL version: %d.%d", major, minor);
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        throw std::runtime_error("Can't bind OpenGL API");
+    }
+
+    EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+
+    EGLConfig config;
+    EGLint numConfigs;
+    if (!eglChooseConfig(m_display, configAttribs, &config, 1, &numConfigs) ||
+        numConfigs < 1) {
+        throw std::runtime_error("Can't choose EGL config");
+    }
+
+    // attributes for a 3.3 core profile without all the legacy stuff
+    EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+        EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR,
+        EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+        EGL_NONE
+    };
+
+    m_context =
+        eglCreateContext(m_display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (m_context == EGL_NO_CONTEXT) {
+        throw std::runtime_error("Can't create OpenGL 3.3 core context");
+    }
+
+    // requires EGL_KHR_surfaceless_context
+    if (!eglMakeCurrent(
+            m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context)) {
+        throw std::runtime_error("Can't make OpenGL context current");
+    }
+
+    initGL();
+}
+
+void HeadlessContext::attach()
+{
+}
+
+void HeadlessContext::detach()
+{
+    if (m_context == EGL_NO_CONTEXT) {
+        return;
+    }
+
+    releaseGL();
+
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(m_display, m_context);
+    eglTerminate(m_display);
+
+    m_context = EGL_NO_CONTEXT;
+    m_display = EGL_NO_DISPLAY;
+}
+
+bool HeadlessContext::isFullscreen()
+{
+    return m_fullscreen;
+}
+
+void HeadlessContext::setFullscreen(bool fullscreen)
+{
+    m_fullscreen = fullscreen;
+}
+
+void HeadlessContext::toggleFullscreen()
+{
+    setFullscreen(!m_fullscreen);
+}
+
+void HeadlessContext::setWindowSize(int32_t width, int32_t height)
+{
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    // the render target is resized with the next viewport setup
+    m_windowWidth = width;
+    m_windowHeight = height;
+}
+
+int32_t HeadlessContext::getWindowWidth()
+{
+    return m_windowWidth;
+}
+
+int32_t HeadlessContext::getWindowHeight()
+{
+    return m_windowHeight;
+}
+
+int32_t HeadlessContext::getScreenWidth()
+{
+    return m_windowWidth;
+}
+
+int32_t HeadlessContext::getScreenHeight()
+{
+    return m_windowHeight;
+}
+
+void HeadlessContext::swapBuffers()
+{
+    TRACE_SCOPE(__FUNCTION__);
+
+    // there's nothing to present the frame to, but it's still paced and
+    // profiled like a regular one and remains readable as the front frame
+    beginSwap();
+    glFlush();
+    endSwap();
+}
+
+std::wstring HeadlessContext::getBasePath()
+{
+    // there's no module path to derive the base path from, so use the
+    // directory from the environment or the working directory
+    const char* path = std::getenv("GLR_BASE_PATH");
+    return StringUtils::utf8ToWide(path ? path : ".");
+}
+
+#ifdef _WIN32
+void HeadlessContext::attach(HWND hwnd)
+{
+}
+
+HWND HeadlessContext::getHWnd()
+{
+    return nullptr;
+}
+#endif
+
+} // namespace glrage
+
+#endif
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#ifdef GLR_HEADLESS
+
+#include "ContextBase.hpp"
+
+#include <EGL/egl.h>
+
+namespace glrage {
+
+// Context without a window that renders into framebuffer objects, using an
+// EGL context without any surfaces. It is selected at build time by defining
+// GLR_HEADLESS and allows running the renderers on machines without a display,
+// for instance with Mesa's llvmpipe driver.
+class HeadlessContext : public ContextBase
+{
+public:
+    static HeadlessContext& instance();
+
+    void init();
+    void attach();
+    void detach();
+    bool isFullscreen();
+    void setFullscreen(bool fullscreen);
+    void toggleFullscreen();
+    void setWindowSize(int32_t width, int32_t height);
+    int32_t getWindowWidth();
+    int32_t getWindowHeight();
+    int32_t getScreenWidth();
+    int32_t getScreenHeight();
+    void swapBuffers();
+    std::wstring getBasePath();
+
+#ifdef _WIN32
+    void attach(HWND hwnd);
+    HWND getHWnd();
+#endif
+
+private:
+    HeadlessContext();
+    HeadlessContext(HeadlessContext const&) = delete;
+    void operator=(HeadlessContext const&) = delete;
+
+    // default window size until a display mode is set
+    static const int32_t DEFAULT_WIDTH = 640;
+    static const int32_t DEFAULT_HEIGHT = 480;
+
+    // EGL handles
+    EGLDisplay m_display = EGL_NO_DISPLAY;
+    EGLContext m_context = EGL_NO_CONTEXT;
+
+    // size of the missing window, the frames are only rendered into the
+    // offscreen render target
+    int32_t m_windowWidth = DEFAULT_WIDTH;
+    int32_t m_windowHeight = DEFAULT_HEIGHT;
+
+    // fullscreen flag, which has no effect without a window
+    bool m_fullscreen = false;
+};
+
+} // namespace glrage
+
+#endif
\ No newline at end of file
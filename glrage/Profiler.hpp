@@ -0,0 +1,43 @@
+#pragma once
+
+namespace glrage {
+
+enum class ProfilerSection
+{
+    CIF,
+    DirectDraw,
+    Count
+};
+
+class Profiler
+{
+public:
+    virtual void begin(ProfilerSection section) = 0;
+    virtual void end(ProfilerSection section) = 0;
+};
+
+// measures the time spent in a section until the end of the current scope
+class ProfilerScope
+{
+public:
+    ProfilerScope(Profiler& profiler, ProfilerSection section)
+        : m_profiler(profiler)
+        , m_section(section)
+    {
+        m_profiler.begin(m_section);
+    }
+
+    ~ProfilerScope()
+    {
+        m_profiler.end(m_section);
+    }
+
+private:
+    ProfilerScope(ProfilerScope const&) = delete;
+    void operator=(ProfilerScope const&) = delete;
+
+    Profiler& m_profiler;
+    ProfilerSection m_section;
+};
+
+} // namespace glrage
\ No newline at end of file
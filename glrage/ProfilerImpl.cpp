@@ -0,0 +1,340 @@
+#include "ProfilerImpl.hpp"
+
+#include <glrage_util/Config.hpp>
+#include <glrage_util/ErrorUtils.hpp>
+#include <glrage_util/Logger.hpp>
+#include <glrage_util/StringUtils.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+
+namespace glrage {
+
+namespace {
+
+float toMillis(TimeUtils::Clock::duration duration)
+{
+    return std::chrono::duration<float, std::milli>(duration).count();
+}
+
+} // namespace
+
+ProfilerImpl& ProfilerImpl::instance()
+{
+    static ProfilerImpl instance;
+    return instance;
+}
+
+void ProfilerImpl::init()
+{
+    if (!m_enabled) {
+        m_enabled = Config::instance().getBool("context.profiler", false);
+        if (!m_enabled) {
+            return;
+        }
+
+        LOG_INFO("Profiler enabled");
+
+        m_frames.resize(MAX_FRAMES);
+        m_sections.fill(Section{false, {}, {}});
+        m_frameStart = TimeUtils::Clock::now();
+    }
+
+    // the queries belong to the current context, which may be a new one
+    if (m_queriesCreated) {
+        return;
+    }
+
+    m_freeQueries.resize(MAX_QUERIES);
+    glGenQueries(MAX_QUERIES, &m_freeQueries[0]);
+    m_queriesCreated = true;
+}
+
+void ProfilerImpl::release()
+{
+    if (!m_queriesCreated) {
+        return;
+    }
+
+    // keep the recorded frames for the report, only drop the GL objects
+    std::vector<GLuint> queries(m_freeQueries);
+    for (auto& pending : m_pendingQueries) {
+        queries.push_back(pending.first);
+    }
+
+    if (m_activeQuery) {
+        glEndQuery(GL_TIME_ELAPSED);
+        queries.push_back(m_activeQuery);
+    }
+
+    glDeleteQueries(static_cast<GLsizei>(queries.size()), queries.data());
+
+    m_freeQueries.clear();
+    m_pendingQueries.clear();
+    m_activeQuery = 0;
+    m_queriesCreated = false;
+}
+
+void ProfilerImpl::begin(ProfilerSection section)
+{
+    if (!m_enabled) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_sectionMutex);
+    Section& s = m_sections[static_cast<size_t>(section)];
+    if (!s.active) {
+        s.active = true;
+        s.start = TimeUtils::Clock::now();
+    }
+}
+
+void ProfilerImpl::end(ProfilerSection section)
+{
+    if (!m_enabled) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_sectionMutex);
+    Section& s = m_sections[static_cast<size_t>(section)];
+    if (s.active) {
+        s.active = false;
+        s.time += TimeUtils::Clock::now() - s.start;
+    }
+}
+
+void ProfilerImpl::frame()
+{
+    if (!m_enabled) {
+        return;
+    }
+
+    auto now = TimeUtils::Clock::now();
+
+    // stop measuring GPU time for this frame
+    if (m_activeQuery) {
+        glEndQuery(GL_TIME_ELAPSED);
+        m_pendingQueries.emplace_back(m_activeQuery, m_frameIndex);
+        m_activeQuery = 0;
+    }
+
+    FrameStats& stats = m_frames[m_frameIndex % MAX_FRAMES];
+    stats.cpu = toMillis(now - m_frameStart);
+    stats.gpu = -1;
+
+    std::unique_lock<std::mutex> lock(m_sectionMutex);
+    for (size_t i = 0; i < SECTION_COUNT; i++) {
+        Section& s = m_sections[i];
+
+        // sections that span the frame boundary are split up
+        if (s.active) {
+            s.time += now - s.start;
+            s.start = now;
+        }
+
+        stats.sections[i] = toMillis(s.time);
+        s.time = TimeUtils::Clock::duration::zero();
+    }
+    lock.unlock();
+
+    m_frameIndex++;
+    m_frameStart = now;
+
+    // collect results without stalling, they usually lag a few frames behind
+    readQueries();
+
+    // start measuring GPU time for the next frame if there's a free query
+    if (!m_freeQueries.empty()) {
+        m_activeQuery = m_freeQueries.back();
+        m_freeQueries.pop_back();
+        glBeginQuery(GL_TIME_ELAPSED, m_activeQuery);
+    }
+}
+
+void ProfilerImpl::report(const std::wstring& basePath)
+{
+    if (!m_enabled || m_frameIndex == 0) {
+        return;
+    }
+
+    try {
+        writeSummary(basePath + L"/profile.txt");
+        writeFrames(basePath + L"/profile.csv");
+    } catch (const std::exception& ex) {
+        LOG_INFO("Can't write profiler report: %s", ex.what());
+    }
+}
+
+void ProfilerImpl::readQueries()
+{
+    while (!m_pendingQueries.empty()) {
+        GLuint query = m_pendingQueries.front().first;
+        uint64_t frameIndex = m_pendingQueries.front().second;
+
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;
+        }
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+
+        // the frame may have been overwritten by now
+        if (m_frameIndex - frameIndex <= MAX_FRAMES) {
+            m_frames[frameIndex % MAX_FRAMES].gpu = elapsed / 1000000.0f;
+        }
+
+        m_freeQueries.push_back(query);
+        m_pendingQueries.pop_front();
+    }
+}
+
+std::vector<ProfilerImpl::FrameStats> ProfilerImpl::recordedFrames()
+{
+    // unroll the ring buffer, oldest frames first
+    size_t count = static_cast<size_t>(
+        (std::min)(m_frameIndex, static_cast<uint64_t>(MAX_FRAMES)));
+
+    std::vector<FrameStats> frames;
+    frames.reserve(count);
+    for (uint64_t i = m_frameIndex - count; i < m_frameIndex; i++) {
+        frames.push_back(m_frames[i % MAX_FRAMES]);
+    }
+
+    return frames;
+}
+
+void ProfilerImpl::writeSummary(const std::wstring& path)
+{
+    std::ofstream file(StringUtils::nativePath(path));
+    if (!file.good()) {
+        throw std::runtime_error("Can't open profiler report file '" +
+                                 StringUtils::wideToUtf8(path) + "': " +
+                                 ErrorUtils::getSystemErrorString());
+    }
+
+    auto frames = recordedFrames();
+
+    file << StringUtils::format("frames: %llu total, %u recorded\n\n",
+        static_cast<unsigned long long>(m_frameIndex),
+        static_cast<unsigned>(frames.size()));
+
+    // percentiles for each measured value
+    file << StringUtils::format("%-12s %8s %8s %8s %8s %8s\n", "ms", "mean",
+        "p50", "p95", "p99", "max");
+
+    auto writeRow = [&](const char* name,
+                        std::function<float(const FrameStats&)> getValue) {
+        std::vector<float> values;
+        values.reserve(frames.size());
+        for (auto& frame : frames) {
+            float value = getValue(frame);
+            if (value >= 0) {
+                values.push_back(value);
+            }
+        }
+
+        if (values.empty()) {
+            file << StringUtils::format("%-12s %8s\n", name, "n/a");
+            return;
+        }
+
+        std::sort(values.begin(), values.end());
+
+        // nearest-rank percentile
+        auto percentile = [&values](float p) {
+            size_t rank = static_cast<size_t>(std::ceil(p * values.size()));
+            return values[(std::max)(rank, static_cast<size_t>(1)) - 1];
+        };
+
+        double sum = 0;
+        for (float value : values) {
+            sum += value;
+        }
+
+        file << StringUtils::format("%-12s %8.2f %8.2f %8.2f %8.2f %8.2f\n",
+            name, sum / values.size(), percentile(0.5f), percentile(0.95f),
+            percentile(0.99f), values.back());
+    };
+
+    writeRow("frame", [](const FrameStats& frame) { return frame.cpu; });
+    writeRow("gpu", [](const FrameStats& frame) { return frame.gpu; });
+    writeRow("cif", [](const FrameStats& frame) {
+        return frame.sections[static_cast<size_t>(ProfilerSection::CIF)];
+    });
+    writeRow("directdraw", [](const FrameStats& frame) {
+        return frame.sections[static_cast<size_t>(ProfilerSection::DirectDraw)];
+    });
+
+    // frame time histogram with 1 ms buckets, the last bucket collects all
+    // frames that took even longer
+    const size_t bucketCount = 100;
+    std::vector<size_t> buckets(bucketCount + 1, 0);
+    for (auto& frame : frames) {
+        size_t bucket = static_cast<size_t>(frame.cpu);
+        buckets[(std::min)(bucket, bucketCount)]++;
+    }
+
+    auto first = std::find_if(
+        buckets.begin(), buckets.end(), [](size_t n) { return n > 0; });
+    auto last = std::find_if(
+        buckets.rbegin(), buckets.rend(), [](size_t n) { return n > 0; });
+    size_t maxCount = *std::max_element(buckets.begin(), buckets.end());
+
+    file << "\nframe time histogram:\n";
+
+    for (auto itr = first; itr != last.base(); itr++) {
+        size_t bucket = std::distance(buckets.begin(), itr);
+        size_t width = *itr * 50 / maxCount;
+
+        std::string label;
+        if (bucket == bucketCount) {
+            label = StringUtils::format(
+                ">= %u ms", static_cast<unsigned>(bucket));
+        } else {
+            label = StringUtils::format("%3u-%3u ms",
+                static_cast<unsigned>(bucket),
+                static_cast<unsigned>(bucket + 1));
+        }
+
+        file << StringUtils::format("%-10s |%s %u\n", label.c_str(),
+            std::string(width, '#').c_str(), static_cast<unsigned>(*itr));
+    }
+}
+
+void ProfilerImpl::writeFrames(const std::wstring& path)
+{
+    std::ofstream file(StringUtils::nativePath(path));
+    if (!file.good()) {
+        throw std::runtime_error("Can't open profiler frame file '" +
+                                 StringUtils::wideToUtf8(path) + "': " +
+                                 ErrorUtils::getSystemErrorString());
+    }
+
+    auto frames = recordedFrames();
+    uint64_t frameIndex = m_frameIndex - frames.size();
+
+    file << "frame,frame_ms,gpu_ms,cif_ms,directdraw_ms\n";
+
+    for (auto& frame : frames) {
+        file << StringUtils::format("%llu,%.3f,",
+            static_cast<unsigned long long>(frameIndex++), frame.cpu);
+
+        // leave out GPU times that haven't been collected
+        if (frame.gpu >= 0) {
+            file << StringUtils::format("%.3f", frame.gpu);
+        }
+
+        for (float section : frame.sections) {
+            file << StringUtils::format(",%.3f", section);
+        }
+
+        file << "\n";
+    }
+}
+
+} // namespace glrage
\ No newline at end of file
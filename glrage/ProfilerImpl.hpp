@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Profiler.hpp"
+
+#include <glrage_gl/gl_core_3_3.h>
+#include <glrage_util/TimeUtils.hpp>
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace glrage {
+
+class ProfilerImpl : public Profiler
+{
+public:
+    static ProfilerImpl& instance();
+
+    void init();
+    void release();
+    void begin(ProfilerSection section);
+    void end(ProfilerSection section);
+    void frame();
+    void report(const std::wstring& basePath);
+
+private:
+    ProfilerImpl(){};
+    ProfilerImpl(ProfilerImpl const&) = delete;
+    void operator=(ProfilerImpl const&) = delete;
+
+    // number of frames that are kept for the report
+    static const size_t MAX_FRAMES = 1 << 16;
+
+    // number of GPU timer queries that may be pending at once
+    static const size_t MAX_QUERIES = 8;
+
+    static const size_t SECTION_COUNT =
+        static_cast<size_t>(ProfilerSection::Count);
+
+    struct FrameStats
+    {
+        // all times are in milliseconds, negative if not available
+        float cpu;
+        float gpu;
+        std::array<float, SECTION_COUNT> sections;
+    };
+
+    struct Section
+    {
+        bool active;
+        TimeUtils::Clock::time_point start;
+        TimeUtils::Clock::duration time;
+    };
+
+    void readQueries();
+    std::vector<FrameStats> recordedFrames();
+    void writeSummary(const std::wstring& path);
+    void writeFrames(const std::wstring& path);
+
+    bool m_enabled = false;
+
+    // ring buffer for the recorded frames
+    std::vector<FrameStats> m_frames;
+    uint64_t m_frameIndex = 0;
+    TimeUtils::Clock::time_point m_frameStart;
+
+    // CPU time spent in sections during the current frame, the sections are
+    // measured on the game's thread while frames may end on the render thread
+    std::array<Section, SECTION_COUNT> m_sections;
+    std::mutex m_sectionMutex;
+
+    // GPU timer queries with the index of the frame they were issued in
+    std::vector<GLuint> m_freeQueries;
+    std::deque<std::pair<GLuint, uint64_t>> m_pendingQueries;
+    GLuint m_activeQuery = 0;
+    bool m_queriesCreated = false;
+};
+
+} // namespace glrage
\ No newline at end of file
@@ -0,0 +1,275 @@
+#include "RenderTarget.hpp"
+
+#include <glrage_util/Logger.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace glrage {
+
+const float RenderTarget::SCALE_STEP = 0.05f;
+
+namespace {
+
+// upper limit for frames with pending timestamp queries, frames are not
+// measured while the GPU is further behind
+const size_t MAX_PENDING_QUERIES = 8;
+
+} // namespace
+
+void RenderTarget::init(Config& config)
+{
+    m_scaleMax =
+        (std::max)(config.getFloat("context.render_scale", 1.0f), SCALE_STEP);
+    m_scale = m_scaleMax;
+
+    m_dynamic = config.getBool("context.dynamic_resolution", false);
+    if (m_dynamic) {
+        m_scaleMin = config.getFloat("context.dynamic_resolution_min", 0.5f);
+        m_scaleMin = (std::min)((std::max)(m_scaleMin, SCALE_STEP), m_scaleMax);
+
+        // leave some headroom to the frame time of the frame rate limit or a
+        // 60 Hz display if there's no explicit target
+        m_targetTime =
+            config.getFloat("context.dynamic_resolution_target", 0.0f);
+        if (m_targetTime <= 0) {
+            int32_t fps = config.getInt("context.fps_limit", 0);
+            m_targetTime = 0.9f * 1000.0f / (fps > 0 ? fps : 60);
+        }
+
+        LOG_INFO("Dynamic resolution: %.2f-%.2f, target %.1f ms", m_scaleMin,
+            m_scaleMax, m_targetTime);
+    } else {
+        m_scaleMin = m_scale;
+    }
+
+    for (auto& frame : m_frames) {
+        frame.framebuffer = std::make_unique<gl::Framebuffer>();
+        frame.colorBuffer = std::make_unique<gl::Renderbuffer>();
+        frame.width = 0;
+        frame.height = 0;
+    }
+
+    m_depthBuffer = std::make_unique<gl::Renderbuffer>();
+    m_depthWidth = 0;
+    m_depthHeight = 0;
+}
+
+void RenderTarget::release()
+{
+    if (m_startQuery) {
+        m_freeQueries.push_back(m_startQuery);
+        m_startQuery = 0;
+    }
+
+    for (auto& queries : m_pendingQueries) {
+        m_freeQueries.push_back(queries.first);
+        m_freeQueries.push_back(queries.second);
+    }
+    m_pendingQueries.clear();
+
+    if (!m_freeQueries.empty()) {
+        glDeleteQueries(
+            static_cast<GLsizei>(m_freeQueries.size()), &m_freeQueries[0]);
+        m_freeQueries.clear();
+    }
+
+    for (auto& frame : m_frames) {
+        frame.framebuffer.reset();
+        frame.colorBuffer.reset();
+    }
+
+    m_depthBuffer.reset();
+}
+
+void RenderTarget::setViewport(
+    int32_t x, int32_t y, int32_t width, int32_t height)
+{
+    m_x = x;
+    m_y = y;
+    m_width = width;
+    m_height = height;
+
+    bindCurrent();
+}
+
+void RenderTarget::present()
+{
+    Frame& frame = m_frames[m_current];
+
+    frame.framebuffer->bind(GL_READ_FRAMEBUFFER);
+    frame.framebuffer->unbind(GL_DRAW_FRAMEBUFFER);
+
+    // clear the borders around the viewport
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    bool scaled = frame.width != m_width || frame.height != m_height;
+    glBlitFramebuffer(0, 0, frame.width, frame.height, m_x, m_y,
+        m_x + m_width, m_y + m_height, GL_COLOR_BUFFER_BIT,
+        scaled ? GL_LINEAR : GL_NEAREST);
+
+    frame.framebuffer->unbind(GL_READ_FRAMEBUFFER);
+
+    // the frame capture reads the presented frame from the back buffer
+    glViewport(m_x, m_y, m_width, m_height);
+}
+
+void RenderTarget::endFrame()
+{
+    if (!m_startQuery) {
+        return;
+    }
+
+    GLuint endQuery;
+    if (m_freeQueries.empty()) {
+        glGenQueries(1, &endQuery);
+    } else {
+        endQuery = m_freeQueries.back();
+        m_freeQueries.pop_back();
+    }
+
+    glQueryCounter(endQuery, GL_TIMESTAMP);
+    m_pendingQueries.emplace_back(m_startQuery, endQuery);
+    m_startQuery = 0;
+}
+
+void RenderTarget::swap(bool gpuBound)
+{
+    // frames that weren't ended explicitly are measured up to here
+    endFrame();
+
+    m_gpuBound = m_gpuBound || gpuBound;
+    readQueries();
+
+    m_current ^= 1;
+    bindCurrent();
+
+    if (m_dynamic && m_pendingQueries.size() < MAX_PENDING_QUERIES) {
+        if (m_freeQueries.empty()) {
+            glGenQueries(1, &m_startQuery);
+        } else {
+            m_startQuery = m_freeQueries.back();
+            m_freeQueries.pop_back();
+        }
+
+        glQueryCounter(m_startQuery, GL_TIMESTAMP);
+    }
+}
+
+void RenderTarget::bindFrame(bool front, int32_t& width, int32_t& height)
+{
+    Frame& frame = m_frames[front ? m_current ^ 1 : m_current];
+    frame.framebuffer->bind(GL_READ_FRAMEBUFFER);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+    width = frame.width;
+    height = frame.height;
+}
+
+void RenderTarget::bindCurrent()
+{
+    Frame& frame = m_frames[m_current];
+
+    auto width = static_cast<int32_t>(std::lround(m_width * m_scale));
+    auto height = static_cast<int32_t>(std::lround(m_height * m_scale));
+    width = (std::max)(width, 1);
+    height = (std::max)(height, 1);
+
+    frame.framebuffer->bind();
+
+    if (width != m_depthWidth || height != m_depthHeight) {
+        m_depthBuffer->bind();
+        m_depthBuffer->storage(GL_DEPTH_COMPONENT24, width, height);
+        m_depthWidth = width;
+        m_depthHeight = height;
+    }
+
+    if (width != frame.width || height != frame.height) {
+        LOG_INFO("Framebuffer size: %dx%d", width, height);
+
+        frame.colorBuffer->bind();
+        frame.colorBuffer->storage(GL_RGBA8, width, height);
+        frame.framebuffer->renderbuffer(
+            GL_COLOR_ATTACHMENT0, *frame.colorBuffer);
+        frame.framebuffer->renderbuffer(GL_DEPTH_ATTACHMENT, *m_depthBuffer);
+        frame.width = width;
+        frame.height = height;
+
+        if (frame.framebuffer->status() != GL_FRAMEBUFFER_COMPLETE) {
+            throw std::runtime_error("Incomplete offscreen framebuffer");
+        }
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    glViewport(0, 0, width, height);
+}
+
+void RenderTarget::readQueries()
+{
+    while (!m_pendingQueries.empty()) {
+        auto queries = m_pendingQueries.front();
+
+        GLint available = 0;
+        glGetQueryObjectiv(
+            queries.second, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;
+        }
+
+        GLuint64 start;
+        GLuint64 end;
+        glGetQueryObjectui64v(queries.first, GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(queries.second, GL_QUERY_RESULT, &end);
+
+        m_freeQueries.push_back(queries.first);
+        m_freeQueries.push_back(queries.second);
+        m_pendingQueries.pop_front();
+
+        updateScale((end - start) / 1e6f);
+    }
+}
+
+void RenderTarget::updateScale(float time)
+{
+    m_timeSum += time;
+    m_timeCount++;
+
+    if (m_timeCount < SCALE_INTERVAL) {
+        return;
+    }
+
+    float average = (std::max)(m_timeSum / m_timeCount, 0.001f);
+    m_timeSum = 0;
+    m_timeCount = 0;
+
+    bool gpuBound = m_gpuBound;
+    m_gpuBound = false;
+
+    // leave the scale alone within a tolerance below the target, so it
+    // doesn't oscillate around it
+    if (average <= m_targetTime && average >= m_targetTime * 0.8f) {
+        return;
+    }
+
+    // only reduce the resolution if the GPU actually held back the frames,
+    // a long frame time may just as well be caused by the game's CPU time
+    if (average > m_targetTime && !gpuBound) {
+        return;
+    }
+
+    // the GPU time is roughly proportional to the number of pixels, which
+    // grows with the square of the scale
+    float scale = m_scale * std::sqrt(m_targetTime / average);
+    scale = std::round(scale / SCALE_STEP) * SCALE_STEP;
+    scale = (std::min)((std::max)(scale, m_scaleMin), m_scaleMax);
+
+    if (scale != m_scale) {
+        LOG_DEBUG("Render scale: %.2f -> %.2f (%.2f ms)", m_scale, scale,
+            average);
+        m_scale = scale;
+    }
+}
+
+} // namespace glrage
\ No newline at end of file
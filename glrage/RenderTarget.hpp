@@ -0,0 +1,103 @@
+#pragma once
+
+#include <glrage_gl/Framebuffer.hpp>
+#include <glrage_gl/Renderbuffer.hpp>
+#include <glrage_util/Config.hpp>
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace glrage {
+
+// Offscreen framebuffers the frames are rendered into instead of the window.
+// Their size is the viewport multiplied with a scale factor, which is either
+// fixed or adjusted dynamically to keep the GPU time per frame close to a
+// target, and the frame is stretched to the viewport when it's presented. Two
+// framebuffers are used in turn, so the last presented frame can still be
+// read while the next one is rendered.
+class RenderTarget
+{
+public:
+    // called once the OpenGL context has been created and made current
+    void init(Config& config);
+    void release();
+
+    // sets the viewport in the window, binds the current framebuffer and sets
+    // the viewport for it
+    void setViewport(int32_t x, int32_t y, int32_t width, int32_t height);
+
+    // stretches the current frame to the viewport of the window's back buffer
+    void present();
+
+    // marks the end of the draws of the current frame, so its GPU time
+    // excludes presenting it and waiting for the frame rate limit
+    void endFrame();
+
+    // starts a new frame in the other framebuffer, gpuBound tells whether the
+    // CPU had to wait for the GPU to finish previous frames
+    void swap(bool gpuBound);
+
+    // binds the current or the last presented frame to GL_READ_FRAMEBUFFER
+    // and returns its size, the frame starts at the origin
+    void bindFrame(bool front, int32_t& width, int32_t& height);
+
+private:
+    // number of frames the GPU time is averaged over before the scale is
+    // adjusted, which also limits how often the framebuffers are resized
+    static const uint32_t SCALE_INTERVAL = 30;
+
+    // the scale is rounded to steps of this size
+    static const float SCALE_STEP;
+
+    struct Frame
+    {
+        std::unique_ptr<gl::Framebuffer> framebuffer;
+        std::unique_ptr<gl::Renderbuffer> colorBuffer;
+        int32_t width = 0;
+        int32_t height = 0;
+    };
+
+    void bindCurrent();
+    void readQueries();
+    void updateScale(float time);
+
+    std::array<Frame, 2> m_frames;
+    size_t m_current = 0;
+
+    // the depth buffer is only required for the current frame
+    std::unique_ptr<gl::Renderbuffer> m_depthBuffer;
+    int32_t m_depthWidth = 0;
+    int32_t m_depthHeight = 0;
+
+    // viewport in the window
+    int32_t m_x = 0;
+    int32_t m_y = 0;
+    int32_t m_width = 0;
+    int32_t m_height = 0;
+
+    // scale of the framebuffers relative to the viewport
+    float m_scale = 1;
+    float m_scaleMin = 1;
+    float m_scaleMax = 1;
+
+    // dynamic scaling with the GPU frame time target in milliseconds
+    bool m_dynamic = false;
+    float m_targetTime = 0;
+    float m_timeSum = 0;
+    uint32_t m_timeCount = 0;
+
+    // set if the GPU limited the frame rate since the last scale update
+    bool m_gpuBound = false;
+
+    // timestamp queries around the draws of each frame, which don't
+    // interfere with the time elapsed queries of the profiler
+    std::vector<GLuint> m_freeQueries;
+    std::deque<std::pair<GLuint, GLuint>> m_pendingQueries;
+    GLuint m_startQuery = 0;
+};
+
+} // namespace glrage
\ No newline at end of file
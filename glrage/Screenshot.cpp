@@ -1,18 +1,46 @@
 #include "Screenshot.hpp"
-#include "ContextImpl.hpp"
+#include "GLRage.hpp"
 
-#include <glrage_util/StringUtils.hpp>
 #include <glrage_gl/Screenshot.hpp>
+#include <glrage_util/Config.hpp>
+#include <glrage_util/FileUtils.hpp>
+#include <glrage_util/ImageWriter.hpp>
+#include <glrage_util/Logger.hpp>
+#include <glrage_util/StringUtils.hpp>
 
 #include <cstdint>
 #include <exception>
-#include <fstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
 namespace glrage {
 
+Screenshot::~Screenshot()
+{
+    // Without release(), the worker is either terminated already because the
+    // process is exiting, or it can't be joined under the loader lock. It's
+    // left waiting on its own reference to the queue and the remaining images
+    // are written on this thread instead.
+    if (m_worker.joinable()) {
+        m_worker.detach();
+    }
+
+    std::unique_lock<std::mutex> lock(m_queue->mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+
+    for (auto& job : m_queue->jobs) {
+        try {
+            write(job);
+        } catch (const std::exception& ex) {
+            LOG_INFO("Can't write screenshot: %s", ex.what());
+        }
+    }
+    m_queue->jobs.clear();
+}
+
 void Screenshot::schedule(bool schedule)
 {
     m_schedule = schedule;
@@ -20,32 +48,169 @@ void Screenshot::schedule(bool schedule)
 
 void Screenshot::captureScheduled()
 {
-    if (m_schedule) {
+    // hand finished readbacks to the worker without waiting for the GPU
+    if (m_fence) {
+        finishReadback(false);
+    }
+
+    if (m_schedule.exchange(false)) {
         capture();
-        m_schedule = false;
     }
 }
 
 void Screenshot::capture()
 {
-    // find unused screenshot file name
-    std::wstring basePath = ContextImpl::instance().getBasePath();
-    std::wstring path;
-    DWORD dwAttrib;
-    do {
-        std::string fileName =
-            StringUtils::format("screenshot%04d.tga", m_index++);
-        path = basePath + L"\\" + StringUtils::utf8ToWide(fileName);
-        dwAttrib = GetFileAttributes(path.c_str());
-    } while (dwAttrib != INVALID_FILE_ATTRIBUTES && m_index < 9999);
+    // only one readback can be pending at a time
+    if (m_fence) {
+        finishReadback(true);
+    }
+
+    bool png = Config::instance().getString(
+                   "context.screenshot_format", "tga") == "png";
+
+    m_pending.format = png ? Format::PNG : Format::TGA;
+    m_pending.path = nextPath(png ? L".png" : L".tga");
+
+    if (!m_buffer) {
+        m_buffer = std::make_unique<gl::Buffer>(GL_PIXEL_PACK_BUFFER);
+    }
+
+    // read the frame that is about to be presented at its internal
+    // resolution, which doesn't depend on the window being visible
+    int32_t width;
+    int32_t height;
+    GLRage::getContext().bindFrame(false, width, height);
+    gl::Screenshot::capture(*m_buffer, width, height, 3,
+        png ? GL_RGB : GL_BGR, GL_UNSIGNED_BYTE);
+
+    m_pending.width = width;
+    m_pending.height = height;
+    m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void Screenshot::release()
+{
+    if (m_fence) {
+        try {
+            finishReadback(true);
+        } catch (const std::exception& ex) {
+            LOG_INFO("Can't capture screenshot: %s", ex.what());
+        }
+    }
+
+    m_buffer.reset();
+
+    // the worker writes the remaining images before it exits
+    {
+        std::lock_guard<std::mutex> lock(m_queue->mutex);
+        m_queue->running = false;
+    }
+    m_queue->condition.notify_all();
+
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+std::wstring Screenshot::nextPath(const std::wstring& extension)
+{
+    std::wstring basePath = GLRage::getContext().getBasePath();
+
+    // find the highest used index once instead of probing each file name
+    if (!m_indexFound) {
+        m_index = FileUtils::nextIndex(basePath, L"screenshot");
+        m_indexFound = true;
+    }
 
     // rather unlikely, but better safe than sorry
-    if (dwAttrib != INVALID_FILE_ATTRIBUTES) {
+    if (m_index > 9999) {
         throw std::runtime_error("All available screenshot slots are used up!");
     }
 
-    // actual capture
-    gl::Screenshot::capture(path);
+    std::string fileName = StringUtils::format("screenshot%04d", m_index++);
+    return basePath + L"/" + StringUtils::utf8ToWide(fileName) + extension;
+}
+
+bool Screenshot::finishReadback(bool wait)
+{
+    GLenum status = glClientWaitSync(m_fence,
+        wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000 * 1000 * 1000 : 0);
+    if (status == GL_TIMEOUT_EXPIRED && !wait) {
+        return false;
+    }
+
+    glDeleteSync(m_fence);
+    m_fence = nullptr;
+
+    size_t size = m_pending.width * m_pending.height * 3;
+
+    m_buffer->bind();
+    auto data =
+        static_cast<uint8_t*>(m_buffer->mapRange(0, size, GL_MAP_READ_BIT));
+    if (data) {
+        m_pending.pixels.assign(data, data + size);
+        m_buffer->unmap();
+    }
+    m_buffer->unbind();
+
+    if (!data) {
+        throw std::runtime_error("Can't map screenshot pixel buffer");
+    }
+
+    // flipping and encoding is done by the worker
+    {
+        std::lock_guard<std::mutex> lock(m_queue->mutex);
+        m_queue->jobs.push_back(std::move(m_pending));
+        m_queue->running = true;
+    }
+    m_pending = Job();
+
+    if (!m_worker.joinable()) {
+        m_worker = std::thread(&Screenshot::workerProc, m_queue);
+    }
+    m_queue->condition.notify_one();
+
+    return true;
+}
+
+void Screenshot::workerProc(std::shared_ptr<Queue> queue)
+{
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    for (;;) {
+        queue->condition.wait(
+            lock, [&queue] { return !queue->running || !queue->jobs.empty(); });
+        if (queue->jobs.empty()) {
+            break;
+        }
+
+        Job job = std::move(queue->jobs.front());
+        queue->jobs.pop_front();
+
+        lock.unlock();
+
+        try {
+            write(job);
+        } catch (const std::exception& ex) {
+            LOG_INFO("Can't write screenshot: %s", ex.what());
+        }
+
+        lock.lock();
+    }
+}
+
+void Screenshot::write(const Job& job)
+{
+    switch (job.format) {
+        case Format::TGA:
+            ImageWriter::writeTGA(
+                job.path, job.pixels, job.width, job.height);
+            break;
+
+        case Format::PNG:
+            ImageWriter::writePNG(
+                job.path, job.pixels, job.width, job.height);
+            break;
+    }
 }
 
 } // namespace glrage
\ No newline at end of file
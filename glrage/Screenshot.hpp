@@ -1,19 +1,75 @@
 #pragma once
 
+#include <glrage_gl/Buffer.hpp>
+
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace glrage {
 
 class Screenshot
 {
 public:
+    ~Screenshot();
     void schedule(bool schedule);
     void captureScheduled();
     void capture();
 
+    // finishes the pending readback and waits until all images have been
+    // written, must be called while the OpenGL context is still current
+    void release();
+
 private:
+    enum class Format
+    {
+        TGA,
+        PNG
+    };
+
+    struct Job
+    {
+        std::wstring path;
+        Format format;
+        uint32_t width;
+        uint32_t height;
+        std::vector<uint8_t> pixels;
+    };
+
+    // job queue, which is shared with the encoder thread, so it stays valid if
+    // the thread can't be joined
+    struct Queue
+    {
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<Job> jobs;
+        bool running = true;
+    };
+
+    std::wstring nextPath(const std::wstring& extension);
+    bool finishReadback(bool wait);
+    static void workerProc(std::shared_ptr<Queue> queue);
+    static void write(const Job& job);
+
     uint32_t m_index = 0;
-    bool m_schedule = false;
+    bool m_indexFound = false;
+    std::atomic<bool> m_schedule{false};
+
+    // pending pixel buffer readback, created on first use, since there's no
+    // OpenGL context when this object is constructed
+    std::unique_ptr<gl::Buffer> m_buffer;
+    GLsync m_fence = nullptr;
+    Job m_pending;
+
+    // encoder thread
+    std::thread m_worker;
+    std::shared_ptr<Queue> m_queue{std::make_shared<Queue>()};
 };
 
 } // namespace glrage
\ No newline at end of file
@@ -4,17 +4,48 @@ namespace glrage {
 
 GLRAPI Context& GLRage::getContext()
 {
+#ifdef GLR_HEADLESS
+    return HeadlessContext::instance();
+#else
     return ContextImpl::instance();
+#endif
 }
 
+#ifdef _WIN32
 GLRAPI RuntimePatcher& GLRage::getPatcher()
 {
     return RuntimePatcher::instance();
 }
+#endif
 
 GLRAPI Config& GLRage::getConfig()
 {
     return Config::instance();
 }
 
+GLRAPI Profiler& GLRage::getProfiler()
+{
+    return ProfilerImpl::instance();
+}
+
+GLRAPI Tracer& GLRage::getTracer()
+{
+    return Tracer::instance();
+}
+
+GLRAPI Logger& GLRage::getLogger()
+{
+    return Logger::instance();
+}
+
+GLRAPI RenderThread& GLRage::getRenderThread()
+{
+    return RenderThread::instance();
+}
+
+GLRAPI Overlay& GLRage::getOverlay()
+{
+    return Overlay::instance();
+}
+
 } // namespace glrage
\ No newline at end of file
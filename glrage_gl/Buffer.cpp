@@ -19,6 +19,11 @@ void Buffer::bind()
     glBindBuffer(m_target, m_id);
 }
 
+void Buffer::unbind()
+{
+    glBindBuffer(m_target, 0);
+}
+
 void Buffer::data(GLsizei size, const void* data, GLenum usage)
 {
     glBufferData(m_target, size, data, usage);
@@ -29,11 +34,21 @@ void Buffer::subData(GLsizei offset, GLsizei size, const void* data)
     glBufferSubData(m_target, offset, size, data);
 }
 
+void Buffer::storage(GLsizei size, const void* data, GLbitfield flags)
+{
+    glBufferStorage(m_target, size, data, flags);
+}
+
 void* Buffer::map(GLenum access)
 {
     return glMapBuffer(m_target, access);
 }
 
+void* Buffer::mapRange(GLsizei offset, GLsizei length, GLbitfield access)
+{
+    return glMapBufferRange(m_target, offset, length, access);
+}
+
 void Buffer::unmap()
 {
     glUnmapBuffer(m_target);
@@ -12,9 +12,12 @@ public:
     Buffer(GLenum target);
     ~Buffer();
     void bind();
+    void unbind();
     void data(GLsizei size, const void* data, GLenum usage);
     void subData(GLsizei offset, GLsizei size, const void* data);
+    void storage(GLsizei size, const void* data, GLbitfield flags);
     void* map(GLenum access);
+    void* mapRange(GLsizei offset, GLsizei length, GLbitfield access);
     void unmap();
     GLint parameter(GLenum pname);
 
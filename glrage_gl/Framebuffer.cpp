@@ -0,0 +1,49 @@
+#include "Framebuffer.hpp"
+
+namespace glrage {
+namespace gl {
+
+Framebuffer::Framebuffer()
+{
+    glGenFramebuffers(1, &m_id);
+}
+
+Framebuffer::~Framebuffer()
+{
+    glDeleteFramebuffers(1, &m_id);
+}
+
+void Framebuffer::bind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_id);
+}
+
+void Framebuffer::bind(GLenum target)
+{
+    glBindFramebuffer(target, m_id);
+}
+
+void Framebuffer::unbind(GLenum target)
+{
+    glBindFramebuffer(target, 0);
+}
+
+void Framebuffer::renderbuffer(GLenum attachment, Renderbuffer& renderbuffer)
+{
+    glFramebufferRenderbuffer(
+        GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, renderbuffer.id());
+}
+
+void Framebuffer::texture(GLenum attachment, Texture& texture)
+{
+    glFramebufferTexture2D(
+        GL_FRAMEBUFFER, attachment, texture.target(), texture.id(), 0);
+}
+
+GLenum Framebuffer::status()
+{
+    return glCheckFramebufferStatus(GL_FRAMEBUFFER);
+}
+
+} // namespace gl
+} // namespace glrage
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Object.hpp"
+#include "Renderbuffer.hpp"
+#include "Texture.hpp"
+#include "gl_core_3_3.h"
+
+namespace glrage {
+namespace gl {
+
+class Framebuffer : public Object
+{
+public:
+    Framebuffer();
+    ~Framebuffer();
+    void bind();
+    void bind(GLenum target);
+    void unbind(GLenum target);
+
+    // attachments and status refer to the framebuffer bound to
+    // GL_FRAMEBUFFER
+    void renderbuffer(GLenum attachment, Renderbuffer& renderbuffer);
+    void texture(GLenum attachment, Texture& texture);
+    GLenum status();
+};
+
+} // namespace gl
+} // namespace glrage
\ No newline at end of file
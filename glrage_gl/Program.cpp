@@ -92,6 +92,14 @@ GLint Program::uniformLocation(const std::string& name)
     return location;
 }
 
+void Program::uniform1f(const std::string& name, GLfloat v0)
+{
+    GLint loc = uniformLocation(name);
+    if (loc != -1) {
+        glUniform1f(loc, v0);
+    }
+}
+
 void Program::uniform3f(
     const std::string& name, GLfloat v0, GLfloat v1, GLfloat v2)
 {
@@ -22,6 +22,7 @@ public:
     GLint attributeLocation(const std::string& name);
     GLint uniformLocation(const std::string& name);
 
+    void uniform1f(const std::string& name, GLfloat v0);
     void uniform3f(const std::string& name, GLfloat v0, GLfloat v1, GLfloat v2);
     void uniform4f(const std::string& name, GLfloat v0, GLfloat v1, GLfloat v2,
         GLfloat v3);
@@ -0,0 +1,27 @@
+#include "Renderbuffer.hpp"
+
+namespace glrage {
+namespace gl {
+
+Renderbuffer::Renderbuffer()
+{
+    glGenRenderbuffers(1, &m_id);
+}
+
+Renderbuffer::~Renderbuffer()
+{
+    glDeleteRenderbuffers(1, &m_id);
+}
+
+void Renderbuffer::bind()
+{
+    glBindRenderbuffer(GL_RENDERBUFFER, m_id);
+}
+
+void Renderbuffer::storage(GLenum internalFormat, GLsizei width, GLsizei height)
+{
+    glRenderbufferStorage(GL_RENDERBUFFER, internalFormat, width, height);
+}
+
+} // namespace gl
+} // namespace glrage
\ No newline at end of file
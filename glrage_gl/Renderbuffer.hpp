@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Object.hpp"
+#include "gl_core_3_3.h"
+
+namespace glrage {
+namespace gl {
+
+class Renderbuffer : public Object
+{
+public:
+    Renderbuffer();
+    ~Renderbuffer();
+    void bind();
+    void storage(GLenum internalFormat, GLsizei width, GLsizei height);
+};
+
+} // namespace gl
+} // namespace glrage
\ No newline at end of file
@@ -1,21 +1,25 @@
 #pragma once
 
 #include <cstdint>
-#include <string>
 #include <vector>
 
+#include "Buffer.hpp"
+
 #include <glrage_gl/gl_core_3_3.h>
 
 namespace glrage {
 namespace gl {
 
+// reads an area of the given size from the origin of the framebuffer bound
+// to GL_READ_FRAMEBUFFER and its selected read buffer
 class Screenshot
 {
 public:
-    static void capture(const std::wstring& path);
-    static void capture(std::vector<uint8_t>& buffer, GLint& width,
-        GLint& height, GLint depth, GLenum format, GLenum type,
+    static void capture(std::vector<uint8_t>& buffer, GLint width,
+        GLint height, GLint depth, GLenum format, GLenum type,
         bool vflip = false);
+    static void capture(Buffer& buffer, GLint width, GLint height,
+        GLint depth, GLenum format, GLenum type);
 };
 
 } // namespace gl
@@ -34,7 +34,7 @@ Shader& Shader::fromFile(const std::wstring& path)
 {
     // open and check shader file
     std::ifstream file;
-    file.open(path.c_str());
+    file.open(StringUtils::nativePath(path).c_str());
     if (!file.good()) {
         throw std::runtime_error("Can't open shader file '" +
                                  StringUtils::wideToUtf8(path) + "': " +
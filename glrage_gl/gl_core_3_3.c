@@ -39,7 +39,11 @@ static void* SunGetProcAddress (const GLubyte* name)
 }
 #endif /* __sgi || __sun */
 
-#if defined(_WIN32)
+#if defined(GLR_HEADLESS)
+	#include <EGL/egl.h>
+
+	#define IntGetProcAddress(name) eglGetProcAddress((const char*)name)
+#elif defined(_WIN32)
 
 #ifdef _MSC_VER
 #pragma warning(disable: 4055)
@@ -1,6 +1,7 @@
 #include "TombRaiderHooks.hpp"
 
 #include <glrage_util/Logger.hpp>
+#include <glrage_util/Overlay.hpp>
 
 #include <cmath>
 
@@ -572,11 +573,6 @@ void TombRaiderHooks::soundBufferSetPan(LPDIRECTSOUNDBUFFER buffer, int32_t pan)
 
 void TombRaiderHooks::renderBar(int32_t value, bool air)
 {
-    const int32_t p1 = -100;
-    const int32_t p2 = -200;
-    const int32_t p3 = -300;
-    const int32_t p4 = -400;
-
     const int32_t valueMax = 100;
 
     const int32_t colorBarSize = 5;
@@ -611,19 +607,20 @@ void TombRaiderHooks::renderBar(int32_t value, bool air)
         m_fpsTextY = bottom + 24;
     }
 
+    // the bar is drawn with a few overlay rectangles instead of one line per
+    // row, which would be very slow at high resolutions
+    Overlay& overlay = Overlay::instance();
+
     // background
-    for (int32_t i = 1; i < height + 3; i++) {
-        m_tombRenderLine(
-            left + 1, top + i, right, top + i, p1, colorBackground);
-    }
+    overlay.addRect(left + 1, top + 1, right, bottom, colorBackground);
 
     // top / left border
-    m_tombRenderLine(left, top, right + 1, top, p2, colorBorder1);
-    m_tombRenderLine(left, top, left, bottom, p2, colorBorder1);
+    overlay.addRect(left, top, right + 1, top + 1, colorBorder1);
+    overlay.addRect(left, top, left + 1, bottom + 1, colorBorder1);
 
     // bottom / right border
-    m_tombRenderLine(left + 1, bottom, right, bottom, p2, colorBorder2);
-    m_tombRenderLine(right, top, right, bottom, p2, colorBorder2);
+    overlay.addRect(left + 1, bottom, right + 1, bottom + 1, colorBorder2);
+    overlay.addRect(right, top, right + 1, bottom + 1, colorBorder2);
 
     const int32_t blinkInterval = 20;
     const int32_t blinkThresh = 20;
@@ -638,11 +635,18 @@ void TombRaiderHooks::renderBar(int32_t value, bool air)
         bottom = top + height;
         right = left + width;
 
-        for (int32_t i = 0; i < height; i++) {
-            int32_t colorType = air ? 1 : 0;
-            int32_t colorIndex = i * colorBarSize / height;
-            m_tombRenderLine(left, top + i, right, top + i, p4,
+        // merge consecutive rows of the same color
+        int32_t colorType = air ? 1 : 0;
+        int32_t rowStart = 0;
+        for (int32_t i = 1; i <= height; i++) {
+            int32_t colorIndex = rowStart * colorBarSize / height;
+            if (i < height && i * colorBarSize / height == colorIndex) {
+                continue;
+            }
+
+            overlay.addRect(left, top + rowStart, right, top + i,
                 colorBar[colorType][colorIndex]);
+            rowStart = i;
         }
     }
 }
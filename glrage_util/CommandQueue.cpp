@@ -0,0 +1,115 @@
+#include "CommandQueue.hpp"
+
+#include <stdexcept>
+
+namespace glrage {
+
+CommandQueue::CommandQueue(size_t capacity)
+    : m_capacity(capacity)
+    , m_entries(new Entry[capacity / sizeof(Entry)])
+    , m_readPos(0)
+    , m_writePos(0)
+    , m_reservePos(0)
+    , m_reserveSize(0)
+{
+    if (capacity < sizeof(Entry) || (capacity & (capacity - 1)) != 0) {
+        throw std::invalid_argument("Queue capacity must be a power of two");
+    }
+}
+
+void* CommandQueue::reserve(size_t size)
+{
+    size_t entrySize = sizeof(Entry) + align(size);
+    if (entrySize > m_capacity / 2) {
+        throw std::length_error("Command is too large for the queue");
+    }
+
+    size_t writePos = m_writePos.load(std::memory_order_relaxed);
+    size_t readPos = m_readPos.load(std::memory_order_acquire);
+    size_t offset = writePos & (m_capacity - 1);
+
+    // commands are contiguous, so skip the rest of the buffer if the command
+    // doesn't fit before its end
+    size_t padding = 0;
+    if (offset + entrySize > m_capacity) {
+        padding = m_capacity - offset;
+    }
+
+    if (writePos - readPos + padding + entrySize > m_capacity) {
+        return nullptr;
+    }
+
+    // the padding is published right away as an entry without function, the
+    // consumer can't get past it before the command is committed anyway
+    if (padding > 0) {
+        Entry& entry = m_entries[offset / sizeof(Entry)];
+        entry.function = nullptr;
+        entry.size = padding;
+        writePos += padding;
+        m_writePos.store(writePos, std::memory_order_release);
+        offset = 0;
+    }
+
+    m_reservePos = writePos;
+    m_reserveSize = entrySize;
+
+    return &m_entries[offset / sizeof(Entry) + 1];
+}
+
+void CommandQueue::commit(Function function)
+{
+    Entry& entry = m_entries[(m_reservePos & (m_capacity - 1)) / sizeof(Entry)];
+    entry.function = function;
+    entry.size = m_reserveSize;
+
+    m_writePos.store(m_reservePos + m_reserveSize, std::memory_order_release);
+}
+
+bool CommandQueue::execute()
+{
+    size_t readPos = m_readPos.load(std::memory_order_relaxed);
+    size_t writePos = m_writePos.load(std::memory_order_acquire);
+
+    while (readPos != writePos) {
+        Entry& entry = m_entries[(readPos & (m_capacity - 1)) / sizeof(Entry)];
+        size_t size = entry.size;
+
+        // the space is released only after the command has been executed, so
+        // the producer can't overwrite its data in the meantime
+        if (entry.function) {
+            try {
+                entry.function(&entry + 1);
+            } catch (...) {
+                m_readPos.store(readPos + size, std::memory_order_release);
+                throw;
+            }
+
+            m_readPos.store(readPos + size, std::memory_order_release);
+            return true;
+        }
+
+        readPos += size;
+        m_readPos.store(readPos, std::memory_order_release);
+    }
+
+    return false;
+}
+
+bool CommandQueue::empty()
+{
+    return m_readPos.load(std::memory_order_acquire) ==
+           m_writePos.load(std::memory_order_acquire);
+}
+
+size_t CommandQueue::maxSize()
+{
+    return m_capacity / 2 - sizeof(Entry);
+}
+
+size_t CommandQueue::align(size_t size)
+{
+    // entries are kept at multiples of their own size
+    return (size + sizeof(Entry) - 1) / sizeof(Entry) * sizeof(Entry);
+}
+
+} // namespace glrage
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace glrage {
+
+// Bounded lock-free ring buffer of variable-sized commands for a single
+// producer and a single consumer. Each command consists of an entry header
+// and the command data that follows it, which is passed to the command
+// function on execution. The data is aligned like std::max_align_t and the
+// function is responsible for destroying any objects in it. Neither side ever
+// blocks, waiting for space or for commands is left to the caller.
+class CommandQueue
+{
+public:
+    typedef void (*Function)(void* data);
+
+    CommandQueue(size_t capacity);
+
+    // producer: returns space for a command with the given data size or
+    // nullptr if the queue is currently full
+    void* reserve(size_t size);
+
+    // producer: publishes the command reserved last
+    void commit(Function function);
+
+    // consumer: executes the next command, returns false if there is none
+    bool execute();
+
+    bool empty();
+
+    // largest data size that fits into the queue
+    size_t maxSize();
+
+private:
+    struct alignas(std::max_align_t) Entry
+    {
+        Function function;
+        size_t size;
+    };
+
+    static size_t align(size_t size);
+
+    // capacity in bytes, must be a power of two
+    size_t m_capacity;
+    std::unique_ptr<Entry[]> m_entries;
+
+    // positions grow monotonically and are wrapped on access
+    alignas(64) std::atomic<size_t> m_readPos;
+    alignas(64) std::atomic<size_t> m_writePos;
+
+    // reserved command, only accessed by the producer
+    size_t m_reservePos;
+    size_t m_reserveSize;
+};
+
+} // namespace glrage
\ No newline at end of file
@@ -1,12 +1,22 @@
 #include "ErrorUtils.hpp"
 #include "StringUtils.hpp"
 
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
 namespace glrage {
 
 void ErrorUtils::warning(const std::string& message)
 {
+#ifdef _WIN32
     MessageBox(hwnd, StringUtils::utf8ToWide(message).c_str(), L"Warning",
         MB_ICONWARNING | MB_OK);
+#else
+    // there's no window to show a message box for
+    fprintf(stderr, "Warning: %s\n", message.c_str());
+#endif
 }
 
 void ErrorUtils::warning(
@@ -31,9 +41,14 @@ void ErrorUtils::warning(const std::exception& exception)
 
 void ErrorUtils::error(const std::string& message)
 {
+#ifdef _WIN32
     MessageBox(hwnd, StringUtils::utf8ToWide(message).c_str(), L"Error",
         MB_ICONERROR | MB_OK);
     ExitProcess(1);
+#else
+    fprintf(stderr, "Error: %s\n", message.c_str());
+    exit(1);
+#endif
 }
 
 void ErrorUtils::error(
@@ -58,11 +73,17 @@ void ErrorUtils::error(const std::exception& exception)
 
 std::string ErrorUtils::getSystemErrorString()
 {
+#ifdef _WIN32
     static char error[1024];
     strerror_s(error, errno);
     return error;
+#else
+    return strerror(errno);
+#endif
 }
 
+#ifdef _WIN32
+
 // https://stackoverflow.com/a/17387176: Create a string from the last error
 // code
 std::string ErrorUtils::getWindowsErrorString()
@@ -95,5 +116,6 @@ void ErrorUtils::setHWnd(HWND _hwnd)
 {
     hwnd = _hwnd;
 }
+#endif
 
 } // namespace glrage
\ No newline at end of file
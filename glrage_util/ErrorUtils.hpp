@@ -1,6 +1,10 @@
 #pragma once
 
+#ifdef _WIN32
 #include <Windows.h>
+#endif
+
+#include <stdexcept>
 #include <string>
 
 namespace glrage {
@@ -20,14 +24,19 @@ public:
         const std::string& message, const std::exception& exception);
     static void error(const std::exception& exception);
     static std::string getSystemErrorString();
+
+#ifdef _WIN32
     static std::string getWindowsErrorString();
 
     static void setHWnd(HWND hwnd);
+#endif
 
 private:
     ErrorUtils();
 
+#ifdef _WIN32
     static HWND hwnd;
+#endif
 };
 
 } // namespace glrage
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include "FileUtils.hpp"
+#include "StringUtils.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <dirent.h>
+#endif
+
+#include <algorithm>
+#include <cwchar>
+
+namespace glrage {
+
+uint32_t FileUtils::nextIndex(const std::wstring& dir,
+    const std::wstring& prefix)
+{
+    uint32_t nextIndex = 0;
+    std::wstring format = prefix + L"%4u";
+
+#ifdef _WIN32
+    WIN32_FIND_DATA findData;
+    HANDLE find = FindFirstFile((dir + L"/" + prefix + L"*.*").c_str(),
+        &findData);
+    if (find != INVALID_HANDLE_VALUE) {
+        do {
+            uint32_t index;
+            if (swscanf_s(findData.cFileName, format.c_str(), &index) == 1) {
+                nextIndex = (std::max)(nextIndex, index + 1);
+            }
+        } while (FindNextFile(find, &findData));
+        FindClose(find);
+    }
+#else
+    DIR* find = opendir(StringUtils::wideToUtf8(dir).c_str());
+    if (find) {
+        while (dirent* entry = readdir(find)) {
+            std::wstring fileName = StringUtils::utf8ToWide(entry->d_name);
+            uint32_t index;
+            if (swscanf(fileName.c_str(), format.c_str(), &index) == 1) {
+                nextIndex = (std::max)(nextIndex, index + 1);
+            }
+        }
+        closedir(find);
+    }
+#endif
+
+    return nextIndex;
+}
+
+} // namespace glrage
\ No newline at end of file
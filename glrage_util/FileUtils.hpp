@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace glrage {
+
+class FileUtils
+{
+public:
+    // returns the index after the highest one used by the files in dir that
+    // are named prefix followed by a four-digit index, or 0 if there are none
+    static uint32_t nextIndex(const std::wstring& dir,
+        const std::wstring& prefix);
+
+private:
+    FileUtils();
+};
+
+} // namespace glrage
\ No newline at end of file
@@ -0,0 +1,352 @@
+#include "ImageWriter.hpp"
+#include "ErrorUtils.hpp"
+#include "StringUtils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <stdexcept>
+
+namespace glrage {
+
+// heavily simplified Targa header struct for raw BGR(A) data
+#pragma pack(push, 1)
+struct TGAHeader
+{
+    uint8_t blank1[2];
+    uint8_t format;
+    uint8_t blank2[9];
+    uint16_t width;
+    uint16_t height;
+    uint8_t depth;
+    uint8_t blank3;
+};
+#pragma pack(pop)
+
+// deflate constants
+static const uint32_t WINDOW_SIZE = 32768;
+static const uint32_t HASH_BITS = 15;
+static const uint32_t MIN_MATCH = 3;
+static const uint32_t MAX_MATCH = 258;
+
+static const uint16_t LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15,
+    17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227,
+    258};
+static const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1,
+    2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t DIST_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33,
+    49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+    6145, 8193, 12289, 16385, 24577};
+static const uint8_t DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5,
+    5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// fixed Huffman codes, bit-reversed, since deflate writes them starting with
+// the most significant bit
+struct FixedCodes
+{
+    std::array<uint16_t, 288> literals;
+    std::array<uint8_t, 288> literalLengths;
+    std::array<uint8_t, 30> distances;
+    std::array<uint8_t, MAX_MATCH + 1> lengthCodes;
+
+    FixedCodes()
+    {
+        for (uint32_t i = 0; i < 288; i++) {
+            uint32_t code;
+            uint32_t length;
+            if (i < 144) {
+                code = 0x30 + i;
+                length = 8;
+            } else if (i < 256) {
+                code = 0x190 + i - 144;
+                length = 9;
+            } else if (i < 280) {
+                code = i - 256;
+                length = 7;
+            } else {
+                code = 0xc0 + i - 280;
+                length = 8;
+            }
+            literals[i] = reverse(code, length);
+            literalLengths[i] = length;
+        }
+
+        for (uint32_t i = 0; i < 30; i++) {
+            distances[i] = reverse(i, 5);
+        }
+
+        for (uint32_t i = 0, length = MIN_MATCH; length <= MAX_MATCH;
+             length++) {
+            while (i < 28 && LENGTH_BASE[i + 1] <= length) {
+                i++;
+            }
+            lengthCodes[length] = i;
+        }
+    }
+
+    static uint16_t reverse(uint32_t code, uint32_t length)
+    {
+        uint32_t result = 0;
+        for (uint32_t i = 0; i < length; i++) {
+            result = (result << 1) | (code & 1);
+            code >>= 1;
+        }
+        return result;
+    }
+};
+
+class BitWriter
+{
+public:
+    BitWriter(std::vector<uint8_t>& output)
+        : m_output(output)
+    {
+    }
+
+    void write(uint32_t bits, uint32_t count)
+    {
+        m_bits |= bits << m_count;
+        m_count += count;
+        while (m_count >= 8) {
+            m_output.push_back(m_bits & 0xff);
+            m_bits >>= 8;
+            m_count -= 8;
+        }
+    }
+
+    void flush()
+    {
+        if (m_count > 0) {
+            m_output.push_back(m_bits & 0xff);
+        }
+        m_bits = 0;
+        m_count = 0;
+    }
+
+private:
+    std::vector<uint8_t>& m_output;
+    uint32_t m_bits = 0;
+    uint32_t m_count = 0;
+};
+
+static uint32_t adler32(const std::vector<uint8_t>& data)
+{
+    uint32_t a = 1;
+    uint32_t b = 0;
+    size_t i = 0;
+    while (i < data.size()) {
+        // the sums can't overflow within 5552 bytes
+        size_t end = (std::min)(i + 5552, data.size());
+        for (; i < end; i++) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size)
+{
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> table;
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (uint32_t k = 0; k < 8; k++) {
+                c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        return table;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void writeBE32(std::vector<uint8_t>& output, uint32_t value)
+{
+    output.push_back(value >> 24);
+    output.push_back(value >> 16);
+    output.push_back(value >> 8);
+    output.push_back(value);
+}
+
+static void writeChunk(
+    std::ofstream& file, const char* type, const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> chunk;
+    chunk.reserve(data.size() + 12);
+    writeBE32(chunk, data.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    writeBE32(chunk, crc32(0, &chunk[4], chunk.size() - 4));
+
+    file.write(reinterpret_cast<char*>(&chunk[0]), chunk.size());
+}
+
+static std::ofstream openFile(const std::wstring& path)
+{
+    std::ofstream file(StringUtils::nativePath(path), std::ofstream::binary);
+    if (!file.good()) {
+        throw std::runtime_error("Can't open image file '" +
+                                 StringUtils::wideToUtf8(path) + "': " +
+                                 ErrorUtils::getSystemErrorString());
+    }
+    return file;
+}
+
+void ImageWriter::writeTGA(const std::wstring& path,
+    const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height)
+{
+    std::ofstream file = openFile(path);
+
+    // Targa images are stored bottom-up by default, so the pixels can be
+    // written as they are
+    TGAHeader tgaHeader = {0};
+    tgaHeader.format = 2;
+    tgaHeader.width = width;
+    tgaHeader.height = height;
+    tgaHeader.depth = 24;
+
+    file.write(reinterpret_cast<char*>(&tgaHeader), sizeof(TGAHeader));
+    file.write(reinterpret_cast<const char*>(&pixels[0]), pixels.size());
+    file.close();
+}
+
+void ImageWriter::writePNG(const std::wstring& path,
+    const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height)
+{
+    std::ofstream file = openFile(path);
+
+    // flip rows and apply the "sub" filter, which stores the difference to
+    // the previous pixel and compresses well for most images
+    size_t pitch = width * 3;
+    std::vector<uint8_t> filtered((pitch + 1) * height);
+    uint8_t* dst = &filtered[0];
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* src = &pixels[(height - y - 1) * pitch];
+        *dst++ = 1;
+        for (size_t x = 0; x < 3; x++) {
+            *dst++ = src[x];
+        }
+        for (size_t x = 3; x < pitch; x++) {
+            *dst++ = src[x] - src[x - 3];
+        }
+    }
+
+    static const uint8_t signature[] = {
+        0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    std::vector<uint8_t> header;
+    writeBE32(header, width);
+    writeBE32(header, height);
+    header.push_back(8); // bit depth
+    header.push_back(2); // color type RGB
+    header.push_back(0); // compression
+    header.push_back(0); // filter
+    header.push_back(0); // interlace
+    writeChunk(file, "IHDR", header);
+
+    std::vector<uint8_t> data;
+    deflate(filtered, data);
+    writeChunk(file, "IDAT", data);
+
+    writeChunk(file, "IEND", std::vector<uint8_t>());
+    file.close();
+}
+
+void ImageWriter::deflate(
+    const std::vector<uint8_t>& data, std::vector<uint8_t>& output)
+{
+    static const FixedCodes codes;
+
+    output.clear();
+    output.reserve(data.size() / 2);
+
+    // zlib header for a 32K window without preset dictionary
+    output.push_back(0x78);
+    output.push_back(0x01);
+
+    // single final block with fixed Huffman codes
+    BitWriter bits(output);
+    bits.write(1, 1);
+    bits.write(1, 2);
+
+    // greedy LZ77 that only remembers the last position for each hash
+    std::vector<int32_t> head(1 << HASH_BITS, -1);
+    auto hash = [&](size_t pos) {
+        uint32_t value =
+            data[pos] | data[pos + 1] << 8 | data[pos + 2] << 16;
+        return (value * 2654435761u) >> (32 - HASH_BITS);
+    };
+
+    size_t size = data.size();
+    size_t pos = 0;
+    while (pos < size) {
+        uint32_t matchLength = 0;
+        uint32_t matchDist = 0;
+
+        if (pos + MIN_MATCH <= size) {
+            uint32_t h = hash(pos);
+            int32_t candidate = head[h];
+            head[h] = static_cast<int32_t>(pos);
+
+            if (candidate >= 0 && pos - candidate <= WINDOW_SIZE) {
+                size_t maxLength = (std::min)(
+                    static_cast<size_t>(MAX_MATCH), size - pos);
+                size_t length = 0;
+                while (length < maxLength &&
+                       data[candidate + length] == data[pos + length]) {
+                    length++;
+                }
+                if (length >= MIN_MATCH) {
+                    matchLength = static_cast<uint32_t>(length);
+                    matchDist = static_cast<uint32_t>(pos - candidate);
+                }
+            }
+        }
+
+        if (matchLength == 0) {
+            uint8_t literal = data[pos++];
+            bits.write(codes.literals[literal], codes.literalLengths[literal]);
+            continue;
+        }
+
+        // length code and extra bits
+        uint32_t lengthIndex = codes.lengthCodes[matchLength];
+        uint32_t symbol = 257 + lengthIndex;
+        bits.write(codes.literals[symbol], codes.literalLengths[symbol]);
+        bits.write(matchLength - LENGTH_BASE[lengthIndex],
+            LENGTH_EXTRA[lengthIndex]);
+
+        // distance code and extra bits
+        uint32_t distIndex = 0;
+        while (distIndex < 29 && DIST_BASE[distIndex + 1] <= matchDist) {
+            distIndex++;
+        }
+        bits.write(codes.distances[distIndex], 5);
+        bits.write(matchDist - DIST_BASE[distIndex], DIST_EXTRA[distIndex]);
+
+        // remember the positions inside the match for later matches
+        size_t end = pos + matchLength;
+        for (pos++; pos < end; pos++) {
+            if (pos + MIN_MATCH <= size) {
+                head[hash(pos)] = static_cast<int32_t>(pos);
+            }
+        }
+    }
+
+    // end of block
+    bits.write(codes.literals[256], codes.literalLengths[256]);
+    bits.flush();
+
+    writeBE32(output, adler32(data));
+}
+
+} // namespace glrage
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace glrage {
+
+class ImageWriter
+{
+public:
+    // writes 24 bit BGR pixels in bottom-up row order, as read by glReadPixels
+    static void writeTGA(const std::wstring& path,
+        const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height);
+
+    // writes 24 bit RGB pixels in bottom-up row order, as read by glReadPixels
+    static void writePNG(const std::wstring& path,
+        const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height);
+
+    // compresses data to a zlib stream using fixed Huffman codes, which is
+    // fast and good enough for screenshots
+    static void deflate(
+        const std::vector<uint8_t>& data, std::vector<uint8_t>& output);
+
+private:
+    ImageWriter();
+};
+
+} // namespace glrage
\ No newline at end of file
@@ -1,30 +1,65 @@
 #include "Logger.hpp"
+#include "StringUtils.hpp"
 
+#include <chrono>
+#include <cstdarg>
 #include <cstdio>
+#include <cstring>
 #include <string>
+#include <thread>
 
 static const size_t bufferSize = 1024;
 
+Logger* Logger::m_current = nullptr;
+const uint32_t Logger::POLL_INTERVAL_MS;
+
+Logger& Logger::instance()
+{
+    static Logger instance;
+    return instance;
+}
+
+Logger* Logger::current()
+{
+    return m_current;
+}
+
+void Logger::setCurrent(Logger* logger)
+{
+    m_current = logger;
+}
+
 void Logger::printf(const char* format, ...)
 {
     char output[bufferSize + 2]; // reserve 2 chars for \r\n
     va_list list;
     va_start(list, format);
-    vsnprintf_s(output, bufferSize, _TRUNCATE, &format[0], list);
+    vsnprintf(output, bufferSize, &format[0], list);
     va_end(list);
 
-    auto len = strnlen_s(output, bufferSize);
+    Logger* logger = current();
+    if (logger) {
+        logger->write(output);
+        return;
+    }
+
+#ifdef _WIN32
+    auto len = strlen(output);
     auto tmp = &output[len];
     *tmp++ = '\r';
     *tmp++ = '\n';
     *tmp++ = 0;
 
     OutputDebugStringA(output);
+#else
+    // there's no debugger output outside of Windows
+    fprintf(stderr, "%s\n", output);
+#endif
 }
 
 void Logger::printf(const std::string& msg)
 {
-    printf(msg.c_str());
+    printf("%s", msg.c_str());
 }
 
 void Logger::tracef(void* returnAddress, const char* function, const char* format, ...)
@@ -37,7 +72,7 @@ void Logger::tracef(void* returnAddress, const char* function, const char* forma
     char output[bufferSize];
     va_list list;
     va_start(list, format);
-    vsnprintf_s(output, sizeof(output), _TRUNCATE, format, list);
+    vsnprintf(output, sizeof(output), format, list);
     va_end(list);
 
     printf("%p %s: %s", returnAddress, function, output);
@@ -46,4 +81,198 @@ void Logger::tracef(void* returnAddress, const char* function, const char* forma
 void Logger::tracef(void* returnAddress, const char* function, const std::string& msg)
 {
     tracef(returnAddress, function, msg.c_str());
+}
+
+Logger::Logger()
+    : m_cells(new Cell[QUEUE_SIZE])
+    , m_enqueuePos(0)
+    , m_dequeuePos(0)
+    , m_dropped(0)
+    , m_started(false)
+    , m_running(true)
+    , m_repeats(0)
+{
+    m_consumer.clear();
+
+    for (size_t i = 0; i < QUEUE_SIZE; i++) {
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+void Logger::setFile(const std::wstring& path)
+{
+    if (!lockConsumer(100)) {
+        return;
+    }
+
+    m_file.close();
+    m_file.open(glrage::StringUtils::nativePath(path), std::ios::trunc);
+
+    unlockConsumer();
+}
+
+void Logger::write(const char* msg)
+{
+    // the writer thread is started on the first message, since the logger
+    // may be created while the loader lock is held
+    if (!m_started.exchange(true)) {
+        std::thread(&Logger::threadProc, this).detach();
+    }
+
+    if (!enqueue(msg)) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Logger::shutdown()
+{
+    m_running = false;
+
+    // don't join the writer thread, which would dead-lock under the loader
+    // lock, and only wait a limited time for it, since it may have been
+    // terminated already while draining the queue
+    if (!lockConsumer(100)) {
+        return;
+    }
+
+    drain();
+    outputRepeats();
+    m_file.close();
+
+    unlockConsumer();
+}
+
+void Logger::threadProc()
+{
+    while (m_running) {
+        if (lockConsumer(0)) {
+            drain();
+            unlockConsumer();
+        }
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds(POLL_INTERVAL_MS));
+    }
+}
+
+bool Logger::enqueue(const char* msg)
+{
+    Cell* cell;
+    size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+
+    for (;;) {
+        cell = &m_cells[pos & (QUEUE_SIZE - 1)];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+        if (diff == 0) {
+            // cell is free, try to claim it
+            if (m_enqueuePos.compare_exchange_weak(
+                    pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // queue is full
+            return false;
+        } else {
+            // another producer claimed the cell
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    snprintf(cell->msg, MESSAGE_SIZE, "%s", msg);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    return true;
+}
+
+bool Logger::dequeue(char* msg)
+{
+    Cell* cell = &m_cells[m_dequeuePos & (QUEUE_SIZE - 1)];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    if (seq != m_dequeuePos + 1) {
+        return false;
+    }
+
+    snprintf(msg, MESSAGE_SIZE, "%s", cell->msg);
+    cell->sequence.store(
+        m_dequeuePos + QUEUE_SIZE, std::memory_order_release);
+    m_dequeuePos++;
+
+    return true;
+}
+
+bool Logger::lockConsumer(uint32_t retries)
+{
+    while (m_consumer.test_and_set(std::memory_order_acquire)) {
+        if (retries-- == 0) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+void Logger::unlockConsumer()
+{
+    m_consumer.clear(std::memory_order_release);
+}
+
+void Logger::drain()
+{
+    char msg[MESSAGE_SIZE];
+    while (dequeue(msg)) {
+        output(msg);
+    }
+
+    uint32_t dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        outputRepeats();
+        snprintf(msg, sizeof(msg), "%u messages dropped", dropped);
+        emit(msg);
+    }
+
+    if (m_file.is_open()) {
+        m_file.flush();
+    }
+}
+
+void Logger::output(const char* msg)
+{
+    // suppress repeated messages and only write their count
+    if (m_lastMsg == msg) {
+        m_repeats++;
+        return;
+    }
+
+    outputRepeats();
+    emit(msg);
+    m_lastMsg = msg;
+}
+
+void Logger::outputRepeats()
+{
+    if (m_repeats == 0) {
+        return;
+    }
+
+    char msg[64];
+    snprintf(msg, sizeof(msg), "last message repeated %u times", m_repeats);
+    m_repeats = 0;
+    emit(msg);
+}
+
+void Logger::emit(const char* msg)
+{
+#ifdef _WIN32
+    std::string line(msg);
+    line += "\r\n";
+
+    OutputDebugStringA(line.c_str());
+#else
+    fprintf(stderr, "%s\n", msg);
+#endif
+
+    if (m_file.is_open()) {
+        m_file << msg << '\n';
+    }
 }
\ No newline at end of file
@@ -1,23 +1,115 @@
 #pragma once
 
+#include "Tracer.hpp"
+
+#ifdef _WIN32
 #include <Windows.h>
+#endif
+
+#ifdef _MSC_VER
 #include <intrin.h>
+#define LOG_RETURN_ADDRESS() _ReturnAddress()
+#else
+#define LOG_RETURN_ADDRESS() __builtin_return_address(0)
+#endif
 
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
 #include <string>
 
-#define LOG_INFO(...) Logger::printf(__VA_ARGS__)
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO 2
 
+// messages below the log level are removed at compile time
+#ifndef LOG_LEVEL
 #ifdef LOG_TRACE_ENABLED
-#define LOG_TRACE(...) Logger::tracef(_ReturnAddress(), __FUNCTION__, __VA_ARGS__)
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#else
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+#endif
+
+#define LOG_INFO(...) Logger::printf(__VA_ARGS__)
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) Logger::printf(__VA_ARGS__)
 #else
-#define LOG_TRACE(...)
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+// traced functions are also recorded by the tracer if it's enabled
+#if LOG_LEVEL <= LOG_LEVEL_TRACE
+#define LOG_TRACE(...)                                                         \
+    TRACE_SCOPE(__FUNCTION__);                                                 \
+    Logger::tracef(LOG_RETURN_ADDRESS(), __FUNCTION__, __VA_ARGS__)
+#else
+#define LOG_TRACE(...) TRACE_SCOPE(__FUNCTION__)
 #endif
 
 class Logger
 {
 public:
+    static Logger& instance();
+
+    // logger used by the current module, which is shared with the other
+    // modules through GLRage::getLogger(). Messages are written synchronously
+    // as long as no logger is set.
+    static Logger* current();
+    static void setCurrent(Logger* logger);
+
     static void printf(const char* format, ...);
     static void printf(const std::string& msg);
     static void tracef(void* returnAddress, const char* function, const char* format, ...);
     static void tracef(void* returnAddress, const char* function, const std::string& msg);
+
+    void setFile(const std::wstring& path);
+    void write(const char* msg);
+    void shutdown();
+
+private:
+    Logger();
+    Logger(Logger const&) = delete;
+    void operator=(Logger const&) = delete;
+
+    // number of queued messages, must be a power of two
+    static const size_t QUEUE_SIZE = 512;
+    static const size_t MESSAGE_SIZE = 1024;
+    static const uint32_t POLL_INTERVAL_MS = 10;
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        char msg[MESSAGE_SIZE];
+    };
+
+    void threadProc();
+
+    bool enqueue(const char* msg);
+    bool dequeue(char* msg);
+    bool lockConsumer(uint32_t retries);
+    void unlockConsumer();
+    void drain();
+    void output(const char* msg);
+    void outputRepeats();
+    void emit(const char* msg);
+
+    static Logger* m_current;
+
+    // bounded MPSC queue, producers never block or take a lock
+    std::unique_ptr<Cell[]> m_cells;
+    std::atomic<size_t> m_enqueuePos;
+    size_t m_dequeuePos;
+    std::atomic<uint32_t> m_dropped;
+
+    std::atomic<bool> m_started;
+    std::atomic<bool> m_running;
+    std::atomic_flag m_consumer;
+
+    // sink state, only accessed by the consumer
+    std::ofstream m_file;
+    std::string m_lastMsg;
+    uint32_t m_repeats;
 };
\ No newline at end of file
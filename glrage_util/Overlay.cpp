@@ -0,0 +1,27 @@
+#include "Overlay.hpp"
+
+namespace glrage {
+
+Overlay& Overlay::instance()
+{
+    static Overlay instance;
+    return instance;
+}
+
+void Overlay::addRect(
+    int32_t left, int32_t top, int32_t right, int32_t bottom, uint8_t color)
+{
+    if (left >= right || top >= bottom) {
+        return;
+    }
+
+    m_rects.push_back(Rect{left, top, right, bottom, color});
+}
+
+void Overlay::takeRects(std::vector<Rect>& rects)
+{
+    rects.clear();
+    rects.swap(m_rects);
+}
+
+} // namespace glrage
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace glrage {
+
+// Rectangles that the ATI3DCIF renderer draws on top of the current render
+// block. Patches use them for overlay elements the game would otherwise draw
+// line by line, which costs a call per line and scales with the resolution.
+class Overlay
+{
+public:
+    struct Rect
+    {
+        // display pixels, right and bottom are exclusive
+        int32_t left;
+        int32_t top;
+        int32_t right;
+        int32_t bottom;
+
+        // index into the game palette
+        uint8_t color;
+    };
+
+    static Overlay& instance();
+
+    void addRect(int32_t left, int32_t top, int32_t right, int32_t bottom,
+        uint8_t color);
+
+    // moves the queued rectangles to rects, in the order they were added
+    void takeRects(std::vector<Rect>& rects);
+
+private:
+    Overlay(){};
+    Overlay(Overlay const&) = delete;
+    void operator=(Overlay const&) = delete;
+
+    std::vector<Rect> m_rects;
+};
+
+} // namespace glrage
\ No newline at end of file
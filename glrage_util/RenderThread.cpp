@@ -0,0 +1,201 @@
+#include "RenderThread.hpp"
+#include "Logger.hpp"
+
+#include <future>
+
+namespace glrage {
+
+RenderThread& RenderThread::instance()
+{
+    static RenderThread instance;
+    return instance;
+}
+
+RenderThread::RenderThread()
+    : m_queue(QUEUE_SIZE)
+    , m_running(false)
+    , m_queuedFrames(0)
+    , m_maxQueuedFrames(1)
+    , m_producerWaiting(false)
+    , m_consumerWaiting(false)
+    , m_stop(false)
+{
+}
+
+RenderThread::~RenderThread()
+{
+    // the thread is terminated already if the process is exiting, and it
+    // can't be joined under the loader lock anyway
+    if (m_thread.joinable()) {
+        m_thread.detach();
+    }
+}
+
+void RenderThread::start(std::function<void()> attach,
+    std::function<void()> detach, uint32_t maxQueuedFrames)
+{
+    if (m_thread.joinable()) {
+        return;
+    }
+
+    m_attach = std::move(attach);
+    m_detach = std::move(detach);
+    m_maxQueuedFrames = maxQueuedFrames;
+    m_stop = false;
+
+    // wait until the thread owns the context, so the caller can take it back
+    // if that failed
+    std::promise<void> attached;
+    std::future<void> attachedFuture = attached.get_future();
+
+    m_thread = std::thread(
+        [this](std::promise<void> attached) {
+            try {
+                m_attach();
+            } catch (...) {
+                attached.set_exception(std::current_exception());
+                return;
+            }
+
+            attached.set_value();
+            threadProc();
+        },
+        std::move(attached));
+
+    try {
+        attachedFuture.get();
+    } catch (...) {
+        m_thread.join();
+        throw;
+    }
+
+    m_threadID = m_thread.get_id();
+    m_running = true;
+
+    LOG_INFO("Render thread started, up to %u queued frames", maxQueuedFrames);
+}
+
+void RenderThread::stop()
+{
+    if (!m_thread.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_consumerCondition.notify_one();
+    m_thread.join();
+
+    m_running = false;
+    m_queuedFrames = 0;
+}
+
+bool RenderThread::isQueued()
+{
+    // commands issued by other commands are executed right away
+    return m_running && std::this_thread::get_id() != m_threadID;
+}
+
+void RenderThread::sync()
+{
+    if (!isQueued()) {
+        return;
+    }
+
+    wait([this] { return m_queue.empty(); });
+}
+
+void RenderThread::frame()
+{
+    if (!isQueued()) {
+        return;
+    }
+
+    m_queuedFrames++;
+    run([this] { m_queuedFrames--; });
+
+    wait([this] { return m_queuedFrames <= m_maxQueuedFrames; });
+}
+
+void* RenderThread::reserve(size_t size)
+{
+    void* data = m_queue.reserve(size);
+    if (!data) {
+        // the queue is full, so the game is far ahead of the render thread
+        wait([&] { return (data = m_queue.reserve(size)) != nullptr; });
+    }
+
+    return data;
+}
+
+void RenderThread::commit(CommandQueue::Function function)
+{
+    m_queue.commit(function);
+
+    // the consumer checks the queue after announcing that it's waiting, so
+    // either it sees the new command or this sees the flag
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_consumerWaiting) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_consumerCondition.notify_one();
+    }
+}
+
+void RenderThread::wait(const std::function<bool()>& done)
+{
+    if (done()) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_producerWaiting = true;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    m_producerCondition.wait(lock, done);
+    m_producerWaiting = false;
+}
+
+void RenderThread::notifyProducer()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_producerWaiting) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_producerCondition.notify_one();
+    }
+}
+
+void RenderThread::threadProc()
+{
+    while (true) {
+        try {
+            if (m_queue.execute()) {
+                notifyProducer();
+                continue;
+            }
+        } catch (const std::exception& ex) {
+            LOG_INFO("Render command failed: %s", ex.what());
+            notifyProducer();
+            continue;
+        }
+
+        // the queue is empty, so the producer may be waiting for that
+        notifyProducer();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_stop) {
+            break;
+        }
+
+        m_consumerWaiting = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        m_consumerCondition.wait(
+            lock, [this] { return m_stop || !m_queue.empty(); });
+        m_consumerWaiting = false;
+    }
+
+    m_detach();
+}
+
+} // namespace glrage
\ No newline at end of file
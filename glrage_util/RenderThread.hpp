@@ -0,0 +1,187 @@
+#pragma once
+
+#include "CommandQueue.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace glrage {
+
+// Optional thread that owns the OpenGL context and executes render commands
+// queued by the game's thread, so the driver overhead doesn't slow down the
+// game logic. As long as the thread isn't running, commands are executed
+// right away on the calling thread, so callers only need to care about the
+// difference if they pass memory owned by the game, which has to be copied
+// into the command.
+class RenderThread
+{
+public:
+    static RenderThread& instance();
+
+    ~RenderThread();
+
+    // starts the thread, which calls attach to make the context current before
+    // executing any commands and detach before it exits. Exceptions thrown by
+    // attach are passed to the caller, which still owns the context then.
+    void start(std::function<void()> attach, std::function<void()> detach,
+        uint32_t maxQueuedFrames);
+
+    // executes the remaining commands and stops the thread
+    void stop();
+
+    // true if commands are queued instead of being executed right away
+    bool isQueued();
+
+    // queues a command
+    template <typename F>
+    void run(F&& func)
+    {
+        typedef typename std::decay<F>::type Command;
+
+        if (!isQueued()) {
+            func();
+            return;
+        }
+
+        void* data = reserve(sizeof(Command));
+        new (data) Command(std::forward<F>(func));
+        commit(&invoke<Command>);
+    }
+
+    // queues a command with size bytes of data, which are filled by
+    // write(void* data) right away and passed to func(void* data) later
+    template <typename W, typename F>
+    void run(size_t size, W&& write, F&& func)
+    {
+        typedef DataCommand<typename std::decay<F>::type> Command;
+
+        // the data is needed anyway if the command is executed right away or
+        // doesn't fit into the queue
+        if (!isQueued() || Command::offset() + size > m_queue.maxSize()) {
+            std::vector<uint8_t> buffer(size);
+            write(buffer.data());
+            run([ buffer = std::move(buffer), func = std::forward<F>(func) ](
+                    ) mutable { func(buffer.data()); });
+            return;
+        }
+
+        void* data = reserve(Command::offset() + size);
+        new (data) Command{std::forward<F>(func)};
+        write(static_cast<uint8_t*>(data) + Command::offset());
+        commit(&invoke<Command>);
+    }
+
+    // executes a command and waits for it, exceptions are passed to the
+    // caller
+    template <typename F>
+    void call(F&& func)
+    {
+        if (!isQueued()) {
+            func();
+            return;
+        }
+
+        std::exception_ptr error;
+        run([&func, &error] {
+            try {
+                func();
+            } catch (...) {
+                error = std::current_exception();
+            }
+        });
+
+        sync();
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // waits until all queued commands have been executed
+    void sync();
+
+    // marks the end of a frame and waits while more frames are queued than
+    // allowed, which bounds the latency added by the queue
+    void frame();
+
+private:
+    RenderThread();
+    RenderThread(RenderThread const&) = delete;
+    void operator=(RenderThread const&) = delete;
+
+    // size of the command queue in bytes, must be a power of two
+    static const size_t QUEUE_SIZE = 8 << 20;
+
+    // command followed by its data
+    template <typename F>
+    struct DataCommand
+    {
+        F func;
+
+        static size_t offset()
+        {
+            const size_t align = alignof(std::max_align_t);
+            return (sizeof(DataCommand) + align - 1) / align * align;
+        }
+
+        void operator()()
+        {
+            func(reinterpret_cast<uint8_t*>(this) + offset());
+        }
+    };
+
+    template <typename C>
+    static void invoke(void* data)
+    {
+        // the command is destroyed even if it throws
+        struct Guard
+        {
+            C* command;
+            ~Guard()
+            {
+                command->~C();
+            }
+        } guard{static_cast<C*>(data)};
+
+        (*guard.command)();
+    }
+
+    void* reserve(size_t size);
+    void commit(CommandQueue::Function function);
+    void wait(const std::function<bool()>& done);
+    void notifyProducer();
+    void threadProc();
+
+    CommandQueue m_queue;
+
+    std::thread m_thread;
+    std::thread::id m_threadID;
+    std::atomic<bool> m_running;
+    std::function<void()> m_attach;
+    std::function<void()> m_detach;
+
+    // frame limit
+    std::atomic<uint32_t> m_queuedFrames;
+    uint32_t m_maxQueuedFrames;
+
+    // both sides only sleep if there's nothing to do and announce it with
+    // their waiting flag, so the other side only takes the lock if needed
+    std::mutex m_mutex;
+    std::condition_variable m_producerCondition;
+    std::condition_variable m_consumerCondition;
+    std::atomic<bool> m_producerWaiting;
+    std::atomic<bool> m_consumerWaiting;
+    bool m_stop;
+};
+
+} // namespace glrage
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <sstream>
 #include <algorithm>
+#include <cstdio>
 #include <iomanip>
 #include <codecvt>
 
@@ -38,12 +39,12 @@ std::string StringUtils::format(std::string fmt, ...)
 
 void StringUtils::formatResize(std::string& str, std::string& fmt, va_list& vl)
 {
-    str.resize((std::min)(_vscprintf(fmt.c_str(), vl), 0x4000));
+    str.resize((std::min)(vsnprintf(nullptr, 0, fmt.c_str(), vl), 0x4000));
 }
 
 void StringUtils::formatImpl(std::string& str, std::string& fmt, va_list& vl)
 {
-    vsnprintf_s(&str[0], str.capacity(), str.capacity(), fmt.c_str(), vl);
+    vsnprintf(&str[0], str.size() + 1, fmt.c_str(), vl);
 }
 
 std::string StringUtils::bytesToHex(const std::vector<uint8_t>& data)
@@ -77,18 +78,32 @@ std::vector<uint8_t> StringUtils::hexToBytes(const std::string& str)
     return data;
 }
 
+// wchar_t is UTF-16 on Windows and UTF-32 elsewhere
+#ifdef _WIN32
+typedef std::codecvt_utf8_utf16<wchar_t> WideCodecvt;
+#else
+typedef std::codecvt_utf8<wchar_t> WideCodecvt;
+#endif
+
 std::wstring StringUtils::utf8ToWide(const std::string& str)
 {
-    static std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>, wchar_t>
-        convert;
+    static std::wstring_convert<WideCodecvt, wchar_t> convert;
     return convert.from_bytes(str);
 }
 
 std::string StringUtils::wideToUtf8(const std::wstring& str)
 {
-    static std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>, wchar_t>
-        convert;
+    static std::wstring_convert<WideCodecvt, wchar_t> convert;
     return convert.to_bytes(str);
 }
 
+StringUtils::Path StringUtils::nativePath(const std::wstring& path)
+{
+#ifdef _WIN32
+    return path;
+#else
+    return wideToUtf8(path);
+#endif
+}
+
 } // namespace glrage
\ No newline at end of file
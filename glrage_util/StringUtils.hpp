@@ -10,6 +10,12 @@ namespace glrage {
 class StringUtils
 {
 public:
+#ifdef _WIN32
+    typedef std::wstring Path;
+#else
+    typedef std::string Path;
+#endif
+
     static void format(std::string& str, std::string fmt, ...);
     static std::string format(std::string fmt, ...);
     static std::string bytesToHex(const std::vector<uint8_t>& data);
@@ -17,6 +23,10 @@ public:
     static std::wstring utf8ToWide(const std::string& str);
     static std::string wideToUtf8(const std::wstring& str);
 
+    // converts a path for the file stream constructors, which only accept
+    // wide strings on Windows
+    static Path nativePath(const std::wstring& path);
+
 private:
     static void formatResize(std::string& str, std::string& fmt, va_list& va);
     static void formatImpl(std::string& str, std::string& fmt, va_list& va);
@@ -0,0 +1,50 @@
+#include "TimeUtils.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <Mmsystem.h>
+#else
+#include <thread>
+#endif
+
+namespace glrage {
+
+void TimeUtils::sleepUntil(Clock::time_point time)
+{
+    // Sleep() may oversleep by up to one timer period, so only sleep while
+    // there's enough time left and spin for the remainder. This keeps the
+    // accuracy of a busy wait while most of the time is spent idle.
+    const auto spinThreshold = std::chrono::milliseconds(2);
+
+    while (time - Clock::now() > spinThreshold) {
+#ifdef _WIN32
+        Sleep(1);
+#else
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+    }
+
+    while (Clock::now() < time) {
+#ifdef _WIN32
+        YieldProcessor();
+#else
+        std::this_thread::yield();
+#endif
+    }
+}
+
+void TimeUtils::raiseTimerResolution()
+{
+#ifdef _WIN32
+    timeBeginPeriod(1);
+#endif
+}
+
+void TimeUtils::restoreTimerResolution()
+{
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+}
+
+} // namespace glrage
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <chrono>
+
+namespace glrage {
+
+class TimeUtils
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static void sleepUntil(Clock::time_point time);
+
+    // raises the resolution of the system timer to one millisecond, so
+    // sleepUntil() doesn't oversleep. Each call must be matched by a call to
+    // restoreTimerResolution().
+    static void raiseTimerResolution();
+    static void restoreTimerResolution();
+
+private:
+    TimeUtils();
+};
+
+} // namespace glrage
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include "Tracer.hpp"
+#include "ErrorUtils.hpp"
+#include "StringUtils.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <fstream>
+#include <stdexcept>
+
+namespace glrage {
+
+namespace {
+
+uint32_t currentProcessID()
+{
+#ifdef _WIN32
+    return GetCurrentProcessId();
+#else
+    return static_cast<uint32_t>(getpid());
+#endif
+}
+
+uint32_t currentThreadID()
+{
+#ifdef _WIN32
+    return GetCurrentThreadId();
+#else
+    return static_cast<uint32_t>(syscall(SYS_gettid));
+#endif
+}
+
+} // namespace
+
+Tracer* Tracer::m_current = nullptr;
+
+Tracer& Tracer::instance()
+{
+    static Tracer instance;
+    return instance;
+}
+
+Tracer* Tracer::current()
+{
+    return m_current;
+}
+
+void Tracer::setCurrent(Tracer* tracer)
+{
+    m_current = tracer;
+}
+
+Tracer::Tracer()
+    : m_enabled(false)
+    , m_epoch(TimeUtils::Clock::now())
+{
+}
+
+void Tracer::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+}
+
+bool Tracer::isEnabled()
+{
+    return m_enabled.load(std::memory_order_relaxed);
+}
+
+void Tracer::record(const char* name, TimeUtils::Clock::time_point start,
+    TimeUtils::Clock::time_point end)
+{
+    // the scope may have started before write() stopped recording
+    if (!isEnabled()) {
+        return;
+    }
+
+    ThreadBuffer* buffer = threadBuffer();
+    size_t count = buffer->eventCount.load(std::memory_order_relaxed);
+    if (count >= MAX_EVENTS) {
+        return;
+    }
+
+    uint32_t nameID;
+    auto itr = buffer->nameIDs.find(name);
+    if (itr == buffer->nameIDs.end()) {
+        if (buffer->nameCount >= MAX_NAMES) {
+            return;
+        }
+        nameID = static_cast<uint32_t>(buffer->nameCount++);
+        buffer->names[nameID] = name;
+        buffer->nameIDs[name] = nameID;
+    } else {
+        nameID = itr->second;
+    }
+
+    buffer->events[count] = Event{nameID, start, end - start};
+    buffer->eventCount.store(count + 1, std::memory_order_release);
+}
+
+void Tracer::write(const std::wstring& path)
+{
+    // stop recording, events that other threads publish after the counts
+    // have been read below are skipped
+    m_enabled = false;
+
+    std::ofstream file(StringUtils::nativePath(path), std::ofstream::binary);
+    if (!file.good()) {
+        throw std::runtime_error("Can't open trace file '" +
+                                 StringUtils::wideToUtf8(path) + "': " +
+                                 ErrorUtils::getSystemErrorString());
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint32_t pid = currentProcessID();
+    bool first = true;
+
+    // Chrome trace event format with complete events, times in microseconds
+    file << "{\"traceEvents\":[\n";
+
+    for (auto& thread : m_threads) {
+        size_t count = thread->eventCount.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; i++) {
+            const Event& event = thread->events[i];
+            double ts = std::chrono::duration<double, std::micro>(
+                event.start - m_epoch).count();
+            double dur =
+                std::chrono::duration<double, std::micro>(event.duration)
+                    .count();
+
+            if (!first) {
+                file << ",\n";
+            }
+            first = false;
+
+            file << StringUtils::format("{\"name\":\"%s\",\"ph\":\"X\","
+                                        "\"pid\":%u,\"tid\":%u,\"ts\":%.3f,"
+                                        "\"dur\":%.3f}",
+                thread->names[event.nameID].c_str(), pid, thread->threadID, ts,
+                dur);
+        }
+    }
+
+    file << "\n]}\n";
+}
+
+Tracer::ThreadBuffer* Tracer::threadBuffer()
+{
+    // each thread gets its own buffer, so recording doesn't need any locking
+    static thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_threads.push_back(std::make_unique<ThreadBuffer>());
+        buffer = m_threads.back().get();
+        buffer->threadID = currentThreadID();
+    }
+
+    return buffer;
+}
+
+} // namespace glrage
\ No newline at end of file
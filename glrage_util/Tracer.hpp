@@ -0,0 +1,109 @@
+#pragma once
+
+#include "TimeUtils.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SCOPE(name)                                                      \
+    glrage::TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+namespace glrage {
+
+class Tracer
+{
+public:
+    static Tracer& instance();
+
+    // tracer used by the current module, which is shared with the other
+    // modules through GLRage::getTracer()
+    static Tracer* current();
+    static void setCurrent(Tracer* tracer);
+
+    void setEnabled(bool enabled);
+    bool isEnabled();
+    void record(const char* name, TimeUtils::Clock::time_point start,
+        TimeUtils::Clock::time_point end);
+    void write(const std::wstring& path);
+
+private:
+    Tracer();
+    Tracer(Tracer const&) = delete;
+    void operator=(Tracer const&) = delete;
+
+    // maximum number of events and names per thread buffer, both are
+    // allocated up front, so recording never reallocates
+    static const size_t MAX_EVENTS = 1 << 18;
+    static const size_t MAX_NAMES = 1 << 10;
+
+    struct Event
+    {
+        uint32_t nameID;
+        TimeUtils::Clock::time_point start;
+        TimeUtils::Clock::duration duration;
+    };
+
+    // Only the owning thread writes to its buffer. The counts are published
+    // after the entries have been written, so write() can read everything
+    // below them while other threads are still recording.
+    struct ThreadBuffer
+    {
+        uint32_t threadID;
+        std::unique_ptr<Event[]> events{new Event[MAX_EVENTS]};
+        std::atomic<size_t> eventCount{0};
+
+        // names are copied, since the modules that own the original strings
+        // may already be unloaded when the trace is written
+        std::unordered_map<const char*, uint32_t> nameIDs;
+        std::unique_ptr<std::string[]> names{new std::string[MAX_NAMES]};
+        size_t nameCount = 0;
+    };
+
+    ThreadBuffer* threadBuffer();
+
+    static Tracer* m_current;
+
+    std::atomic<bool> m_enabled;
+    TimeUtils::Clock::time_point m_epoch;
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_threads;
+};
+
+class TraceScope
+{
+public:
+    TraceScope(const char* name)
+        : m_tracer(Tracer::current())
+        , m_name(name)
+    {
+        if (m_tracer && m_tracer->isEnabled()) {
+            m_start = TimeUtils::Clock::now();
+        } else {
+            m_tracer = nullptr;
+        }
+    }
+
+    ~TraceScope()
+    {
+        if (m_tracer) {
+            m_tracer->record(m_name, m_start, TimeUtils::Clock::now());
+        }
+    }
+
+private:
+    TraceScope(TraceScope const&) = delete;
+    void operator=(TraceScope const&) = delete;
+
+    Tracer* m_tracer;
+    const char* m_name;
+    TimeUtils::Clock::time_point m_start;
+};
+
+} // namespace glrage
\ No newline at end of file
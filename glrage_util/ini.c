@@ -53,7 +53,11 @@ static char* find_char_or_comment(const char* s, char c)
 /* Version of strncpy that ensures dest (size bytes) is null-terminated. */
 static char* strncpy0(char* dest, const char* src, size_t size)
 {
+#ifdef _MSC_VER
     strncpy_s(dest, size, src, size);
+#else
+    strncpy(dest, src, size);
+#endif
     dest[size - 1] = '\0';
     return dest;
 }
@@ -172,7 +176,11 @@ int ini_parse(const char* filename,
     FILE* file;
     int error;
 
+#ifdef _MSC_VER
     fopen_s(&file, filename, "r");
+#else
+    file = fopen(filename, "r");
+#endif
     if (!file)
         return -1;
     error = ini_parse_file(file, handler, user);